@@ -18,4 +18,5 @@ LibraryDir["GLFW"] = "%{wks.location}/%{prj.name}/Libraries/glfw/lib-vc2019"
 
 Library = {}
 Library["Vulkan"] = "%{LibraryDir.VulkanSDK}/vulkan-1.lib"
+Library["ShaderC"] = "%{LibraryDir.VulkanSDK}/shaderc_shared.lib"
 Library["VulkanUtils"] = "%{LibraryDir.VulkanSDK}/VKLayer_utils.lib"
\ No newline at end of file
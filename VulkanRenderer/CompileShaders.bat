@@ -1,6 +1,7 @@
 @echo off
 set vertName=Vert
 set fragName=Frag
+set compName=Comp
 set spvExtension=.spv
 cd MainApp/resources/vulkan/shaders/
 SETLOCAL ENABLEDELAYEDEXPANSION
@@ -11,4 +12,8 @@ for %%i in (*.vert) do (
 for %%j in (*.frag) do (
 	set shaderName=%%~nj%fragName%%spvExtension%
 	C:/VulkanSDK/1.2.189.2/Bin/glslangValidator.exe -V %%j -o !shaderName!
+)
+for %%k in (*.comp) do (
+	set shaderName=%%~nk%compName%%spvExtension%
+	C:/VulkanSDK/1.2.189.2/Bin/glslangValidator.exe -V %%k -o !shaderName!
 )
\ No newline at end of file
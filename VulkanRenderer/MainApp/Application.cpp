@@ -32,6 +32,9 @@ Application::Application()
 
 	firstMouse = true;
 	firstKeyPress = true;
+	firstLatencyKeyPress = true;
+	firstPresentModeKeyPress = true;
+	firstBenchmarkKeyPress = true;
 
 	window = new Window(name, width, height);
 }
@@ -54,6 +57,9 @@ Application::Application(const char* appName, uint32_t appWidth, uint32_t appHei
 
 	firstMouse = true;
 	firstKeyPress = true;
+	firstLatencyKeyPress = true;
+	firstPresentModeKeyPress = true;
+	firstBenchmarkKeyPress = true;
 
 	window = new Window(name, width, height, true);
 }
@@ -81,10 +87,10 @@ void Application::cleanupInstance()
 	}
 }
 
-void Application::run()
+void Application::run(const RendererSettings& settings)
 {
 	window->initWindow(keyCallback, cursorPosCallback, mouseButtonCallback, scrollCallback, framebufferResizeCallback, this);
-	vulkanRenderer = Renderer::initInstance(window);
+	vulkanRenderer = Renderer::initInstance(window, settings);
 	update();
 }
 
@@ -106,6 +112,8 @@ void Application::update()
 		dt = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
+		// Input is read as late as the frame pacing allows
+		vulkanRenderer->waitForNextFrame();
 		glfwPollEvents();
 		processInput(window->getWindow());
 
@@ -156,6 +164,83 @@ void Application::processInput(GLFWwindow* window)
 		vulkanRenderer->setRenderMode(UNLIT);
 	}
 
+	if (glfwGetKey(window, GLFW_KEY_F4) == GLFW_PRESS)
+	{
+		vulkanRenderer->setCullingMode(CULLING_GPU);
+	}
+	if (glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS)
+	{
+		vulkanRenderer->setCullingMode(CULLING_CPU);
+	}
+	if (glfwGetKey(window, GLFW_KEY_F6) == GLFW_PRESS)
+	{
+		vulkanRenderer->setCullingMode(CULLING_NONE);
+	}
+
+	if (glfwGetKey(window, GLFW_KEY_F7) == GLFW_PRESS)
+	{
+		vulkanRenderer->setParallelRecording(true);
+	}
+	if (glfwGetKey(window, GLFW_KEY_F8) == GLFW_PRESS)
+	{
+		vulkanRenderer->setParallelRecording(false);
+	}
+
+	if (glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS)
+	{
+		vulkanRenderer->setThreadedSimulation(true);
+	}
+	if (glfwGetKey(window, GLFW_KEY_F10) == GLFW_PRESS)
+	{
+		vulkanRenderer->setThreadedSimulation(false);
+	}
+
+	// Number keys pick how many frames the CPU may queue ahead of the GPU
+	for (int key = GLFW_KEY_1; key < GLFW_KEY_1 + SwapChain::MAX_FRAMES_IN_FLIGHT; key++)
+	{
+		if (glfwGetKey(window, key) == GLFW_PRESS)
+			vulkanRenderer->setFramesInFlight(key - GLFW_KEY_1 + 1);
+	}
+
+	if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS && firstLatencyKeyPress)
+	{
+		firstLatencyKeyPress = false;
+		vulkanRenderer->setLowLatency(!vulkanRenderer->getLowLatency());
+	}
+
+	if (glfwGetKey(window, GLFW_KEY_L) == GLFW_RELEASE)
+		firstLatencyKeyPress = true;
+
+	// P cycles FIFO -> mailbox -> immediate
+	if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && firstPresentModeKeyPress)
+	{
+		firstPresentModeKeyPress = false;
+		switch (vulkanRenderer->getPresentMode())
+		{
+		case VK_PRESENT_MODE_FIFO_KHR:
+			vulkanRenderer->setPresentMode(VK_PRESENT_MODE_MAILBOX_KHR);
+			break;
+		case VK_PRESENT_MODE_MAILBOX_KHR:
+			vulkanRenderer->setPresentMode(VK_PRESENT_MODE_IMMEDIATE_KHR);
+			break;
+		default:
+			vulkanRenderer->setPresentMode(VK_PRESENT_MODE_FIFO_KHR);
+			break;
+		}
+	}
+
+	if (glfwGetKey(window, GLFW_KEY_P) == GLFW_RELEASE)
+		firstPresentModeKeyPress = true;
+
+	if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS && firstBenchmarkKeyPress)
+	{
+		firstBenchmarkKeyPress = false;
+		vulkanRenderer->setUncappedBenchmark(!vulkanRenderer->getUncappedBenchmark());
+	}
+
+	if (glfwGetKey(window, GLFW_KEY_B) == GLFW_RELEASE)
+		firstBenchmarkKeyPress = true;
+
 	if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS && firstKeyPress)
 	{
 		firstKeyPress = false;
@@ -211,7 +296,7 @@ void Application::keyCallback(GLFWwindow* window, int key, int scancode, int act
 		glfwSetWindowShouldClose(window, true);
 
 	if (key == GLFW_KEY_T && action == GLFW_PRESS)
-		Renderer::compileShaders();
+		Renderer::getInstance()->reloadShaders();
 }
 
 void Application::cursorPosCallback(GLFWwindow* window, double xpos, double ypos)
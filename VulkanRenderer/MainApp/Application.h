@@ -19,7 +19,7 @@ public:
 
 	Window* getApplicationWindow() { return window; }
 
-	void run();
+	void run(const RendererSettings& settings = RendererSettings());
 
 private:
 	// Update application
@@ -59,6 +59,9 @@ private:
 	float mouseOffsetX, mouseOffsetY;
 	bool firstMouse;
 	bool firstKeyPress;
+	bool firstLatencyKeyPress;
+	bool firstPresentModeKeyPress;
+	bool firstBenchmarkKeyPress;
 
 	double prevTime = 0.0;
 	double curTime = 0.0;
@@ -28,48 +28,51 @@ VkDeviceSize Buffer::getAlignment(VkDeviceSize instanceSize, VkDeviceSize minOff
     return instanceSize;
 }
 
-Buffer::Buffer(Device& device, VkDeviceSize instanceSize, uint32_t instanceCount, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize minOffsetAlignment)
+Buffer::Buffer(Device& device, VkDeviceSize instanceSize, uint32_t instanceCount, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize minOffsetAlignment,
+    MemoryAllocationStrategy allocationStrategy)
     : mDevice{ device }, instanceSize{ instanceSize }, instanceCount{ instanceCount }, usageFlags{ usageFlags }, memoryPropertyFlags{ memoryPropertyFlags }
 {
     alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
     bufferSize = alignmentSize * instanceCount;
-    device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+    device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory, allocationStrategy);
 }
 
 Buffer::~Buffer()
 {
     unmap();
     vkDestroyBuffer(mDevice.getDevice(), buffer, nullptr);
-    vkFreeMemory(mDevice.getDevice(), memory, nullptr);
+    mDevice.freeMemory(memory);
 }
 
 /**
- * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
+ * Map the whole buffer. If successful, mapped points to the start of the buffer.
  *
- * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
- * buffer range.
- * @param offset (Optional) Byte offset from beginning
+ * @note Host visible memory is persistently mapped by the device allocator, so this only hands out
+ * a pointer into the owning memory block. Ranges are chosen with the offsets of writeToBuffer and
+ * flush instead.
  *
- * @return VkResult of the buffer mapping call
+ * @return VK_ERROR_MEMORY_MAP_FAILED if the memory isn't host visible
  */
-VkResult Buffer::map(VkDeviceSize size, VkDeviceSize offset)
+VkResult Buffer::map()
 {
-    assert(buffer && memory && "Called map on buffer before create");
-    return vkMapMemory(mDevice.getDevice(), memory, offset, size, 0, &mapped);
+    assert(buffer && memory.isValid() && "Called map on buffer before create");
+    if (!memory.mapped)
+    {
+        return VK_ERROR_MEMORY_MAP_FAILED;
+    }
+
+    mapped = memory.mapped;
+    return VK_SUCCESS;
 }
 
 /**
  * Unmap a mapped memory range
  *
- * @note Does not return a result as vkUnmapMemory can't fail
+ * @note The underlying memory block stays mapped until it is released by the allocator
  */
 void Buffer::unmap()
 {
-    if (mapped)
-    {
-        vkUnmapMemory(mDevice.getDevice(), memory);
-        mapped = nullptr;
-    }
+    mapped = nullptr;
 }
 
 /**
@@ -110,12 +113,21 @@ void Buffer::writeToBuffer(void* data, VkDeviceSize size, VkDeviceSize offset)
  */
 VkResult Buffer::flush(VkDeviceSize size, VkDeviceSize offset)
 {
-    VkMappedMemoryRange mappedRange = {};
-    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = memory;
-    mappedRange.offset = offset;
-    mappedRange.size = size;
-    return vkFlushMappedMemoryRanges(mDevice.getDevice(), 1, &mappedRange);
+    return mDevice.getAllocator().flush(memory, size, offset);
+}
+
+/**
+ * Flush several memory ranges of the buffer at once to make them visible to the device
+ *
+ * @note Only required for non-coherent memory
+ *
+ * @param ranges Byte ranges from the beginning of the buffer
+ *
+ * @return VkResult of the flush call
+ */
+VkResult Buffer::flushRanges(const std::vector<MemoryRange>& ranges)
+{
+    return mDevice.getAllocator().flush(memory, ranges);
 }
 
 /**
@@ -131,12 +143,7 @@ VkResult Buffer::flush(VkDeviceSize size, VkDeviceSize offset)
  */
 VkResult Buffer::invalidate(VkDeviceSize size, VkDeviceSize offset)
 {
-    VkMappedMemoryRange mappedRange = {};
-    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = memory;
-    mappedRange.offset = offset;
-    mappedRange.size = size;
-    return vkInvalidateMappedMemoryRanges(mDevice.getDevice(), 1, &mappedRange);
+    return mDevice.getAllocator().invalidate(memory, size, offset);
 }
 
 /**
@@ -90,3 +90,31 @@ void Camera::setPerspectiveProjection(float fov, float aspectRatio, float near,
 	proj = glm::perspective(glm::radians(fov), aspectRatio, near, far);
 	proj[1][1] *= -1;
 }
+
+std::array<glm::vec4, 6> Camera::getFrustumPlanes() const
+{
+	// Gribb/Hartmann plane extraction from the rows of the view projection matrix
+	glm::mat4 viewProj = proj * view;
+	glm::vec4 row0 = glm::vec4(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+	glm::vec4 row1 = glm::vec4(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+	glm::vec4 row2 = glm::vec4(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+	glm::vec4 row3 = glm::vec4(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+
+	// The near plane uses the -w..w clip range, which is conservative for a 0..1 depth range too
+	std::array<glm::vec4, 6> planes =
+	{
+		row3 + row0, // left
+		row3 - row0, // right
+		row3 + row1, // bottom
+		row3 - row1, // top
+		row3 + row2, // near
+		row3 - row2  // far
+	};
+
+	for (glm::vec4& plane : planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	return planes;
+}
@@ -9,6 +9,8 @@
 #include <glfw3.h>
 #include <glfw3native.h>
 
+#include <array>
+
 struct Camera
 {
 	void updatePositon(int key, float speed);
@@ -20,6 +22,9 @@ struct Camera
 
 	void setPerspectiveProjection(float fov, float aspectRatio, float near, float far);
 
+	// World space planes of the view frustum, normals point inwards and are normalized
+	std::array<glm::vec4, 6> getFrustumPlanes() const;
+
 	glm::mat4 getTransform()
 	{
 		glm::mat4 rot = glm::toMat4(orientation);
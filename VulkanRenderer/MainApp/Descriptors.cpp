@@ -39,21 +39,23 @@ DescriptorSetLayout::DescriptorSetLayout(Device& device, std::unordered_map<uint
 	descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 	descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
 	descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
-	/*if (unbound)
+	// Arrays in unbound layouts may be left partially empty and filled in while the set is in use
+	std::vector<VkDescriptorBindingFlags> flags;
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlags{};
+	if (unbound)
 	{
-		std::vector<VkDescriptorBindingFlags> flags;
 		flags.resize(setLayoutBindings.size());
-		for(size_t i = 0; i < flags.size(); i++)
+		for (size_t i = 0; i < flags.size(); i++)
 		{
-			flags[i] = VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
+			flags[i] = setLayoutBindings[i].descriptorCount > 1 ? VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT : 0;
 		}
 
-		VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlags{};
 		bindingFlags.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
 		bindingFlags.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
 		bindingFlags.pBindingFlags = flags.data();
 		descriptorSetLayoutInfo.pNext = &bindingFlags;
-	}*/
+		descriptorSetLayoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	}
 
 	if (vkCreateDescriptorSetLayout(mDevice.getDevice(), &descriptorSetLayoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
 	{
@@ -1,5 +1,11 @@
 #include "Device.h"
 #include "Log.h"
+#include "UploadContext.h"
+#include "StagingRing.h"
+#include "MeshPool.h"
+#include "PipelineCache.h"
+#include "LayoutCache.h"
+#include "Model.h"
 
 #include <cstring>
 #include <iostream>
@@ -60,11 +66,29 @@ Device::Device(Window& window) : window{ window }
     pickPhysicalDevice();
     createLogicalDevice();
     createCommandPool();
+
+    allocator.init(device_, physicalDevice);
+    stagingRing = std::make_unique<StagingRing>(*this, StagingRing::DEFAULT_SIZE);
+    uploadContext = std::make_unique<UploadContext>(*this);
+    meshPool = std::make_unique<MeshPool>(*this, sizeof(Model::Vertex), MeshPool::DEFAULT_MAX_VERTICES, MeshPool::DEFAULT_MAX_INDICES);
+    pipelineCache = std::make_unique<PipelineCache>(*this, PipelineCache::DEFAULT_PATH);
+    layoutCache = std::make_unique<LayoutCache>(*this);
 }
 
 Device::~Device()
 {
+    // Pending uploads may still target the mesh pool and staging ring
+    uploadContext = nullptr;
+    meshPool = nullptr;
+    stagingRing = nullptr;
+
+    // Every pipeline has been created by now, whatever was compiled this run is kept for the next
+    pipelineCache->save();
+    pipelineCache = nullptr;
+    layoutCache = nullptr;
+
     vkDestroyCommandPool(device_, commandPool, nullptr);
+    allocator.cleanup();
     vkDestroyDevice(device_, nullptr);
 
     if (enableValidationLayers)
@@ -89,7 +113,16 @@ void Device::createInstance()
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // 1.1 is needed to query extension properties and features of the physical device. A 1.0 loader
+    // doesn't have vkEnumerateInstanceVersion and can only create a 1.0 instance.
+    auto enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion");
+    uint32_t loaderVersion = VK_API_VERSION_1_0;
+    if (enumerateInstanceVersion != nullptr)
+    {
+        enumerateInstanceVersion(&loaderVersion);
+    }
+    instanceVersion_ = loaderVersion >= VK_API_VERSION_1_1 ? VK_API_VERSION_1_1 : VK_API_VERSION_1_0;
+    appInfo.apiVersion = instanceVersion_;
 
     VkInstanceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -150,6 +183,29 @@ void Device::pickPhysicalDevice()
 
     vkGetPhysicalDeviceProperties(physicalDevice, &properties);
     CORE_INFO("Physical Device: {0}", properties.deviceName)
+
+    // Both the instance and the device have to be 1.1 for the *2 physical device queries
+    physicalDeviceQueries2_ = instanceVersion_ >= VK_API_VERSION_1_1 && properties.apiVersion >= VK_API_VERSION_1_1;
+
+    // Descriptors in update-after-bind sets have their own limits
+    descriptorIndexingProperties = {};
+    descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    if (physicalDeviceQueries2_)
+    {
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &descriptorIndexingProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+    }
+    else
+    {
+        // Without a way to query them, the regular limits are the safe choice
+        const VkPhysicalDeviceLimits& limits = properties.limits;
+        descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers = limits.maxPerStageDescriptorSamplers;
+        descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages = limits.maxPerStageDescriptorSampledImages;
+        descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSamplers = limits.maxDescriptorSetSamplers;
+        descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages = limits.maxDescriptorSetSampledImages;
+    }
 }
 
 void Device::createLogicalDevice()
@@ -158,6 +214,10 @@ void Device::createLogicalDevice()
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+    if (indices.transferFamilyHasValue)
+    {
+        uniqueQueueFamilies.insert(indices.transferFamily);
+    }
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -183,6 +243,35 @@ void Device::createLogicalDevice()
     deviceFeatures.fillModeNonSolid = VK_TRUE;
     deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
 
+    // Optional, the indirect draw list falls back to one draw per command without them
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    multiDrawIndirect_ = supportedFeatures.multiDrawIndirect == VK_TRUE;
+    drawIndirectFirstInstance_ = supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
+    // Optional, frame pacing falls back to per-frame fences without them. The extension depends on
+    // 1.1 (or VK_KHR_get_physical_device_properties2), and the feature itself has to be supported.
+    std::vector<const char*> enabledExtensions = deviceExtensions;
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures{};
+    timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineSemaphores_ = physicalDeviceQueries2_ && hasDeviceExtension(physicalDevice, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+    if (timelineSemaphores_)
+    {
+        VkPhysicalDeviceFeatures2 supportedFeatures2{};
+        supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supportedFeatures2.pNext = &timelineSemaphoreFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures2);
+        timelineSemaphores_ = timelineSemaphoreFeatures.timelineSemaphore == VK_TRUE;
+        timelineSemaphoreFeatures.pNext = nullptr;
+    }
+    if (timelineSemaphores_)
+    {
+        enabledExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+        physicalDeviceDescriptorIndexingFeatures.pNext = &timelineSemaphoreFeatures;
+    }
+
     VkPhysicalDeviceFeatures2 deviceFeatures2{};
     deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
     deviceFeatures2.features = deviceFeatures;
@@ -195,8 +284,8 @@ void Device::createLogicalDevice()
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
     //createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
     createInfo.pNext = &deviceFeatures2;
 
     // might not really be necessary anymore because device specific validation layers
@@ -218,6 +307,28 @@ void Device::createLogicalDevice()
 
     vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
     vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+
+    if (timelineSemaphores_)
+    {
+        vkWaitSemaphoresKHR_ = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(device_, "vkWaitSemaphoresKHR");
+        vkGetSemaphoreCounterValueKHR_ = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(device_, "vkGetSemaphoreCounterValueKHR");
+        timelineSemaphores_ = vkWaitSemaphoresKHR_ != nullptr && vkGetSemaphoreCounterValueKHR_ != nullptr;
+    }
+    CORE_INFO("Timeline semaphores: {0}", timelineSemaphores_ ? "supported" : "not supported")
+
+    // Uploads go through a dedicated (DMA) queue when there is one, otherwise they share the graphics queue
+    if (indices.transferFamilyHasValue)
+    {
+        transferFamily_ = indices.transferFamily;
+        vkGetDeviceQueue(device_, indices.transferFamily, 0, &transferQueue_);
+        CORE_INFO("Using dedicated transfer queue family {0}", transferFamily_)
+    }
+    else
+    {
+        transferFamily_ = indices.graphicsFamily;
+        transferQueue_ = graphicsQueue_;
+        CORE_INFO("No dedicated transfer queue family, uploads will use the graphics queue")
+    }
 }
 
 void Device::createCommandPool()
@@ -378,6 +489,25 @@ bool Device::checkDeviceExtensionSupport(VkPhysicalDevice device)
     return requiredExtensions.empty();
 }
 
+bool Device::hasDeviceExtension(VkPhysicalDevice device, const char* extensionName)
+{
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions)
+    {
+        if (strcmp(extension.extensionName, extensionName) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device)
 {
     QueueFamilyIndices indices;
@@ -388,24 +518,36 @@ QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device)
     std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
+    // Families without graphics support that can transfer are candidates for the upload queue,
+    // a pure transfer family (no compute either) is usually the DMA engine so prefer that
+    bool transferFamilyIsPure = false;
+
     int i = 0;
     for (const auto& queueFamily : queueFamilies)
     {
-        if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+        if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT && !indices.graphicsFamilyHasValue)
         {
             indices.graphicsFamily = i;
             indices.graphicsFamilyHasValue = true;
         }
         VkBool32 presentSupport = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
-        if (queueFamily.queueCount > 0 && presentSupport)
+        if (queueFamily.queueCount > 0 && presentSupport && !indices.presentFamilyHasValue)
         {
             indices.presentFamily = i;
             indices.presentFamilyHasValue = true;
         }
-        if (indices.isComplete())
+
+        bool canTransfer = queueFamily.queueFlags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT);
+        if (queueFamily.queueCount > 0 && canTransfer && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT))
         {
-            break;
+            bool isPure = !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT);
+            if (!indices.transferFamilyHasValue || (isPure && !transferFamilyIsPure))
+            {
+                indices.transferFamily = i;
+                indices.transferFamilyHasValue = true;
+                transferFamilyIsPure = isPure;
+            }
         }
 
         i++;
@@ -463,6 +605,31 @@ VkFormat Device::findSupportedFormat(const std::vector<VkFormat>& candidates, Vk
     throw std::runtime_error("failed to find supported format!");
 }
 
+UploadContext& Device::getUploadContext()
+{
+    return *uploadContext;
+}
+
+StagingRing& Device::getStagingRing()
+{
+    return *stagingRing;
+}
+
+MeshPool& Device::getMeshPool()
+{
+    return *meshPool;
+}
+
+PipelineCache& Device::getPipelineCache()
+{
+    return *pipelineCache;
+}
+
+LayoutCache& Device::getLayoutCache()
+{
+    return *layoutCache;
+}
+
 uint32_t Device::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
 {
     VkPhysicalDeviceMemoryProperties memProperties;
@@ -479,7 +646,8 @@ uint32_t Device::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags prope
     throw std::runtime_error("failed to find suitable memory type!");
 }
 
-void Device::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+void Device::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& bufferMemory,
+    MemoryAllocationStrategy strategy)
 {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -495,17 +663,13 @@ void Device::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryP
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    uint32_t memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    bufferMemory = allocator.allocate(memRequirements, memoryTypeIndex, false, strategy);
 
-    if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
+    if (vkBindBufferMemory(device_, buffer, bufferMemory.memory, bufferMemory.offset) != VK_SUCCESS)
     {
-        throw std::runtime_error("failed to allocate vertex buffer memory!");
+        throw std::runtime_error("failed to bind buffer memory!");
     }
-
-    vkBindBufferMemory(device_, buffer, bufferMemory, 0);
 }
 
 VkCommandBuffer Device::beginSingleTimeCommands()
@@ -536,9 +700,17 @@ void Device::endSingleTimeCommands(VkCommandBuffer commandBuffer)
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue_);
+    // Only wait on this submission, not on frames that are still in flight
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence fence;
+    vkCreateFence(device_, &fenceInfo, nullptr, &fence);
 
+    vkQueueSubmit(graphicsQueue_, 1, &submitInfo, fence);
+    vkWaitForFences(device_, 1, &fence, VK_TRUE, UINT64_MAX);
+
+    vkDestroyFence(device_, fence, nullptr);
     vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
 }
 
@@ -582,7 +754,7 @@ void Device::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, u
     endSingleTimeCommands(commandBuffer);
 }
 
-void Device::createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory)
+void Device::createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, MemoryAllocation& imageMemory)
 {
     if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS)
     {
@@ -592,17 +764,10 @@ void Device::createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPro
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    uint32_t memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    imageMemory = allocator.allocate(memRequirements, memoryTypeIndex, true);
 
-    if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to allocate image memory!");
-    }
-
-    if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS)
+    if (vkBindImageMemory(device_, image, imageMemory.memory, imageMemory.offset) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to bind image memory!");
     }
@@ -671,3 +836,21 @@ void Device::transitionImageLayout(VkImage& image, VkFormat format, VkImageLayou
 
     endSingleTimeCommands(cmdBuffer);
 }
+
+VkResult Device::waitSemaphore(VkSemaphore semaphore, uint64_t value, uint64_t timeout)
+{
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &semaphore;
+    waitInfo.pValues = &value;
+
+    return vkWaitSemaphoresKHR_(device_, &waitInfo, timeout);
+}
+
+uint64_t Device::getSemaphoreValue(VkSemaphore semaphore)
+{
+    uint64_t value = 0;
+    vkGetSemaphoreCounterValueKHR_(device_, semaphore, &value);
+    return value;
+}
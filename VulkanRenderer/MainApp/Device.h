@@ -1,12 +1,20 @@
 #pragma once
 
 #include "Window.h"
+#include "MemoryAllocator.h"
 
 #include <string>
 #include <vector>
+#include <memory>
 
 #include <vulkan/vulkan.h>
 
+class UploadContext;
+class StagingRing;
+class MeshPool;
+class PipelineCache;
+class LayoutCache;
+
 struct SwapChainSupportDetails
 {
     VkSurfaceCapabilitiesKHR capabilities;
@@ -18,8 +26,10 @@ struct QueueFamilyIndices
 {
     uint32_t graphicsFamily;
     uint32_t presentFamily;
+    uint32_t transferFamily; // Only set when the device exposes a transfer family without graphics support
     bool graphicsFamilyHasValue = false;
     bool presentFamilyHasValue = false;
+    bool transferFamilyHasValue = false;
     bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 };
 
@@ -47,7 +57,20 @@ public:
     VkSurfaceKHR surface() { return surface_; }
     VkQueue graphicsQueue() { return graphicsQueue_; }
     VkQueue presentQueue() { return presentQueue_; }
+    // Falls back to the graphics queue when there is no dedicated transfer family
+    VkQueue transferQueue() { return transferQueue_; }
+    uint32_t transferQueueFamily() { return transferFamily_; }
+    bool hasDedicatedTransferQueue() { return transferQueue_ != graphicsQueue_; }
+    bool supportsMultiDrawIndirect() { return multiDrawIndirect_; }
+    bool supportsDrawIndirectFirstInstance() { return drawIndirectFirstInstance_; }
+    bool supportsTimelineSemaphores() { return timelineSemaphores_; }
     VkInstance getInstance() { return instance; }
+    MemoryAllocator& getAllocator() { return allocator; }
+    UploadContext& getUploadContext();
+    StagingRing& getStagingRing();
+    MeshPool& getMeshPool();
+    PipelineCache& getPipelineCache();
+    LayoutCache& getLayoutCache();
 
     SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -55,16 +78,23 @@ public:
     VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
     // Buffer Helper Functions
-    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& bufferMemory,
+        MemoryAllocationStrategy strategy = ALLOCATION_STRATEGY_FREE_LIST);
     VkCommandBuffer beginSingleTimeCommands();
     void endSingleTimeCommands(VkCommandBuffer commandBuffer);
     void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
     void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
-    void createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+    void createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, MemoryAllocation& imageMemory);
+    void freeMemory(MemoryAllocation& memory) { allocator.free(memory); }
     void transitionImageLayout(VkImage& image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
 
+    // Timeline semaphore helpers, only valid when supportsTimelineSemaphores() is true
+    VkResult waitSemaphore(VkSemaphore semaphore, uint64_t value, uint64_t timeout = UINT64_MAX);
+    uint64_t getSemaphoreValue(VkSemaphore semaphore);
+
     VkPhysicalDeviceProperties properties;
+    VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties;
 
 private:
     void createInstance();
@@ -82,6 +112,7 @@ private:
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
     void hasGflwRequiredInstanceExtensions();
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool hasDeviceExtension(VkPhysicalDevice device, const char* extensionName);
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
     VkInstance instance;
@@ -94,6 +125,26 @@ private:
     VkSurfaceKHR surface_;
     VkQueue graphicsQueue_;
     VkQueue presentQueue_;
+    VkQueue transferQueue_;
+    uint32_t transferFamily_;
+
+    bool multiDrawIndirect_ = false;
+    bool drawIndirectFirstInstance_ = false;
+    bool timelineSemaphores_ = false;
+
+    uint32_t instanceVersion_ = VK_API_VERSION_1_0;
+    bool physicalDeviceQueries2_ = false; // vkGetPhysicalDeviceProperties2 and vkGetPhysicalDeviceFeatures2 are usable
+
+    // The instance targets Vulkan 1.1 at most, so timeline semaphores come from VK_KHR_timeline_semaphore
+    PFN_vkWaitSemaphoresKHR vkWaitSemaphoresKHR_ = nullptr;
+    PFN_vkGetSemaphoreCounterValueKHR vkGetSemaphoreCounterValueKHR_ = nullptr;
+
+    MemoryAllocator allocator;
+    std::unique_ptr<StagingRing> stagingRing;
+    std::unique_ptr<UploadContext> uploadContext;
+    std::unique_ptr<MeshPool> meshPool;
+    std::unique_ptr<PipelineCache> pipelineCache;
+    std::unique_ptr<LayoutCache> layoutCache;
 
     const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
     const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
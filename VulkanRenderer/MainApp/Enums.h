@@ -7,6 +7,13 @@ enum RenderMode
 	UNLIT
 };
 
+enum CullingMode
+{
+	CULLING_GPU,
+	CULLING_CPU,
+	CULLING_NONE
+};
+
 enum LightType
 {
 	Point,
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "Camera.h"
-#include "GameObject.h"
+#include "Scene/Registry.h"
 #include "Enums.h"
 #include "Light.h"
 #include "Texture.h"
@@ -27,14 +27,6 @@ struct LightUbo
 	uint32_t numSpotLights;
 };
 
-struct MaterialUbo
-{
-	glm::vec4 albedo;
-	alignas(16) float roughness;
-	float ambientOcclusion;
-	float metalic;
-};
-
 struct FrameInfo
 {
 	int frameIndex;
@@ -47,7 +39,25 @@ struct FrameInfo
 	Camera& camera;
 	VkDescriptorSet globalDescriptorSet;
 	VkDescriptorSet materialDescriptorSet;
-	GameObject::Map &gameObjects;
-	VkDeviceSize dynamicOffset;
+	Registry& registry;
 	uint32_t numObjs;
+	class IndirectDrawList* drawList = nullptr;
+	class JobSystem* jobSystem = nullptr;
+	CullingMode cullingMode = CULLING_GPU;
+	bool occlusionCulling = false; // Culling also tests last frame's Hi-Z and redraws disoccluded objects in a second phase
+	uint32_t drawPhase = 0; // Which of the draw list's occlusion culling phases mesh systems draw
+	uint32_t firstDrawCommand = 0; // Range of the phase's draw commands mesh systems draw, the whole phase by default
+	uint32_t drawCommandCount = 0xFFFFFFFF;
+	uint32_t recordingThreadCount = 1; // Threads that recorded the previous frame's render pass
+	float recordTime = 0.0f; // Milliseconds the previous frame spent recording its render pass
+	bool threadedSimulation = false; // Whether the scene is drawn from a snapshot of the simulation thread
+	uint64_t simulationTick = 0; // Tick that snapshot was taken after
+	uint32_t framesInFlight = 2;
+	bool lowLatency = false; // Input is read only once the GPU has finished every earlier frame
+	bool timelinePacing = false; // Frames are paced with a timeline semaphore rather than fences
+	float inputLatency = 0.0f; // Smoothed milliseconds from reading input to the GPU finishing the frame
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR; // The swap chain's actual mode, after any fallback
+	bool uncappedBenchmark = false;
+	uint32_t benchmarkFrameCount = 0; // Frames since the uncapped benchmark was enabled
+	float benchmarkFrameTime = 0.0f; // Their average, in milliseconds
 };
@@ -0,0 +1,180 @@
+#include "FrustumCuller.h"
+#include "Log.h"
+
+#include <xmmintrin.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+void FrustumCuller::clear()
+{
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	radius.clear();
+	count = 0;
+}
+
+void FrustumCuller::reserve(uint32_t count)
+{
+	uint32_t paddedCount = (count + 3) & ~3u;
+	centerX.reserve(paddedCount);
+	centerY.reserve(paddedCount);
+	centerZ.reserve(paddedCount);
+	radius.reserve(paddedCount);
+}
+
+uint32_t FrustumCuller::addSphere(const glm::vec3& center, float sphereRadius)
+{
+	// Overwrite the padding lane if there is one, otherwise open a new group of four
+	if (count % 4 == 0)
+	{
+		for (int lane = 0; lane < 4; lane++)
+		{
+			centerX.push_back(0.0f);
+			centerY.push_back(0.0f);
+			centerZ.push_back(0.0f);
+			radius.push_back(-1.0f);
+		}
+	}
+
+	centerX[count] = center.x;
+	centerY[count] = center.y;
+	centerZ[count] = center.z;
+	radius[count] = sphereRadius;
+	return count++;
+}
+
+void FrustumCuller::resize(uint32_t count)
+{
+	// Lanes past count keep the padding radius
+	uint32_t paddedCount = (count + 3) & ~3u;
+	centerX.assign(paddedCount, 0.0f);
+	centerY.assign(paddedCount, 0.0f);
+	centerZ.assign(paddedCount, 0.0f);
+	radius.assign(paddedCount, -1.0f);
+	this->count = count;
+}
+
+void FrustumCuller::setSphere(uint32_t index, const glm::vec3& center, float sphereRadius)
+{
+	centerX[index] = center.x;
+	centerY[index] = center.y;
+	centerZ[index] = center.z;
+	radius[index] = sphereRadius;
+}
+
+void FrustumCuller::cull(const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& outVisible, uint32_t firstSphere, uint32_t sphereCount) const
+{
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; p++)
+	{
+		planeX[p] = _mm_set1_ps(planes[p].x);
+		planeY[p] = _mm_set1_ps(planes[p].y);
+		planeZ[p] = _mm_set1_ps(planes[p].z);
+		planeW[p] = _mm_set1_ps(planes[p].w);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	const uint32_t endSphere = std::min(firstSphere + ((sphereCount + 3) & ~3u), static_cast<uint32_t>(radius.size()));
+
+	for (uint32_t i = firstSphere; i < endSphere; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&centerX[i]);
+		__m128 y = _mm_loadu_ps(&centerY[i]);
+		__m128 z = _mm_loadu_ps(&centerZ[i]);
+		__m128 r = _mm_loadu_ps(&radius[i]);
+		__m128 negRadius = _mm_sub_ps(zero, r);
+
+		// Padding lanes have a negative radius and start out rejected
+		__m128 inside = _mm_cmpge_ps(r, zero);
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		if (mask == 0)
+			continue;
+
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			if (mask & (1 << lane))
+				outVisible.push_back(i + lane);
+		}
+	}
+}
+
+void FrustumCuller::cullScalar(const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& outVisible) const
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; p++)
+		{
+			float distance = planes[p].x * centerX[i] + planes[p].y * centerY[i] + planes[p].z * centerZ[i] + planes[p].w;
+			inside = distance >= -radius[i];
+		}
+
+		if (inside)
+			outVisible.push_back(i);
+	}
+}
+
+void FrustumCuller::benchmark(uint32_t objectCount, uint32_t iterations)
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+	FrustumCuller culler;
+	culler.reserve(objectCount);
+	for (uint32_t i = 0; i < objectCount; i++)
+	{
+		culler.addSphere(glm::vec3(position(rng), position(rng), position(rng)), size(rng));
+	}
+
+	// Axis aligned box covering roughly a quarter of the volume, so both outcomes are common
+	std::array<glm::vec4, 6> planes =
+	{
+		glm::vec4( 1.0f, 0.0f, 0.0f, 50.0f),
+		glm::vec4(-1.0f, 0.0f, 0.0f, 50.0f),
+		glm::vec4( 0.0f, 1.0f, 0.0f, 50.0f),
+		glm::vec4( 0.0f,-1.0f, 0.0f, 50.0f),
+		glm::vec4( 0.0f, 0.0f, 1.0f, 100.0f),
+		glm::vec4( 0.0f, 0.0f,-1.0f, 100.0f)
+	};
+
+	std::vector<uint32_t> visible;
+	visible.reserve(objectCount);
+
+	auto run = [&](bool simd)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < iterations; i++)
+		{
+			visible.clear();
+			if (simd)
+				culler.cull(planes, visible);
+			else
+				culler.cullScalar(planes, visible);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+	};
+
+	double scalarTime = run(false);
+	size_t scalarVisible = visible.size();
+	double simdTime = run(true);
+
+	if (visible.size() != scalarVisible)
+	{
+		CORE_ERROR("Culling benchmark mismatch: SIMD found {0} visible, scalar found {1}", visible.size(), scalarVisible)
+	}
+
+	CORE_INFO("Culling benchmark ({0} objects, {1} visible): scalar {2:.3f} ms, SSE {3:.3f} ms ({4:.2f}x)", objectCount, visible.size(),
+		scalarTime, simdTime, simdTime > 0.0 ? scalarTime / simdTime : 0.0)
+}
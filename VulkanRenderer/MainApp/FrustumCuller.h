@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+/*
+ * CPU frustum culling over a structure-of-arrays table of world space bounding spheres. Spheres are
+ * tested four at a time with SSE, which every x64 target supports, so no extra compiler flags are
+ * needed. Used instead of the compute culling pass when that pass can't drop instances.
+ */
+class FrustumCuller
+{
+public:
+	void clear();
+	void reserve(uint32_t count);
+
+	// Returns the index the sphere was stored at, which is what cull() reports back
+	uint32_t addSphere(const glm::vec3& center, float radius);
+
+	// Makes room for count spheres to be filled in with setSphere(), which may run on several threads
+	void resize(uint32_t count);
+	void setSphere(uint32_t index, const glm::vec3& center, float radius);
+
+	// Appends the indices of the spheres that intersect the frustum, in ascending order. A range has to
+	// start at a multiple of four, so that ranges culled on different threads never share a group.
+	void cull(const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& outVisible) const { cull(planes, outVisible, 0, count); }
+	void cull(const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& outVisible, uint32_t firstSphere, uint32_t sphereCount) const;
+	void cullScalar(const std::array<glm::vec4, 6>& planes, std::vector<uint32_t>& outVisible) const;
+
+	uint32_t getCount() const { return count; }
+
+	// Times the SIMD and scalar paths over randomly placed spheres and logs the results
+	static void benchmark(uint32_t objectCount = 100000, uint32_t iterations = 100);
+
+private:
+	// Lanes past count are padded with spheres that always fail the test
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radius;
+
+	uint32_t count = 0;
+};
@@ -0,0 +1,302 @@
+#include "HiZPyramid.h"
+#include "Pipeline.h"
+#include "PipelineBatch.h"
+#include "LayoutCache.h"
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <cassert>
+
+struct HiZPushConstants
+{
+	glm::uvec2 inputSize;
+	glm::uvec2 outputSize;
+};
+
+static const char* SHADER_PATH = "MainApp/resources/vulkan/shaders/HiZDownsampleComp.spv";
+
+HiZPyramid::HiZPyramid(Device& device)
+	: device{ device }
+{
+}
+
+HiZPyramid::~HiZPyramid()
+{
+	cleanup();
+}
+
+void HiZPyramid::init(PipelineBatch& batch)
+{
+	// Only read with texelFetch, but combined image samplers still need one
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	if (vkCreateSampler(device.getDevice(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create Hi-Z sampler!");
+	}
+
+	createPipeline(batch);
+}
+
+void HiZPyramid::cleanup()
+{
+	cleanupResources();
+
+	pipeline.reset();
+	pipelineLayout = VK_NULL_HANDLE;
+
+	if (sampler != VK_NULL_HANDLE)
+	{
+		vkDestroySampler(device.getDevice(), sampler, nullptr);
+		sampler = VK_NULL_HANDLE;
+	}
+
+	setLayout = nullptr;
+}
+
+void HiZPyramid::createResources(RenderPass& renderPass)
+{
+	cleanupResources();
+
+	depthWidth = renderPass.width;
+	depthHeight = renderPass.height;
+	width = std::max((depthWidth + 1) / 2, 1u);
+	height = std::max((depthHeight + 1) / 2, 1u);
+
+	mipCount = 1;
+	while ((std::max(width, height) >> mipCount) > 0)
+	{
+		mipCount++;
+	}
+
+	bool hasStencil = renderPass.depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || renderPass.depthFormat == VK_FORMAT_D24_UNORM_S8_UINT;
+	depthAspect = hasStencil ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = width;
+	imageInfo.extent.height = height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = mipCount;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = VK_FORMAT_R32_SFLOAT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, memory);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R32_SFLOAT;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = mipCount;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(device.getDevice(), &viewInfo, nullptr, &fullView) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create Hi-Z image view!");
+	}
+
+	mipViews.resize(mipCount);
+	for (uint32_t i = 0; i < mipCount; i++)
+	{
+		viewInfo.subresourceRange.baseMipLevel = i;
+		viewInfo.subresourceRange.levelCount = 1;
+		if (vkCreateImageView(device.getDevice(), &viewInfo, nullptr, &mipViews[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Hi-Z mip view!");
+		}
+	}
+
+	uint32_t depthCount = static_cast<uint32_t>(renderPass.depths.size());
+	uint32_t setCount = depthCount + mipCount - 1;
+	descriptorPool = DescriptorPool::Builder(device)
+		.setMaxSets(setCount)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, setCount)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, setCount)
+		.build();
+
+	VkDescriptorImageInfo outputInfo{};
+	outputInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+	outputInfo.imageView = mipViews[0];
+
+	depthImages.resize(depthCount);
+	depthSets.resize(depthCount);
+	for (uint32_t i = 0; i < depthCount; i++)
+	{
+		depthImages[i] = renderPass.depths[i].image;
+
+		VkDescriptorImageInfo inputInfo{};
+		inputInfo.sampler = sampler;
+		inputInfo.imageView = renderPass.depths[i].view;
+		inputInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+		DescriptorWriter(*setLayout, *descriptorPool)
+			.writeImage(0, &inputInfo)
+			.writeImage(1, &outputInfo)
+			.build(depthSets[i]);
+	}
+
+	mipSets.resize(mipCount - 1);
+	for (uint32_t i = 1; i < mipCount; i++)
+	{
+		VkDescriptorImageInfo inputInfo{};
+		inputInfo.sampler = sampler;
+		inputInfo.imageView = mipViews[i - 1];
+		inputInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		outputInfo.imageView = mipViews[i];
+
+		DescriptorWriter(*setLayout, *descriptorPool)
+			.writeImage(0, &inputInfo)
+			.writeImage(1, &outputInfo)
+			.build(mipSets[i - 1]);
+	}
+
+	needsLayoutInit = true;
+}
+
+void HiZPyramid::cleanupResources()
+{
+	depthSets.clear();
+	mipSets.clear();
+	depthImages.clear();
+	descriptorPool = nullptr;
+
+	for (VkImageView view : mipViews)
+	{
+		vkDestroyImageView(device.getDevice(), view, nullptr);
+	}
+	mipViews.clear();
+
+	if (fullView != VK_NULL_HANDLE)
+	{
+		vkDestroyImageView(device.getDevice(), fullView, nullptr);
+		fullView = VK_NULL_HANDLE;
+	}
+
+	if (image != VK_NULL_HANDLE)
+	{
+		vkDestroyImage(device.getDevice(), image, nullptr);
+		device.freeMemory(memory);
+		image = VK_NULL_HANDLE;
+	}
+}
+
+void HiZPyramid::build(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+	assert(imageIndex < depthImages.size() && "No Hi-Z input for this framebuffer!");
+
+	// Depth writes from the render pass become shader reads, earlier culling reads of the pyramid must finish before it is overwritten
+	VkImageMemoryBarrier barriers[2]{};
+	barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[0].image = depthImages[imageIndex];
+	barriers[0].subresourceRange = { depthAspect, 0, 1, 0, 1 };
+
+	barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barriers[1].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barriers[1].oldLayout = needsLayoutInit ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_GENERAL;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barriers[1].image = image;
+	barriers[1].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipCount, 0, 1 };
+
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers);
+	needsLayoutInit = false;
+
+	pipeline->bindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+	uint32_t inputWidth = depthWidth;
+	uint32_t inputHeight = depthHeight;
+	for (uint32_t level = 0; level < mipCount; level++)
+	{
+		uint32_t outputWidth = std::max(width >> level, 1u);
+		uint32_t outputHeight = std::max(height >> level, 1u);
+
+		VkDescriptorSet set = level == 0 ? depthSets[imageIndex] : mipSets[level - 1];
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &set, 0, nullptr);
+
+		HiZPushConstants push{};
+		push.inputSize = glm::uvec2(inputWidth, inputHeight);
+		push.outputSize = glm::uvec2(outputWidth, outputHeight);
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HiZPushConstants), &push);
+
+		vkCmdDispatch(commandBuffer, (outputWidth + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, (outputHeight + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+
+		// Read by the next level and by the culling pass
+		VkImageMemoryBarrier mipBarrier{};
+		mipBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		mipBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		mipBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		mipBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		mipBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		mipBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		mipBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		mipBarrier.image = image;
+		mipBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &mipBarrier);
+
+		inputWidth = outputWidth;
+		inputHeight = outputHeight;
+	}
+
+	// Hand the depth attachment back for the rest of the frame
+	VkImageMemoryBarrier depthBarrier = barriers[0];
+	depthBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, 0, 0, nullptr, 0, nullptr, 1, &depthBarrier);
+}
+
+VkDescriptorImageInfo HiZPyramid::getDescriptorInfo() const
+{
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.sampler = sampler;
+	imageInfo.imageView = fullView;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+	return imageInfo;
+}
+
+void HiZPyramid::createPipeline(PipelineBatch& batch)
+{
+	ShaderReflection shaders({ SHADER_PATH });
+	if (shaders.getPushConstantSize() != sizeof(HiZPushConstants))
+		throw std::runtime_error("HiZDownsample.comp push constants don't match HiZPushConstants!");
+
+	// Input depth and output mip
+	setLayout = &device.getLayoutCache().getSetLayout(shaders, 0);
+	pipelineLayout = device.getLayoutCache().getPipelineLayout(shaders, { setLayout->getDescriptorSetLayout() });
+
+	batch.addComputePipeline(pipeline, SHADER_PATH, pipelineLayout);
+}
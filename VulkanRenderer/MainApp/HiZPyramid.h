@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Device.h"
+#include "Descriptors.h"
+#include "RenderPass.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <memory>
+
+/*
+ * Hierarchical depth buffer for occlusion culling. Each build downsamples a swap chain depth
+ * attachment into an R32_SFLOAT mip chain with compute, keeping the farthest depth of every 2x2
+ * block. Mip 0 is half the depth resolution, rounded up so edge texels are never lost. The image
+ * stays in VK_IMAGE_LAYOUT_GENERAL so it can be read by the culling pass at any time.
+ */
+class HiZPyramid
+{
+public:
+	HiZPyramid(Device& device);
+	~HiZPyramid();
+
+	HiZPyramid(const HiZPyramid&) = delete;
+	HiZPyramid& operator=(const HiZPyramid&) = delete;
+
+	// The downsample pipeline is added to the batch, the pyramid can't be built until it is
+	void init(class PipelineBatch& batch);
+	void cleanup();
+
+	// Sized to the render pass, call again whenever the swap chain is recreated
+	void createResources(RenderPass& renderPass);
+	void cleanupResources();
+
+	// Must be recorded outside a render pass, the depth attachment is returned to its attachment layout afterwards
+	void build(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+
+	VkDescriptorImageInfo getDescriptorInfo() const;
+	uint32_t getMipCount() const { return mipCount; }
+	glm::vec2 getDepthSize() const { return glm::vec2(static_cast<float>(depthWidth), static_cast<float>(depthHeight)); }
+
+private:
+	void createPipeline(class PipelineBatch& batch);
+
+	Device& device;
+
+	DescriptorSetLayout* setLayout = nullptr; // Owned by the device's layout cache
+	std::unique_ptr<DescriptorPool> descriptorPool;
+	std::vector<VkDescriptorSet> depthSets; // Mip 0 from each framebuffer's depth attachment
+	std::vector<VkDescriptorSet> mipSets; // Mip i from mip i - 1
+
+	std::unique_ptr<class Pipeline> pipeline;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE; // Owned by the device's layout cache
+	VkSampler sampler = VK_NULL_HANDLE;
+
+	VkImage image = VK_NULL_HANDLE;
+	MemoryAllocation memory{};
+	VkImageView fullView = VK_NULL_HANDLE;
+	std::vector<VkImageView> mipViews;
+
+	std::vector<VkImage> depthImages;
+	VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t mipCount = 0;
+	uint32_t depthWidth = 0;
+	uint32_t depthHeight = 0;
+
+	bool needsLayoutInit = true;
+
+	static constexpr uint32_t WORKGROUP_SIZE = 8;
+};
@@ -0,0 +1,354 @@
+#include "IndirectDrawList.h"
+#include "SwapChain.h"
+#include "MeshPool.h"
+#include "Log.h"
+#include "Material.h"
+
+#include <algorithm>
+#include <cstring>
+
+IndirectDrawList::IndirectDrawList(Device& device)
+	: device{device}
+{
+}
+
+IndirectDrawList::~IndirectDrawList()
+{
+	cleanup();
+}
+
+void IndirectDrawList::init(uint32_t maxObjects)
+{
+	this->maxObjects = std::max(maxObjects, 1u);
+
+	objectBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+	commandBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+	visibleBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+	statsBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+	frameObjectCounts.assign(SwapChain::MAX_FRAMES_IN_FLIGHT, 0);
+	for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		objectBuffers[i] = std::make_unique<Buffer>(device, sizeof(ObjectData), this->maxObjects, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		objectBuffers[i]->map();
+
+		// Worst case is one command per object and phase, instance counts are filled in by the culling pass
+		commandBuffers[i] = std::make_unique<Buffer>(device, sizeof(VkDrawIndexedIndirectCommand), this->maxObjects * PHASE_COUNT,
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		commandBuffers[i]->map();
+
+		visibleBuffers[i] = std::make_unique<Buffer>(device, sizeof(uint32_t), this->maxObjects * PHASE_COUNT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		statsBuffers[i] = std::make_unique<Buffer>(device, sizeof(CullStats), 1, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		statsBuffers[i]->map();
+		memset(statsBuffers[i]->getMappedMemory(), 0, sizeof(CullStats));
+	}
+
+	drawItems.reserve(this->maxObjects);
+	commands.reserve(this->maxObjects);
+}
+
+void IndirectDrawList::cleanup()
+{
+	objectBuffers.clear();
+	commandBuffers.clear();
+	visibleBuffers.clear();
+	statsBuffers.clear();
+}
+
+void IndirectDrawList::build(int frameIndex, Registry& registry, const std::array<glm::vec4, 6>* cullPlanes, JobSystem* jobSystem)
+{
+	beginBuild(frameIndex);
+
+	registry.each<MeshComponent, MaterialComponent, TransformComponent>([this](Entity entity, MeshComponent& mesh, MaterialComponent& materialComp,
+		TransformComponent& transform)
+	{
+		if (mesh.model && materialComp.material)
+			addDrawItem({ mesh.model.get(), materialComp.material.get(), &transform.getTransform(), &transform.getNormalMatrix(),
+				materialComp.material->getFeatures() });
+	});
+
+	endBuild(frameIndex, cullPlanes, jobSystem);
+}
+
+void IndirectDrawList::build(int frameIndex, const RenderSnapshot& snapshot, const std::array<glm::vec4, 6>* cullPlanes, JobSystem* jobSystem)
+{
+	beginBuild(frameIndex);
+
+	for (const RenderObject& object : snapshot.objects)
+	{
+		addDrawItem({ object.model.get(), object.material.get(), &object.modelMatrix, &object.normalMatrix, object.material->getFeatures() });
+	}
+
+	endBuild(frameIndex, cullPlanes, jobSystem);
+}
+
+void IndirectDrawList::beginBuild(int frameIndex)
+{
+	drawItems.clear();
+	commands.clear();
+	directDraws.clear();
+	drawGroups.clear();
+
+	lastDrawCallCount = drawCallCount.exchange(0);
+
+	// This frame's fence has been waited on, so the culling results it last produced are complete
+	CullStats* stats = static_cast<CullStats*>(statsBuffers[frameIndex]->getMappedMemory());
+	visibleCount = stats->visibleCount;
+	culledCount = frameObjectCounts[frameIndex] > visibleCount ? frameObjectCounts[frameIndex] - visibleCount : 0;
+	occludedCount = stats->occludedCount;
+	disoccludedCount = stats->disoccludedCount;
+	*stats = CullStats{};
+}
+
+void IndirectDrawList::addDrawItem(const DrawItem& item)
+{
+	if (drawItems.size() == maxObjects)
+	{
+		if (!warnedOverflow)
+		{
+			CORE_WARN("Indirect draw list is full ({0} objects), remaining objects will not be drawn", maxObjects)
+			warnedOverflow = true;
+		}
+		return;
+	}
+
+	drawItems.push_back(item);
+}
+
+void IndirectDrawList::endBuild(int frameIndex, const std::array<glm::vec4, 6>* cullPlanes, JobSystem* jobSystem)
+{
+	// Culled counts are relative to every candidate, whichever stage dropped them
+	frameObjectCounts[frameIndex] = static_cast<uint32_t>(drawItems.size());
+
+	if (cullPlanes)
+	{
+		cullDrawItems(*cullPlanes, jobSystem);
+	}
+
+	// Features first, so every pipeline permutation draws one contiguous range
+	std::sort(drawItems.begin(), drawItems.end(), [](const DrawItem& a, const DrawItem& b)
+	{
+		if (a.materialFeatures != b.materialFeatures)
+			return a.materialFeatures < b.materialFeatures;
+		if (a.model != b.model)
+			return std::less<Model*>()(a.model, b.model);
+		return std::less<Material*>()(a.material, b.material);
+	});
+
+	ObjectData* objects = static_cast<ObjectData*>(objectBuffers[frameIndex]->getMappedMemory());
+	for (uint32_t i = 0; i < static_cast<uint32_t>(drawItems.size()); i++)
+	{
+		DrawItem& item = drawItems[i];
+
+		ObjectData& data = objects[i];
+		data.modelMatrix = *item.modelMatrix;
+		data.normalMatrix = *item.normalMatrix;
+		data.materialIndex = item.material->getMaterialIndex();
+
+		const ModelBounds& bounds = item.model->getBounds();
+		data.boundingSphere = glm::vec4(bounds.center, bounds.radius);
+
+		if (i == 0 || drawItems[i - 1].materialFeatures != item.materialFeatures)
+		{
+			DrawGroup group{ item.materialFeatures };
+			group.range.firstCommand = static_cast<uint32_t>(commands.size());
+			group.range.firstDirectDraw = static_cast<uint32_t>(directDraws.size());
+			drawGroups.push_back(group);
+		}
+
+		bool sameGroup = i > 0 && drawItems[i - 1].model == item.model && drawItems[i - 1].material == item.material;
+
+		if (!item.model->hasIndices())
+		{
+			data.commandIndex = DIRECT_DRAW_COMMAND;
+			if (sameGroup)
+				directDraws.back().instanceCount++;
+			else
+				directDraws.push_back({ item.model, i, 1 });
+			continue;
+		}
+
+		if (sameGroup)
+		{
+			commands.back().instanceCount++;
+			data.commandIndex = static_cast<uint32_t>(commands.size() - 1);
+			continue;
+		}
+
+		VkDrawIndexedIndirectCommand command{};
+		command.indexCount = item.model->getIndexCount();
+		command.instanceCount = 1;
+		command.firstIndex = item.model->getFirstIndex();
+		command.vertexOffset = item.model->getVertexOffset();
+		command.firstInstance = i;
+		data.commandIndex = static_cast<uint32_t>(commands.size());
+		commands.push_back(command);
+	}
+
+	// Each group ends where the next one starts
+	for (size_t i = 0; i < drawGroups.size(); i++)
+	{
+		DrawRange& range = drawGroups[i].range;
+		bool last = i + 1 == drawGroups.size();
+		range.commandCount = (last ? static_cast<uint32_t>(commands.size()) : drawGroups[i + 1].range.firstCommand) - range.firstCommand;
+		range.directDrawCount = (last ? static_cast<uint32_t>(directDraws.size()) : drawGroups[i + 1].range.firstDirectDraw) - range.firstDirectDraw;
+	}
+
+	// The CPU copy keeps full instance counts for the direct draw fallback
+	VkDrawIndexedIndirectCommand* gpuCommands = static_cast<VkDrawIndexedIndirectCommand*>(commandBuffers[frameIndex]->getMappedMemory());
+	for (uint32_t phase = 0; phase < PHASE_COUNT; phase++)
+	{
+		VkDrawIndexedIndirectCommand* phaseCommands = gpuCommands + phase * maxObjects;
+		for (size_t i = 0; i < commands.size(); i++)
+		{
+			phaseCommands[i] = commands[i];
+			phaseCommands[i].instanceCount = 0;
+			phaseCommands[i].firstInstance += phase * maxObjects;
+		}
+	}
+}
+
+void IndirectDrawList::cullDrawItems(const std::array<glm::vec4, 6>& planes, JobSystem* jobSystem)
+{
+	const uint32_t itemCount = static_cast<uint32_t>(drawItems.size());
+	cpuCuller.resize(itemCount);
+
+	auto cullBatch = [this, &planes](uint32_t begin, uint32_t end, std::vector<uint32_t>& outVisible)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			const DrawItem& item = drawItems[i];
+			const ModelBounds& bounds = item.model->getBounds();
+			const glm::mat4& modelMatrix = *item.modelMatrix;
+			glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(bounds.center, 1.0f));
+
+			// Largest axis scale keeps the sphere conservative under non-uniform scaling
+			float scale = std::max(std::max(glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1]))),
+				glm::length(glm::vec3(modelMatrix[2])));
+
+			cpuCuller.setSphere(i, center, bounds.radius * scale);
+		}
+
+		cpuCuller.cull(planes, outVisible, begin, end - begin);
+	};
+
+	cpuVisible.clear();
+	if (!jobSystem || itemCount <= CULL_BATCH_SIZE)
+	{
+		cullBatch(0, itemCount, cpuVisible);
+	}
+	else
+	{
+		const uint32_t batchCount = (itemCount + CULL_BATCH_SIZE - 1) / CULL_BATCH_SIZE;
+		if (batchVisible.size() < batchCount)
+			batchVisible.resize(batchCount);
+
+		jobSystem->parallelFor(itemCount, CULL_BATCH_SIZE, [this, &cullBatch](uint32_t begin, uint32_t end, uint32_t)
+		{
+			std::vector<uint32_t>& visible = batchVisible[begin / CULL_BATCH_SIZE];
+			visible.clear();
+			cullBatch(begin, end, visible);
+		});
+
+		// Batches are in order and so are the indices within them
+		for (uint32_t i = 0; i < batchCount; i++)
+		{
+			cpuVisible.insert(cpuVisible.end(), batchVisible[i].begin(), batchVisible[i].end());
+		}
+	}
+
+	// Visible indices are ascending, so the surviving items can be compacted in place
+	for (uint32_t i = 0; i < static_cast<uint32_t>(cpuVisible.size()); i++)
+	{
+		drawItems[i] = drawItems[cpuVisible[i]];
+	}
+	drawItems.resize(cpuVisible.size());
+}
+
+void IndirectDrawList::draw(VkCommandBuffer commandBuffer, int frameIndex, uint32_t phase, uint32_t firstCommand, uint32_t commandCount)
+{
+	DrawRange all{ 0, static_cast<uint32_t>(commands.size()), 0, static_cast<uint32_t>(directDraws.size()) };
+	draw(commandBuffer, frameIndex, phase, clipRange(all, phase, firstCommand, commandCount));
+}
+
+DrawRange IndirectDrawList::getGroupRange(const DrawGroup& group, uint32_t phase, uint32_t firstCommand, uint32_t commandCount) const
+{
+	return clipRange(group.range, phase, firstCommand, commandCount);
+}
+
+DrawRange IndirectDrawList::clipRange(const DrawRange& range, uint32_t phase, uint32_t firstCommand, uint32_t commandCount)
+{
+	const uint64_t rangeEnd = static_cast<uint64_t>(range.firstCommand) + range.commandCount;
+	const uint64_t begin = std::clamp<uint64_t>(firstCommand, range.firstCommand, rangeEnd);
+	const uint64_t end = std::clamp<uint64_t>(static_cast<uint64_t>(firstCommand) + commandCount, begin, rangeEnd);
+
+	DrawRange clipped{};
+	clipped.firstCommand = static_cast<uint32_t>(begin);
+	clipped.commandCount = static_cast<uint32_t>(end - begin);
+
+	// Non-indexed models are rare enough to be drawn directly, and are never occlusion culled
+	if (phase == 0 && firstCommand == 0)
+	{
+		clipped.firstDirectDraw = range.firstDirectDraw;
+		clipped.directDrawCount = range.directDrawCount;
+	}
+	return clipped;
+}
+
+void IndirectDrawList::draw(VkCommandBuffer commandBuffer, int frameIndex, uint32_t phase, const DrawRange& range)
+{
+	if (range.isEmpty())
+		return;
+
+	// Only GPU culling fills the second phase, which needs indirect firstInstance
+	if (phase > 0 && !device.supportsDrawIndirectFirstInstance())
+		return;
+
+	VkBuffer indirectBuffer = commandBuffers[frameIndex]->getBuffer();
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+	const VkDeviceSize commandOffset = (static_cast<VkDeviceSize>(phase) * maxObjects + range.firstCommand) * stride;
+
+	device.getMeshPool().bind(commandBuffer);
+
+	// Counted locally so concurrent ranges only touch the shared counter once
+	uint32_t drawCalls = 0;
+
+	if (!device.supportsDrawIndirectFirstInstance())
+	{
+		// A non-zero firstInstance is only allowed in direct draws without this feature
+		for (uint32_t i = range.firstCommand; i < range.firstCommand + range.commandCount; i++)
+		{
+			const VkDrawIndexedIndirectCommand& command = commands[i];
+			vkCmdDrawIndexed(commandBuffer, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+		}
+		drawCalls += range.commandCount;
+	}
+	else if (device.supportsMultiDrawIndirect())
+	{
+		if (range.commandCount > 0)
+		{
+			vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer, commandOffset, range.commandCount, stride);
+			drawCalls++;
+		}
+	}
+	else
+	{
+		for (uint32_t i = 0; i < range.commandCount; i++)
+		{
+			vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer, commandOffset + i * stride, 1, stride);
+		}
+		drawCalls += range.commandCount;
+	}
+
+	for (uint32_t i = range.firstDirectDraw; i < range.firstDirectDraw + range.directDrawCount; i++)
+	{
+		const DirectDraw& directDraw = directDraws[i];
+		directDraw.model->draw(commandBuffer, directDraw.instanceCount, directDraw.firstInstance);
+		drawCalls++;
+	}
+
+	drawCallCount += drawCalls;
+}
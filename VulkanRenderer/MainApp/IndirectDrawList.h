@@ -0,0 +1,172 @@
+#pragma once
+
+#include "Device.h"
+#include "Buffer.h"
+#include "Scene/Registry.h"
+#include "Scene/RenderSnapshot.h"
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+
+#include <vector>
+#include <memory>
+#include <atomic>
+
+// Per-object shader data, looked up through the visible index buffer with gl_InstanceIndex
+struct ObjectData
+{
+	glm::mat4 modelMatrix{ 1.0f };
+	glm::mat4 normalMatrix{ 1.0f };
+	uint32_t materialIndex = 0; // Index into the material table
+	uint32_t commandIndex = 0; // Draw command this object is an instance of
+	alignas(16) glm::vec4 boundingSphere{ 0.0f }; // Object space center and radius
+};
+
+// Counters written by the culling pass, matches StatsBuffer in FrustumCull.comp
+struct CullStats
+{
+	uint32_t visibleCount = 0;
+	uint32_t occludedCount = 0; // Rejected by both occlusion tests
+	uint32_t disoccludedCount = 0; // Rejected by last frame's Hi-Z but drawn in the second phase
+};
+
+// Draw commands [firstCommand, firstCommand + commandCount) of a phase and the direct draws that go with them
+struct DrawRange
+{
+	uint32_t firstCommand = 0;
+	uint32_t commandCount = 0;
+	uint32_t firstDirectDraw = 0;
+	uint32_t directDrawCount = 0;
+
+	bool isEmpty() const { return commandCount == 0 && directDrawCount == 0; }
+};
+
+// Objects whose materials use the same MaterialFeatureFlags, contiguous in the draw list
+struct DrawGroup
+{
+	uint32_t materialFeatures;
+	DrawRange range;
+};
+
+/*
+ * Builds the object storage buffer and the VkDrawIndexedIndirectCommand buffer that every mesh render
+ * system draws from, once per frame. Objects are sorted by material features, model and material. Each
+ * model and material pair becomes one instanced command whose firstInstance points at its slots in the
+ * visible index buffer, and the commands of each set of features form a group that can be drawn with
+ * its own pipeline. The commands are uploaded with no instances; the culling pass appends the visible
+ * objects to them on the GPU. Commands and instance slots exist once per draw phase: the second phase
+ * holds objects that the occlusion test against last frame's Hi-Z rejected but that turn out visible
+ * in this frame's. Every model lives in the device's mesh pool, so the whole list is bound once, and a
+ * phase is issued with one vkCmdDrawIndexedIndirect per draw group, or a single one when it is drawn
+ * without groups. A phase can also be drawn as ranges of commands, so several threads can record it
+ * into their own secondary command buffers.
+ */
+class IndirectDrawList
+{
+public:
+	IndirectDrawList(Device& device);
+	~IndirectDrawList();
+
+	IndirectDrawList(const IndirectDrawList&) = delete;
+	IndirectDrawList& operator=(const IndirectDrawList&) = delete;
+
+	void init(uint32_t maxObjects);
+	void cleanup();
+
+	// Objects outside the planes are dropped on the CPU when they are given, before any GPU culling.
+	// The CPU culling is spread over the job system when there is one.
+	void build(int frameIndex, Registry& registry, const std::array<glm::vec4, 6>* cullPlanes = nullptr, JobSystem* jobSystem = nullptr);
+	// Same, from a snapshot published by the simulation thread instead of the live scene
+	void build(int frameIndex, const RenderSnapshot& snapshot, const std::array<glm::vec4, 6>* cullPlanes = nullptr, JobSystem* jobSystem = nullptr);
+	// Draws commands [firstCommand, firstCommand + commandCount) of a phase, direct draws go with the range starting at 0.
+	// Ranges may be recorded from several threads at once.
+	void draw(VkCommandBuffer commandBuffer, int frameIndex, uint32_t phase = 0, uint32_t firstCommand = 0, uint32_t commandCount = ALL_COMMANDS);
+	void draw(VkCommandBuffer commandBuffer, int frameIndex, uint32_t phase, const DrawRange& range);
+	// The part of a group that drawing [firstCommand, firstCommand + commandCount) of a phase covers, empty if none
+	DrawRange getGroupRange(const DrawGroup& group, uint32_t phase, uint32_t firstCommand, uint32_t commandCount) const;
+
+	VkDescriptorBufferInfo getObjectBufferInfo(int frameIndex) { return objectBuffers[frameIndex]->descriptorInfo(); }
+	VkDescriptorBufferInfo getCommandBufferInfo(int frameIndex) { return commandBuffers[frameIndex]->descriptorInfo(); }
+	VkDescriptorBufferInfo getVisibleBufferInfo(int frameIndex) { return visibleBuffers[frameIndex]->descriptorInfo(); }
+	VkDescriptorBufferInfo getStatsBufferInfo(int frameIndex) { return statsBuffers[frameIndex]->descriptorInfo(); }
+
+	VkBuffer getCommandBuffer(int frameIndex) { return commandBuffers[frameIndex]->getBuffer(); }
+	VkBuffer getVisibleBuffer(int frameIndex) { return visibleBuffers[frameIndex]->getBuffer(); }
+
+	// Commands and instance slots of phase N start at N * getMaxObjects()
+	uint32_t getMaxObjects() const { return maxObjects; }
+	uint32_t getObjectCount() const { return static_cast<uint32_t>(drawItems.size()); }
+	uint32_t getCommandCount() const { return static_cast<uint32_t>(commands.size()); }
+	const std::vector<DrawGroup>& getDrawGroups() const { return drawGroups; }
+	// Draw calls recorded for the previous build, however many ranges they were split into
+	uint32_t getDrawCallCount() const { return lastDrawCallCount; }
+
+	// GPU culling results are read back once their frame has finished, so they lag a few frames behind
+	uint32_t getVisibleCount() const { return visibleCount; }
+	uint32_t getCulledCount() const { return culledCount; }
+	uint32_t getOccludedCount() const { return occludedCount; }
+	uint32_t getDisoccludedCount() const { return disoccludedCount; }
+
+	static constexpr uint32_t PHASE_COUNT = 2;
+
+	// Marks an object that is not part of an indexed command and is always drawn
+	static constexpr uint32_t DIRECT_DRAW_COMMAND = 0xFFFFFFFF;
+
+	static constexpr uint32_t ALL_COMMANDS = 0xFFFFFFFF;
+
+private:
+	// Matrices point into the transform or snapshot the item was built from
+	struct DrawItem
+	{
+		Model* model;
+		Material* material;
+		const glm::mat4* modelMatrix;
+		const glm::mat4* normalMatrix;
+		uint32_t materialFeatures;
+	};
+
+	// Instance group of a model without indices, drawn directly
+	struct DirectDraw
+	{
+		Model* model;
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+	};
+
+	void beginBuild(int frameIndex);
+	void addDrawItem(const DrawItem& item);
+	void endBuild(int frameIndex, const std::array<glm::vec4, 6>* cullPlanes, JobSystem* jobSystem);
+	void cullDrawItems(const std::array<glm::vec4, 6>& planes, JobSystem* jobSystem);
+	static DrawRange clipRange(const DrawRange& range, uint32_t phase, uint32_t firstCommand, uint32_t commandCount);
+
+	// Objects per CPU culling job, a multiple of four so that jobs never share a group of spheres
+	static constexpr uint32_t CULL_BATCH_SIZE = 2048;
+
+	Device& device;
+	uint32_t maxObjects = 0;
+
+	std::vector<std::unique_ptr<Buffer>> objectBuffers;
+	std::vector<std::unique_ptr<Buffer>> commandBuffers;
+	std::vector<std::unique_ptr<Buffer>> visibleBuffers; // Object index for every instance slot, written by the culling pass
+	std::vector<std::unique_ptr<Buffer>> statsBuffers; // CullStats, written by the culling pass
+
+	// Objects submitted in each frame, to work out the culled count when its stats come back
+	std::vector<uint32_t> frameObjectCounts;
+
+	// Reused every frame to avoid reallocating
+	std::vector<DrawItem> drawItems;
+	std::vector<VkDrawIndexedIndirectCommand> commands;
+	std::vector<DirectDraw> directDraws;
+	std::vector<DrawGroup> drawGroups;
+	std::vector<uint32_t> cpuVisible;
+	std::vector<std::vector<uint32_t>> batchVisible; // Results of each CPU culling job, joined in order
+
+	FrustumCuller cpuCuller;
+
+	std::atomic<uint32_t> drawCallCount{0};
+	uint32_t lastDrawCallCount = 0;
+	uint32_t visibleCount = 0;
+	uint32_t culledCount = 0;
+	uint32_t occludedCount = 0;
+	uint32_t disoccludedCount = 0;
+	bool warnedOverflow = false;
+};
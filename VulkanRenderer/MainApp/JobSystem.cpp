@@ -0,0 +1,285 @@
+#include "JobSystem.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace
+{
+	// Which job system the calling thread has an index in, and that index
+	thread_local const JobSystem* threadJobSystem = nullptr;
+	thread_local uint32_t threadIndex = 0;
+}
+
+JobSystem::JobSystem(uint32_t workerCount)
+{
+	if (workerCount == 0)
+	{
+		workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	}
+	this->workerCount = workerCount;
+
+	queues = std::make_unique<WorkQueue[]>(getThreadCount());
+
+	workers.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wakeCondition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+uint32_t JobSystem::getThreadIndex()
+{
+	if (threadJobSystem != this)
+	{
+		std::lock_guard<std::mutex> lock(externalMutex);
+
+		bool* freeSlot = std::find(externalThreadUsed, externalThreadUsed + MAX_EXTERNAL_THREADS, false);
+		if (freeSlot == externalThreadUsed + MAX_EXTERNAL_THREADS)
+		{
+			throw std::runtime_error("too many threads submitting jobs!");
+		}
+		*freeSlot = true;
+		threadJobSystem = this;
+		threadIndex = workerCount + (uint32_t)(freeSlot - externalThreadUsed);
+	}
+	return threadIndex;
+}
+
+void JobSystem::releaseThreadIndex()
+{
+	// Workers keep their index for as long as the system runs
+	if (threadJobSystem != this || threadIndex < workerCount)
+		return;
+
+	std::lock_guard<std::mutex> lock(externalMutex);
+	externalThreadUsed[threadIndex - workerCount] = false;
+	threadJobSystem = nullptr;
+}
+
+void JobSystem::run(Job job, JobCounter* counter)
+{
+	if (counter)
+		counter->pending++;
+
+	push(getThreadIndex(), { std::move(job), counter });
+}
+
+void JobSystem::runAfter(JobCounter& dependency, Job job, JobCounter* counter)
+{
+	if (counter)
+		counter->pending++;
+
+	{
+		// Checked under the lock so the dependency can't finish between the check and the append
+		std::lock_guard<std::mutex> lock(dependency.mutex);
+		if (dependency.pending > 0)
+		{
+			dependency.continuations.emplace_back(std::move(job), counter);
+			return;
+		}
+	}
+
+	push(getThreadIndex(), { std::move(job), counter });
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+	uint32_t index = getThreadIndex();
+	while (counter.pending > 0)
+	{
+		QueuedJob job;
+		if (takeJob(index, job))
+			execute(job, index);
+		else
+			std::this_thread::yield();
+	}
+
+	// The last job may still hold the counter's lock, it must be released before the counter can go away
+	std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t batchSize, const RangeJob& job)
+{
+	if (count == 0)
+		return;
+
+	batchSize = std::max(batchSize, 1u);
+
+	JobCounter counter;
+	for (uint32_t begin = 0; begin < count; begin += batchSize)
+	{
+		uint32_t end = std::min(begin + batchSize, count);
+		run([&job, begin, end](uint32_t threadIndex) { job(begin, end, threadIndex); }, &counter);
+	}
+	wait(counter);
+}
+
+void JobSystem::workerLoop(uint32_t index)
+{
+	threadJobSystem = this;
+	threadIndex = index;
+
+	while (!stopping)
+	{
+		QueuedJob job;
+		if (takeJob(index, job))
+		{
+			execute(job, index);
+			continue;
+		}
+
+		// Pairs with push(): either it sees this worker sleeping, or this worker sees its job
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepingWorkers++;
+		wakeCondition.wait(lock, [this]() { return stopping || queuedJobs > 0; });
+		sleepingWorkers--;
+	}
+}
+
+void JobSystem::push(uint32_t index, QueuedJob job)
+{
+	{
+		std::lock_guard<std::mutex> lock(queues[index].mutex);
+		queues[index].jobs.push_back(std::move(job));
+	}
+	queuedJobs++;
+
+	if (sleepingWorkers > 0)
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		wakeCondition.notify_one();
+	}
+}
+
+bool JobSystem::takeJob(uint32_t index, QueuedJob& outJob)
+{
+	// Newest job of our own queue first, its data is most likely still in cache
+	{
+		WorkQueue& queue = queues[index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty())
+		{
+			outJob = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+			queuedJobs--;
+			return true;
+		}
+	}
+
+	// Then the oldest job of another queue, which tends to be the largest piece of remaining work
+	const uint32_t queueCount = getThreadCount();
+	for (uint32_t i = 1; i < queueCount; i++)
+	{
+		WorkQueue& queue = queues[(index + i) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty())
+		{
+			outJob = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+			queuedJobs--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::execute(QueuedJob& job, uint32_t index)
+{
+	job.job(index);
+
+	if (job.counter)
+		finish(*job.counter, index);
+}
+
+void JobSystem::finish(JobCounter& counter, uint32_t index)
+{
+	std::vector<std::pair<Job, JobCounter*>> ready;
+	{
+		std::lock_guard<std::mutex> lock(counter.mutex);
+		if (--counter.pending > 0)
+			return;
+		ready.swap(counter.continuations);
+	}
+
+	// The counter may be gone from here on, only the jobs taken from it are used
+	for (auto& continuation : ready)
+	{
+		push(index, { std::move(continuation.first), continuation.second });
+	}
+}
+
+void JobSystem::benchmark(JobSystem& jobSystem, uint32_t jobCount)
+{
+	std::atomic<uint32_t> sink{0};
+	auto time = [jobCount](auto&& func)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		func();
+		auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::nano>(end - start).count() / jobCount;
+	};
+
+	double runTime = time([&]()
+	{
+		JobCounter counter;
+		for (uint32_t i = 0; i < jobCount; i++)
+		{
+			jobSystem.run([&sink](uint32_t) { sink.fetch_add(1, std::memory_order_relaxed); }, &counter);
+		}
+		jobSystem.wait(counter);
+	});
+
+	// Chains of two, the second job of each only queued once the first has finished
+	double dependentTime = time([&]()
+	{
+		JobCounter counter;
+		std::vector<std::unique_ptr<JobCounter>> firstCounters(jobCount / 2);
+		for (auto& firstCounter : firstCounters)
+		{
+			firstCounter = std::make_unique<JobCounter>();
+			jobSystem.run([&sink](uint32_t) { sink.fetch_add(1, std::memory_order_relaxed); }, firstCounter.get());
+			jobSystem.runAfter(*firstCounter, [&sink](uint32_t) { sink.fetch_add(1, std::memory_order_relaxed); }, &counter);
+		}
+		jobSystem.wait(counter);
+		for (auto& firstCounter : firstCounters)
+		{
+			jobSystem.wait(*firstCounter);
+		}
+	});
+
+	double forTime = time([&]()
+	{
+		jobSystem.parallelFor(jobCount, 1, [&sink](uint32_t begin, uint32_t end, uint32_t) { sink.fetch_add(end - begin, std::memory_order_relaxed); });
+	});
+
+	double batchedTime = time([&]()
+	{
+		jobSystem.parallelFor(jobCount, 64, [&sink](uint32_t begin, uint32_t end, uint32_t) { sink.fetch_add(end - begin, std::memory_order_relaxed); });
+	});
+
+	uint32_t expected = jobCount * 4 - (jobCount % 2);
+	if (sink != expected)
+	{
+		CORE_ERROR("Job system benchmark mismatch: {0} jobs ran, expected {1}", sink.load(), expected)
+	}
+
+	CORE_INFO("Job system benchmark ({0} jobs, {1} workers): run {2:.0f} ns, runAfter {3:.0f} ns, parallelFor {4:.0f} ns, batches of 64 {5:.1f} ns per job",
+		jobCount, jobSystem.getWorkerCount(), runTime, dependentTime, forTime, batchedTime)
+}
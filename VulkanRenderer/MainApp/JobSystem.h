@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+
+/*
+ * Number of jobs in a group that have not finished yet. Waiting on a counter runs other jobs in the
+ * meantime, and jobs can be queued to start once a counter reaches zero, so groups can depend on
+ * each other without blocking a thread. A counter must outlive the jobs it counts.
+ */
+class JobCounter
+{
+public:
+	JobCounter() = default;
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool isDone() const { return pending.load() == 0; }
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> pending{0};
+	std::mutex mutex;
+	std::vector<std::pair<std::function<void(uint32_t)>, JobCounter*>> continuations; // Queued once pending reaches zero
+};
+
+/*
+ * Work-stealing scheduler. Every thread has its own queue: new jobs are pushed to the back of the
+ * submitting thread's queue and its owner takes the newest first, while idle threads steal the
+ * oldest job from the front of someone else's. Threads that wait on a counter run jobs until it is
+ * done instead of sleeping, so waiting from inside a job is fine.
+ * Every thread has a stable index below getThreadCount(), so jobs can use per-thread resources such
+ * as command pools: workers are 0 to getWorkerCount() - 1, and the threads that submit jobs from
+ * outside get the indices after them the first time they use the system. Short-lived threads hand
+ * theirs back with releaseThreadIndex() before they exit.
+ */
+class JobSystem
+{
+public:
+	using Job = std::function<void(uint32_t threadIndex)>;
+	// Called with one batch [begin, end) of a parallel for
+	using RangeJob = std::function<void(uint32_t begin, uint32_t end, uint32_t threadIndex)>;
+
+	// Zero picks one worker per hardware thread, minus the calling thread
+	JobSystem(uint32_t workerCount = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// The counter, if there is one, is incremented now and decremented once the job has run
+	void run(Job job, JobCounter* counter = nullptr);
+	// Like run(), but the job is only queued once the dependency reaches zero
+	void runAfter(JobCounter& dependency, Job job, JobCounter* counter = nullptr);
+	// Runs queued jobs on this thread until the counter reaches zero
+	void wait(JobCounter& counter);
+
+	// Splits [0, count) into batches of at most batchSize, runs them as jobs and waits for all of them
+	void parallelFor(uint32_t count, uint32_t batchSize, const RangeJob& job);
+
+	uint32_t getWorkerCount() const { return workerCount; }
+	uint32_t getThreadCount() const { return workerCount + MAX_EXTERNAL_THREADS; }
+	uint32_t getThreadIndex();
+	// Frees the calling thread's external index for another thread. It must not have jobs of its own
+	// queued, which holds after waiting on everything it submitted.
+	void releaseThreadIndex();
+
+	// Times empty jobs through run(), runAfter() and parallelFor() and logs the cost of each per job
+	static void benchmark(JobSystem& jobSystem, uint32_t jobCount = 100000);
+
+	// Threads besides the workers that may submit jobs
+	static constexpr uint32_t MAX_EXTERNAL_THREADS = 2;
+
+private:
+	struct QueuedJob
+	{
+		Job job;
+		JobCounter* counter = nullptr;
+	};
+
+	// Padded so that neighbouring queues' locks don't share a cache line
+	struct alignas(64) WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<QueuedJob> jobs;
+	};
+
+	void workerLoop(uint32_t threadIndex);
+	void push(uint32_t threadIndex, QueuedJob job);
+	bool takeJob(uint32_t threadIndex, QueuedJob& outJob);
+	void execute(QueuedJob& job, uint32_t threadIndex);
+	void finish(JobCounter& counter, uint32_t threadIndex);
+
+	uint32_t workerCount = 0;
+	std::vector<std::thread> workers;
+	std::unique_ptr<WorkQueue[]> queues; // One per thread index
+	std::mutex externalMutex;
+	bool externalThreadUsed[MAX_EXTERNAL_THREADS] = {};
+
+	// Idle workers sleep until a job is queued
+	std::mutex sleepMutex;
+	std::condition_variable wakeCondition;
+	std::atomic<uint32_t> queuedJobs{0};
+	std::atomic<uint32_t> sleepingWorkers{0};
+	std::atomic<bool> stopping{false};
+};
@@ -0,0 +1,96 @@
+#include "LayoutCache.h"
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <stdexcept>
+
+static bool operator==(const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+{
+	return a.binding == b.binding && a.descriptorType == b.descriptorType && a.descriptorCount == b.descriptorCount &&
+		a.stageFlags == b.stageFlags && a.pImmutableSamplers == b.pImmutableSamplers;
+}
+
+static bool operator==(const VkPushConstantRange& a, const VkPushConstantRange& b)
+{
+	return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+}
+
+LayoutCache::LayoutCache(Device& device)
+	: device{device}
+{
+}
+
+LayoutCache::~LayoutCache()
+{
+	for (PipelineLayoutEntry& entry : pipelineLayouts)
+	{
+		vkDestroyPipelineLayout(device.getDevice(), entry.layout, nullptr);
+	}
+}
+
+DescriptorSetLayout& LayoutCache::getSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings, bool unbound)
+{
+	requestCount++;
+
+	std::vector<VkDescriptorSetLayoutBinding> sorted = bindings;
+	std::sort(sorted.begin(), sorted.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+	{
+		return a.binding < b.binding;
+	});
+
+	for (SetLayoutEntry& entry : setLayouts)
+	{
+		if (entry.unbound == unbound && entry.bindings == sorted)
+			return *entry.layout;
+	}
+
+	std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindingMap;
+	for (const VkDescriptorSetLayoutBinding& binding : sorted)
+	{
+		bindingMap[binding.binding] = binding;
+	}
+
+	setLayouts.push_back({ sorted, unbound, std::make_unique<DescriptorSetLayout>(device, bindingMap, unbound) });
+	return *setLayouts.back().layout;
+}
+
+DescriptorSetLayout& LayoutCache::getSetLayout(const ShaderReflection& shaders, uint32_t set, uint32_t unsizedCount)
+{
+	return getSetLayout(shaders.getSetBindings(set, unsizedCount), shaders.hasUnsizedArray(set));
+}
+
+VkPipelineLayout LayoutCache::getPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges)
+{
+	requestCount++;
+
+	for (PipelineLayoutEntry& entry : pipelineLayouts)
+	{
+		if (entry.setLayouts == setLayouts && entry.pushConstantRanges == pushConstantRanges)
+			return entry.layout;
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+	pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+	VkPipelineLayout layout;
+	if (vkCreatePipelineLayout(device.getDevice(), &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create pipeline layout!");
+
+	pipelineLayouts.push_back({ setLayouts, pushConstantRanges, layout });
+	return layout;
+}
+
+VkPipelineLayout LayoutCache::getPipelineLayout(const ShaderReflection& shaders, const std::vector<VkDescriptorSetLayout>& setLayouts)
+{
+	uint32_t setCount = shaders.getSetCount();
+	if (setCount > setLayouts.size())
+		throw std::runtime_error("Shaders use " + std::to_string(setCount) + " descriptor sets, but only " + std::to_string(setLayouts.size()) + " layouts were given!");
+
+	std::vector<VkDescriptorSetLayout> usedLayouts(setLayouts.begin(), setLayouts.begin() + setCount);
+	return getPipelineLayout(usedLayouts, shaders.getPushConstantRanges());
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Device.h"
+#include "Descriptors.h"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <memory>
+
+class ShaderReflection;
+
+/*
+ * Descriptor set layouts and pipeline layouts, created once per distinct definition and shared by
+ * everything asking for the same one. The cache owns them, they live as long as the device.
+ * There are only ever a handful, so lookups are a linear search.
+ */
+class LayoutCache
+{
+public:
+	LayoutCache(Device& device);
+	~LayoutCache();
+
+	LayoutCache(const LayoutCache&) = delete;
+	LayoutCache& operator=(const LayoutCache&) = delete;
+
+	// Unbound layouts let arrays be partially bound and updated while in use, see DescriptorSetLayout
+	DescriptorSetLayout& getSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings, bool unbound = false);
+	// Set layout for one set of the reflected shaders, unsized arrays get unsizedCount descriptors and make the layout unbound
+	DescriptorSetLayout& getSetLayout(const ShaderReflection& shaders, uint32_t set, uint32_t unsizedCount = 0);
+
+	VkPipelineLayout getPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges);
+	// Uses as many of the set layouts, in set order, as the shaders have sets, and the push constants they declare.
+	// Throws if the shaders use a set there is no layout for.
+	VkPipelineLayout getPipelineLayout(const ShaderReflection& shaders, const std::vector<VkDescriptorSetLayout>& setLayouts);
+
+	uint32_t getSetLayoutCount() const { return static_cast<uint32_t>(setLayouts.size()); }
+	uint32_t getPipelineLayoutCount() const { return static_cast<uint32_t>(pipelineLayouts.size()); }
+	// How many layouts were asked for, including the ones that were already cached
+	uint32_t getRequestCount() const { return requestCount; }
+
+private:
+	struct SetLayoutEntry
+	{
+		std::vector<VkDescriptorSetLayoutBinding> bindings; // Sorted by binding
+		bool unbound;
+		std::unique_ptr<DescriptorSetLayout> layout;
+	};
+
+	struct PipelineLayoutEntry
+	{
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		std::vector<VkPushConstantRange> pushConstantRanges;
+		VkPipelineLayout layout;
+	};
+
+	Device& device;
+	std::vector<SetLayoutEntry> setLayouts;
+	std::vector<PipelineLayoutEntry> pipelineLayouts;
+	uint32_t requestCount = 0;
+};
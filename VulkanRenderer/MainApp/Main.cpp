@@ -5,13 +5,43 @@
 
 #include "Application.h"
 
-int main()
+#include <cstring>
+
+// --present-mode fifo|mailbox|immediate, --frames-in-flight N, --uncapped
+static RendererSettings parseRendererSettings(int argc, char** argv)
+{
+	RendererSettings settings;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--uncapped") == 0)
+		{
+			settings.uncappedBenchmark = true;
+		}
+		else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+		{
+			settings.framesInFlight = static_cast<uint32_t>(atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--present-mode") == 0 && i + 1 < argc)
+		{
+			const char* mode = argv[++i];
+			if (strcmp(mode, "mailbox") == 0)
+				settings.presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+			else if (strcmp(mode, "immediate") == 0)
+				settings.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+			else
+				settings.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+		}
+	}
+	return settings;
+}
+
+int main(int argc, char** argv)
 {
 	Application* app = Application::initInstance("Vulkan Renderer", 1280, 720);
 
 	try
 	{
-		app->run();
+		app->run(parseRendererSettings(argc, argv));
 	}
 	catch (const std::exception& e)
 	{
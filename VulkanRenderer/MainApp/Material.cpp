@@ -36,6 +36,31 @@ void Material::setShaderParameters(ShaderParameters& params)
 	shaderParams.toggleTexture = params.toggleTexture;
 	shaderParams.textureDir = params.textureDir;
 	shaderParams.materialTextures = params.materialTextures;
+	markDirty();
+}
+
+uint32_t Material::getFeatures()
+{
+	if (featuresVersion == version)
+		return features;
+
+	// Texture bindings are in MaterialBuilder::getBindingFromFileName order
+	std::map<uint32_t, Texture>& textures = shaderParams.materialTextures;
+	features = 0;
+	if (shaderParams.toggleTexture == 1)
+	{
+		if (textures.count(0) || textures.count(2) || textures.count(3))
+			features |= MATERIAL_FEATURE_TEXTURED;
+		if (textures.count(1))
+			features |= MATERIAL_FEATURE_NORMAL_MAP;
+		if (textures.count(4))
+			features |= MATERIAL_FEATURE_PARALLAX;
+		if (textures.count(5))
+			features |= MATERIAL_FEATURE_METALLIC_MAP;
+	}
+
+	featuresVersion = version;
+	return features;
 }
 
 void Material::cleanup(class Device& device)
@@ -27,6 +27,16 @@ struct ShaderParameters
 	ShaderParameters(uint32_t texIndex, uint32_t toggleTex = 0, glm::vec4 albedo = glm::vec4{1.0f}, float roughness = 1.0f, float ao = 1.0f, float metallic = 0.0f);
 };
 
+// Shader features a material uses, picks the PBR pipeline permutation it is drawn with
+enum MaterialFeatureFlags : uint32_t
+{
+	MATERIAL_FEATURE_TEXTURED = 1 << 0, // Albedo, roughness or AO maps
+	MATERIAL_FEATURE_NORMAL_MAP = 1 << 1,
+	MATERIAL_FEATURE_PARALLAX = 1 << 2, // Height map
+	MATERIAL_FEATURE_METALLIC_MAP = 1 << 3,
+	MATERIAL_FEATURE_ALL = (1 << 4) - 1
+};
+
 class Material
 {
 public:
@@ -48,12 +58,27 @@ public:
 	// Get the internal name of this material
 	const std::string& getNameInternal() { return nameInternal; }
 
+	// Bumped whenever the parameters change, the material table re-uploads materials whose version it has not seen
+	uint32_t getVersion() const { return version; }
+	void markDirty() { version++; }
+
+	// MaterialFeatureFlags of the maps in use, none unless textures are toggled on
+	uint32_t getFeatures();
+
+	// Slot in the material table, assigned when the material is first drawn
+	uint32_t getMaterialIndex() const { return materialIndex; }
+	void setMaterialIndex(uint32_t index) { materialIndex = index; }
+
 	void cleanup(class Device& device);
 
 private:
 	ShaderParameters shaderParams;
 	std::string fileName;
 	std::string nameInternal;
+	uint32_t materialIndex = 0xFFFFFFFF;
+	uint32_t version = 1;
+	uint32_t features = 0;
+	uint32_t featuresVersion = 0; // Version the features were worked out at
 };
 
 class MaterialBuilder
@@ -0,0 +1,208 @@
+#include "MaterialTable.h"
+#include "SwapChain.h"
+#include "Log.h"
+#include "LayoutCache.h"
+
+#include <algorithm>
+
+MaterialTable::MaterialTable(Device& device)
+	: device{device}
+{
+}
+
+MaterialTable::~MaterialTable()
+{
+	cleanup();
+}
+
+void MaterialTable::init(const ShaderReflection& shaders, uint32_t maxMaterials)
+{
+	this->maxMaterials = std::max(maxMaterials, 1u);
+
+	// The texture array is update-after-bind, so those limits apply. Leave room for the few other samplers
+	// a fragment shader may use.
+	const VkPhysicalDeviceDescriptorIndexingProperties& limits = device.descriptorIndexingProperties;
+	uint32_t samplerLimit = std::min({ limits.maxPerStageDescriptorUpdateAfterBindSamplers, limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+		limits.maxDescriptorSetUpdateAfterBindSamplers, limits.maxDescriptorSetUpdateAfterBindSampledImages });
+	maxTextures = std::min(MAX_TEXTURES, samplerLimit > 16 ? samplerLimit - 16 : samplerLimit);
+
+	// Binding 0 is the texture array, 1 the material buffer
+	setLayout = &device.getLayoutCache().getSetLayout(shaders, MATERIAL_SET, maxTextures);
+
+	descriptorPool = DescriptorPool::Builder(device)
+		.setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SwapChain::MAX_FRAMES_IN_FLIGHT * maxTextures)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+		.setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+		.build();
+
+	materialBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+	descriptorSets.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+	for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		materialBuffers[i] = std::make_unique<Buffer>(device, sizeof(MaterialData), this->maxMaterials, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+		materialBuffers[i]->map();
+
+		VkDescriptorBufferInfo bufferInfo = materialBuffers[i]->descriptorInfo();
+		DescriptorWriter(*setLayout, *descriptorPool)
+			.writeBuffer(1, &bufferInfo)
+			.build(descriptorSets[i]);
+	}
+
+	materials.reserve(this->maxMaterials);
+	uploadedVersions.reserve(this->maxMaterials * SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+	CORE_INFO("Created material table: {0} materials, {1} textures", this->maxMaterials, maxTextures)
+}
+
+void MaterialTable::cleanup()
+{
+	descriptorSets.clear();
+	materialBuffers.clear();
+	descriptorPool = nullptr;
+	setLayout = nullptr;
+
+	materials.clear();
+	materialTextures.clear();
+	textureVersions.clear();
+	uploadedVersions.clear();
+	textureSlots.clear();
+}
+
+uint32_t MaterialTable::registerMaterial(const std::shared_ptr<Material>& material)
+{
+	uint32_t index = material->getMaterialIndex();
+	if (index < materials.size() && materials[index] == material)
+		return index;
+
+	if (materials.size() == maxMaterials)
+	{
+		if (!warnedOverflow)
+		{
+			CORE_WARN("Material table is full ({0} materials), new materials will use the first one", maxMaterials)
+			warnedOverflow = true;
+		}
+		material->setMaterialIndex(0);
+		return 0;
+	}
+
+	index = static_cast<uint32_t>(materials.size());
+	material->setMaterialIndex(index);
+	materials.push_back(material);
+
+	materialTextures.emplace_back();
+	textureVersions.push_back(0);
+	resolveTextures(index);
+
+	// Version 0 is never used by a material, so every frame uploads it once
+	uploadedVersions.resize(materials.size() * SwapChain::MAX_FRAMES_IN_FLIGHT, 0);
+
+	return index;
+}
+
+void MaterialTable::update(int frameIndex, Registry& registry)
+{
+	registry.each<MeshComponent, MaterialComponent>([this](Entity entity, MeshComponent& mesh, MaterialComponent& materialComp)
+	{
+		if (mesh.model && materialComp.material)
+			registerMaterial(materialComp.material);
+	});
+
+	uploadChanged(frameIndex);
+}
+
+void MaterialTable::update(int frameIndex, const RenderSnapshot& snapshot)
+{
+	for (const RenderObject& object : snapshot.objects)
+	{
+		registerMaterial(object.material);
+	}
+
+	uploadChanged(frameIndex);
+}
+
+void MaterialTable::uploadChanged(int frameIndex)
+{
+	MaterialData* mapped = static_cast<MaterialData*>(materialBuffers[frameIndex]->getMappedMemory());
+	flushRanges.clear();
+	for (uint32_t i = 0; i < static_cast<uint32_t>(materials.size()); i++)
+	{
+		uint32_t version = materials[i]->getVersion();
+		uint32_t& uploadedVersion = uploadedVersions[i * SwapChain::MAX_FRAMES_IN_FLIGHT + frameIndex];
+		if (uploadedVersion == version)
+			continue;
+
+		// Maps may have been swapped along with the parameters
+		if (textureVersions[i] != version)
+			resolveTextures(i);
+
+		mapped[i] = packMaterial(i);
+		uploadedVersion = version;
+
+		// Neighbouring materials share one range
+		VkDeviceSize offset = static_cast<VkDeviceSize>(i) * sizeof(MaterialData);
+		if (!flushRanges.empty() && flushRanges.back().offset + flushRanges.back().size == offset)
+			flushRanges.back().size += sizeof(MaterialData);
+		else
+			flushRanges.push_back({ offset, sizeof(MaterialData) });
+	}
+
+	materialBuffers[frameIndex]->flushRanges(flushRanges);
+}
+
+uint32_t MaterialTable::registerTexture(Texture& texture)
+{
+	auto it = textureSlots.find(texture.getTextureImageView());
+	if (it != textureSlots.end())
+		return it->second;
+
+	if (textureSlots.size() == maxTextures)
+	{
+		CORE_WARN("Bindless texture array is full ({0} textures), {1} will not be shown", maxTextures, texture.getNameInternal())
+		return INVALID_TEXTURE_INDEX;
+	}
+
+	uint32_t slot = static_cast<uint32_t>(textureSlots.size());
+	textureSlots[texture.getTextureImageView()] = slot;
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = texture.getTextureImageView();
+	imageInfo.sampler = texture.getTextureSampler();
+
+	// The array is update-after-bind, so slots can be filled while earlier frames still use the set
+	for (VkDescriptorSet& set : descriptorSets)
+	{
+		DescriptorWriter(*setLayout, *descriptorPool).writeImageAtIndex(0, slot, &imageInfo).overwrite(set);
+	}
+
+	return slot;
+}
+
+void MaterialTable::resolveTextures(uint32_t index)
+{
+	std::array<uint32_t, MATERIAL_TEXTURE_COUNT>& textureIndices = materialTextures[index];
+	textureIndices.fill(INVALID_TEXTURE_INDEX);
+	for (std::pair<const uint32_t, Texture>& texture : materials[index]->getShaderParameters().materialTextures)
+	{
+		if (texture.first < MATERIAL_TEXTURE_COUNT)
+			textureIndices[texture.first] = registerTexture(texture.second);
+	}
+	textureVersions[index] = materials[index]->getVersion();
+}
+
+MaterialData MaterialTable::packMaterial(uint32_t index)
+{
+	ShaderParameters& params = materials[index]->getShaderParameters();
+
+	MaterialData data{};
+	data.albedo = params.albedo;
+	data.roughness = params.roughness;
+	data.ambientOcclusion = params.ambientOcclusion;
+	data.metallic = params.metallic;
+	data.toggleTexture = params.toggleTexture;
+	std::copy(materialTextures[index].begin(), materialTextures[index].end(), data.textureIndices);
+
+	return data;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Device.h"
+#include "Buffer.h"
+#include "Descriptors.h"
+#include "Scene/Registry.h"
+#include "Scene/RenderSnapshot.h"
+#include "Material.h"
+#include "ShaderReflection.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <unordered_map>
+
+// Texture slots of a material, in MaterialBuilder::getBindingFromFileName order
+enum MaterialTextureSlot
+{
+	MATERIAL_TEXTURE_ALBEDO,
+	MATERIAL_TEXTURE_NORMAL,
+	MATERIAL_TEXTURE_ROUGHNESS,
+	MATERIAL_TEXTURE_AO,
+	MATERIAL_TEXTURE_HEIGHT,
+	MATERIAL_TEXTURE_METALLIC,
+	MATERIAL_TEXTURE_COUNT
+};
+
+// GPU copy of a material, matches MaterialData in the shaders (std430)
+struct MaterialData
+{
+	glm::vec4 albedo{ 1.0f };
+	float roughness = 1.0f;
+	float ambientOcclusion = 1.0f;
+	float metallic = 0.0f;
+	uint32_t toggleTexture = 0;
+	uint32_t textureIndices[MATERIAL_TEXTURE_COUNT]; // Into the bindless texture array, INVALID_TEXTURE_INDEX when the map is missing
+	uint32_t padding[2];
+};
+
+/*
+ * Owns the material descriptor set: one storage buffer with every material, indexed by the id the
+ * table hands out, and one large partially bound texture array that every material's maps are
+ * registered into. Render systems bind it once per frame and look materials up through ObjectData.
+ * Materials are registered the first time an object using them is seen. Each frame's buffer remembers
+ * the material versions it holds, so only materials edited since that frame was last written are
+ * uploaded, followed by one flush of the touched ranges.
+ */
+class MaterialTable
+{
+public:
+	MaterialTable(Device& device);
+	~MaterialTable();
+
+	MaterialTable(const MaterialTable&) = delete;
+	MaterialTable& operator=(const MaterialTable&) = delete;
+
+	// The set layout is set 1 of the given shaders, with the unsized texture array sized to what the device allows
+	void init(const ShaderReflection& shaders, uint32_t maxMaterials = DEFAULT_MAX_MATERIALS);
+	void cleanup();
+
+	uint32_t registerMaterial(const std::shared_ptr<Material>& material);
+
+	// Registers new materials and uploads changed ones into this frame's buffer, call before the draw list is built
+	void update(int frameIndex, Registry& registry);
+	// Same, for the materials of a snapshot published by the simulation thread
+	void update(int frameIndex, const RenderSnapshot& snapshot);
+
+	VkDescriptorSetLayout getSetLayout() const { return setLayout->getDescriptorSetLayout(); }
+	VkDescriptorSet getDescriptorSet(int frameIndex) const { return descriptorSets[frameIndex]; }
+
+	uint32_t getMaterialCount() const { return static_cast<uint32_t>(materials.size()); }
+	uint32_t getTextureCount() const { return static_cast<uint32_t>(textureSlots.size()); }
+
+	static constexpr uint32_t MATERIAL_SET = 1; // Set index of the table in every shader using materials
+	static constexpr uint32_t DEFAULT_MAX_MATERIALS = 1024;
+	static constexpr uint32_t MAX_TEXTURES = 4096;
+	static constexpr uint32_t INVALID_TEXTURE_INDEX = 0xFFFFFFFF;
+
+private:
+	void uploadChanged(int frameIndex);
+	uint32_t registerTexture(Texture& texture);
+	void resolveTextures(uint32_t index);
+	MaterialData packMaterial(uint32_t index);
+
+	Device& device;
+	uint32_t maxMaterials = 0;
+	uint32_t maxTextures = 0;
+
+	DescriptorSetLayout* setLayout = nullptr; // Owned by the device's layout cache
+	std::unique_ptr<DescriptorPool> descriptorPool;
+	std::vector<VkDescriptorSet> descriptorSets;
+	std::vector<std::unique_ptr<Buffer>> materialBuffers;
+
+	// Kept alive so their ids stay valid for the rest of the session
+	std::vector<std::shared_ptr<Material>> materials;
+	std::vector<std::array<uint32_t, MATERIAL_TEXTURE_COUNT>> materialTextures; // Texture array slot of each map
+	std::vector<uint32_t> textureVersions; // Material version the texture slots were resolved at
+	std::vector<uint32_t> uploadedVersions; // Material version held by each frame's buffer, MAX_FRAMES_IN_FLIGHT per material
+
+	std::vector<MemoryRange> flushRanges; // Reused every frame to avoid reallocating
+
+	std::unordered_map<VkImageView, uint32_t> textureSlots;
+
+	bool warnedOverflow = false;
+};
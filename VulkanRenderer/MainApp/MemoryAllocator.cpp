@@ -0,0 +1,402 @@
+#include "MemoryAllocator.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static VkDeviceSize alignDown(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return value & ~(alignment - 1);
+}
+
+MemoryBlock::MemoryBlock(VkDevice device, uint32_t memoryTypeIndex, VkDeviceSize blockSize, MemoryAllocationStrategy strategy, bool hostVisible)
+	: device{device}, memoryTypeIndex{memoryTypeIndex}, blockSize{blockSize}, strategy{strategy}
+{
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = blockSize;
+	allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate device memory block!");
+	}
+
+	// A VkDeviceMemory can only be mapped once, so host visible blocks stay mapped for their whole lifetime
+	if (hostVisible && vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to map device memory block!");
+	}
+
+	freeRanges.push_back({ 0, blockSize });
+}
+
+MemoryBlock::~MemoryBlock()
+{
+	if (mapped)
+	{
+		vkUnmapMemory(device, memory);
+	}
+	vkFreeMemory(device, memory, nullptr);
+}
+
+bool MemoryBlock::allocate(VkDeviceSize size, VkDeviceSize alignment, MemoryAllocation& outAllocation)
+{
+	VkDeviceSize offset = 0;
+
+	if (strategy == ALLOCATION_STRATEGY_LINEAR)
+	{
+		offset = alignUp(linearOffset, alignment);
+		if (offset + size > blockSize)
+		{
+			return false;
+		}
+		linearOffset = offset + size;
+	}
+	else
+	{
+		// First fit over the free list, the padding in front of an aligned offset stays free
+		auto range = freeRanges.begin();
+		for (; range != freeRanges.end(); range++)
+		{
+			offset = alignUp(range->offset, alignment);
+			if (offset + size <= range->offset + range->size)
+			{
+				break;
+			}
+		}
+
+		if (range == freeRanges.end())
+		{
+			return false;
+		}
+
+		FreeRange remaining = { offset + size, range->offset + range->size - (offset + size) };
+		if (offset > range->offset)
+		{
+			range->size = offset - range->offset;
+			if (remaining.size > 0)
+			{
+				freeRanges.insert(range + 1, remaining);
+			}
+		}
+		else if (remaining.size > 0)
+		{
+			*range = remaining;
+		}
+		else
+		{
+			freeRanges.erase(range);
+		}
+	}
+
+	outAllocation.memory = memory;
+	outAllocation.offset = offset;
+	outAllocation.size = size;
+	outAllocation.mapped = mapped ? static_cast<char*>(mapped) + offset : nullptr;
+	outAllocation.memoryTypeIndex = memoryTypeIndex;
+	outAllocation.block = this;
+
+	usedBytes += size;
+	allocationCount++;
+	return true;
+}
+
+void MemoryBlock::free(const MemoryAllocation& allocation)
+{
+	usedBytes -= allocation.size;
+	allocationCount--;
+
+	if (strategy == ALLOCATION_STRATEGY_LINEAR)
+	{
+		// Linear blocks are only reclaimed once everything in them has been released
+		if (allocationCount == 0)
+		{
+			linearOffset = 0;
+		}
+		return;
+	}
+
+	auto next = std::lower_bound(freeRanges.begin(), freeRanges.end(), allocation.offset,
+		[](const FreeRange& range, VkDeviceSize offset) { return range.offset < offset; });
+
+	// Coalesce with the neighbouring free ranges where possible
+	bool mergePrev = next != freeRanges.begin() && (next - 1)->offset + (next - 1)->size == allocation.offset;
+	bool mergeNext = next != freeRanges.end() && allocation.offset + allocation.size == next->offset;
+
+	if (mergePrev && mergeNext)
+	{
+		(next - 1)->size += allocation.size + next->size;
+		freeRanges.erase(next);
+	}
+	else if (mergePrev)
+	{
+		(next - 1)->size += allocation.size;
+	}
+	else if (mergeNext)
+	{
+		next->offset = allocation.offset;
+		next->size += allocation.size;
+	}
+	else
+	{
+		freeRanges.insert(next, { allocation.offset, allocation.size });
+	}
+}
+
+MemoryAllocator::MemoryAllocator()
+{
+
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+	cleanup();
+}
+
+void MemoryAllocator::init(VkDevice device, VkPhysicalDevice physicalDevice)
+{
+	this->device = device;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+	pools.resize(memoryProperties.memoryTypeCount * POOL_KIND_COUNT);
+	dedicatedAllocationCounts.resize(memoryProperties.memoryTypeCount, 0);
+	dedicatedAllocationBytes.resize(memoryProperties.memoryTypeCount, 0);
+}
+
+void MemoryAllocator::cleanup()
+{
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+
+	for (uint32_t i = 0; i < (uint32_t)dedicatedAllocationCounts.size(); i++)
+	{
+		if (dedicatedAllocationCounts[i] > 0)
+		{
+			CORE_ERROR("{0} dedicated allocations of memory type {1} were not freed before destroying the allocator!", dedicatedAllocationCounts[i], i)
+		}
+	}
+
+	pools.clear();
+}
+
+MemoryAllocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, bool isImage, MemoryAllocationStrategy strategy)
+{
+	VkDeviceSize blockSize = getPreferredBlockSize(memoryTypeIndex);
+
+	// Anything that would take up most of a block gets its own VkDeviceMemory
+	if (requirements.size > blockSize / 2)
+	{
+		return allocateDedicated(requirements.size, memoryTypeIndex);
+	}
+
+	PoolKind kind = strategy == ALLOCATION_STRATEGY_LINEAR ? POOL_LINEAR : (isImage ? POOL_IMAGE : POOL_BUFFER);
+	bool hostVisible = memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+
+	std::vector<std::unique_ptr<MemoryBlock>>& pool = pools[memoryTypeIndex * POOL_KIND_COUNT + kind];
+
+	MemoryAllocation allocation{};
+	for (std::unique_ptr<MemoryBlock>& block : pool)
+	{
+		if (block->allocate(requirements.size, requirements.alignment, allocation))
+		{
+			return allocation;
+		}
+	}
+
+	pool.push_back(std::make_unique<MemoryBlock>(device, memoryTypeIndex, blockSize, strategy, hostVisible));
+	if (!pool.back()->allocate(requirements.size, requirements.alignment, allocation))
+	{
+		throw std::runtime_error("failed to sub-allocate from a new memory block!");
+	}
+
+	return allocation;
+}
+
+void MemoryAllocator::free(MemoryAllocation& allocation)
+{
+	if (!allocation.isValid())
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+
+	if (allocation.block)
+	{
+		allocation.block->free(allocation);
+
+		// Keep one empty block around per pool so the next allocation doesn't hit the driver
+		for (std::vector<std::unique_ptr<MemoryBlock>>& pool : pools)
+		{
+			auto it = std::find_if(pool.begin(), pool.end(), [&](const std::unique_ptr<MemoryBlock>& block) { return block.get() == allocation.block; });
+			if (it == pool.end())
+			{
+				continue;
+			}
+
+			if ((*it)->isEmpty())
+			{
+				uint32_t emptyBlocks = (uint32_t)std::count_if(pool.begin(), pool.end(), [](const std::unique_ptr<MemoryBlock>& block) { return block->isEmpty(); });
+				if (emptyBlocks > 1)
+				{
+					pool.erase(it);
+				}
+			}
+			break;
+		}
+	}
+	else
+	{
+		if (allocation.mapped)
+		{
+			vkUnmapMemory(device, allocation.memory);
+		}
+		vkFreeMemory(device, allocation.memory, nullptr);
+
+		dedicatedAllocationCounts[allocation.memoryTypeIndex]--;
+		dedicatedAllocationBytes[allocation.memoryTypeIndex] -= allocation.size;
+	}
+
+	allocation = MemoryAllocation{};
+}
+
+VkResult MemoryAllocator::flush(const MemoryAllocation& allocation, VkDeviceSize size, VkDeviceSize offset)
+{
+	VkMappedMemoryRange mappedRange = getMappedRange(allocation, size, offset);
+	return vkFlushMappedMemoryRanges(device, 1, &mappedRange);
+}
+
+VkResult MemoryAllocator::flush(const MemoryAllocation& allocation, const std::vector<MemoryRange>& ranges)
+{
+	if (ranges.empty())
+		return VK_SUCCESS;
+
+	std::vector<VkMappedMemoryRange> mappedRanges(ranges.size());
+	for (size_t i = 0; i < ranges.size(); i++)
+	{
+		mappedRanges[i] = getMappedRange(allocation, ranges[i].size, ranges[i].offset);
+	}
+	return vkFlushMappedMemoryRanges(device, static_cast<uint32_t>(mappedRanges.size()), mappedRanges.data());
+}
+
+VkResult MemoryAllocator::invalidate(const MemoryAllocation& allocation, VkDeviceSize size, VkDeviceSize offset)
+{
+	VkMappedMemoryRange mappedRange = getMappedRange(allocation, size, offset);
+	return vkInvalidateMappedMemoryRanges(device, 1, &mappedRange);
+}
+
+std::vector<MemoryHeapStats> MemoryAllocator::getHeapStats()
+{
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+
+	std::vector<MemoryHeapStats> stats(memoryProperties.memoryHeapCount);
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+	{
+		stats[i].heapSize = memoryProperties.memoryHeaps[i].size;
+		stats[i].deviceLocal = memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+	}
+
+	for (uint32_t i = 0; i < (uint32_t)pools.size(); i++)
+	{
+		uint32_t heapIndex = memoryProperties.memoryTypes[i / POOL_KIND_COUNT].heapIndex;
+		for (std::unique_ptr<MemoryBlock>& block : pools[i])
+		{
+			stats[heapIndex].reservedBytes += block->getSize();
+			stats[heapIndex].usedBytes += block->getUsedBytes();
+			stats[heapIndex].allocationCount += block->getAllocationCount();
+			stats[heapIndex].blockCount++;
+		}
+	}
+
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+	{
+		uint32_t heapIndex = memoryProperties.memoryTypes[i].heapIndex;
+		stats[heapIndex].reservedBytes += dedicatedAllocationBytes[i];
+		stats[heapIndex].usedBytes += dedicatedAllocationBytes[i];
+		stats[heapIndex].allocationCount += dedicatedAllocationCounts[i];
+		stats[heapIndex].dedicatedAllocationCount += dedicatedAllocationCounts[i];
+	}
+
+	return stats;
+}
+
+void MemoryAllocator::logHeapStats()
+{
+	std::vector<MemoryHeapStats> stats = getHeapStats();
+	for (uint32_t i = 0; i < (uint32_t)stats.size(); i++)
+	{
+		CORE_INFO("Heap {0} ({1}): {2} allocations in {3} blocks ({4} dedicated), {5:.2f} / {6:.2f} MB used, {7:.2f} MB heap",
+			i, stats[i].deviceLocal ? "device local" : "host", stats[i].allocationCount, stats[i].blockCount, stats[i].dedicatedAllocationCount,
+			stats[i].usedBytes / (1024.0 * 1024.0), stats[i].reservedBytes / (1024.0 * 1024.0), stats[i].heapSize / (1024.0 * 1024.0))
+	}
+}
+
+VkDeviceSize MemoryAllocator::getPreferredBlockSize(uint32_t memoryTypeIndex)
+{
+	const VkMemoryType& memoryType = memoryProperties.memoryTypes[memoryTypeIndex];
+	VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryType.heapIndex].size;
+
+	// Small heaps (e.g the 256MB BAR heap) get smaller blocks so a single block can't exhaust them
+	VkDeviceSize preferredSize = (memoryType.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? HOST_VISIBLE_BLOCK_SIZE : DEFAULT_BLOCK_SIZE;
+	return std::min(preferredSize, alignUp(heapSize / 8, nonCoherentAtomSize));
+}
+
+VkMappedMemoryRange MemoryAllocator::getMappedRange(const MemoryAllocation& allocation, VkDeviceSize size, VkDeviceSize offset)
+{
+	VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.size : std::min(offset + size, allocation.size);
+
+	// Ranges must be multiples of nonCoherentAtomSize, either relative to the start of the memory object or ending at its end
+	VkDeviceSize memoryOffset = alignDown(allocation.offset + offset, nonCoherentAtomSize);
+	VkDeviceSize memoryEnd = alignUp(allocation.offset + end, nonCoherentAtomSize);
+	VkDeviceSize memorySize = allocation.block ? allocation.block->getSize() : allocation.size;
+
+	VkMappedMemoryRange mappedRange{};
+	mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	mappedRange.memory = allocation.memory;
+	mappedRange.offset = memoryOffset;
+	mappedRange.size = memoryEnd >= memorySize ? VK_WHOLE_SIZE : memoryEnd - memoryOffset;
+	return mappedRange;
+}
+
+MemoryAllocation MemoryAllocator::allocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex)
+{
+	MemoryAllocation allocation{};
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &allocation.memory) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate dedicated device memory!");
+	}
+
+	if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		if (vkMapMemory(device, allocation.memory, 0, VK_WHOLE_SIZE, 0, &allocation.mapped) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to map dedicated device memory!");
+		}
+	}
+
+	allocation.size = size;
+	allocation.memoryTypeIndex = memoryTypeIndex;
+
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+	dedicatedAllocationCounts[memoryTypeIndex]++;
+	dedicatedAllocationBytes[memoryTypeIndex] += size;
+
+	return allocation;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <memory>
+#include <mutex>
+
+enum MemoryAllocationStrategy
+{
+	// General purpose sub-allocation, ranges are returned to a free list and coalesced
+	ALLOCATION_STRATEGY_FREE_LIST,
+	// Bump allocation for short lived resources (e.g staging buffers), a block is reset once all of its allocations are freed
+	ALLOCATION_STRATEGY_LINEAR
+};
+
+struct MemoryAllocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	void* mapped = nullptr; // Points at the start of this allocation when the memory is host visible
+	uint32_t memoryTypeIndex = 0;
+	class MemoryBlock* block = nullptr; // nullptr for dedicated allocations
+
+	bool isValid() const { return memory != VK_NULL_HANDLE; }
+};
+
+// Byte range relative to the start of an allocation
+struct MemoryRange
+{
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+};
+
+struct MemoryHeapStats
+{
+	VkDeviceSize heapSize = 0;
+	VkDeviceSize reservedBytes = 0; // Bytes allocated from the driver
+	VkDeviceSize usedBytes = 0; // Bytes handed out to resources
+	uint32_t blockCount = 0;
+	uint32_t allocationCount = 0;
+	uint32_t dedicatedAllocationCount = 0;
+	bool deviceLocal = false;
+};
+
+class MemoryBlock
+{
+public:
+	MemoryBlock(VkDevice device, uint32_t memoryTypeIndex, VkDeviceSize blockSize, MemoryAllocationStrategy strategy, bool hostVisible);
+	~MemoryBlock();
+
+	MemoryBlock(const MemoryBlock&) = delete;
+	MemoryBlock& operator=(const MemoryBlock&) = delete;
+
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, MemoryAllocation& outAllocation);
+	void free(const MemoryAllocation& allocation);
+
+	bool isEmpty() const { return allocationCount == 0; }
+
+	VkDeviceMemory getMemory() const { return memory; }
+	VkDeviceSize getSize() const { return blockSize; }
+	VkDeviceSize getUsedBytes() const { return usedBytes; }
+	uint32_t getAllocationCount() const { return allocationCount; }
+	uint32_t getMemoryTypeIndex() const { return memoryTypeIndex; }
+
+private:
+	struct FreeRange
+	{
+		VkDeviceSize offset;
+		VkDeviceSize size;
+	};
+
+	VkDevice device;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	void* mapped = nullptr;
+
+	uint32_t memoryTypeIndex;
+	VkDeviceSize blockSize;
+	MemoryAllocationStrategy strategy;
+
+	std::vector<FreeRange> freeRanges; // Sorted by offset, only used by the free list strategy
+	VkDeviceSize linearOffset = 0;
+
+	VkDeviceSize usedBytes = 0;
+	uint32_t allocationCount = 0;
+};
+
+/*
+ * Sub-allocates buffers and images out of large VkDeviceMemory blocks so the renderer stays well
+ * below maxMemoryAllocationCount. Blocks are kept per memory type and per resource kind (linear
+ * buffers and optimal images never share a block, which sidesteps bufferImageGranularity).
+ * Host visible blocks are persistently mapped.
+ */
+class MemoryAllocator
+{
+public:
+	MemoryAllocator();
+	~MemoryAllocator();
+
+	MemoryAllocator(const MemoryAllocator&) = delete;
+	MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+	void init(VkDevice device, VkPhysicalDevice physicalDevice);
+	void cleanup();
+
+	MemoryAllocation allocate(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, bool isImage, MemoryAllocationStrategy strategy = ALLOCATION_STRATEGY_FREE_LIST);
+	void free(MemoryAllocation& allocation);
+
+	VkResult flush(const MemoryAllocation& allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+	VkResult invalidate(const MemoryAllocation& allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+
+	// Flushes every range with a single vkFlushMappedMemoryRanges call
+	VkResult flush(const MemoryAllocation& allocation, const std::vector<MemoryRange>& ranges);
+
+	std::vector<MemoryHeapStats> getHeapStats();
+	void logHeapStats();
+
+	static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+	static constexpr VkDeviceSize HOST_VISIBLE_BLOCK_SIZE = 16ull * 1024 * 1024;
+
+private:
+	enum PoolKind
+	{
+		POOL_BUFFER,
+		POOL_IMAGE,
+		POOL_LINEAR,
+		POOL_KIND_COUNT
+	};
+
+	VkDeviceSize getPreferredBlockSize(uint32_t memoryTypeIndex);
+	VkMappedMemoryRange getMappedRange(const MemoryAllocation& allocation, VkDeviceSize size, VkDeviceSize offset);
+	MemoryAllocation allocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex);
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memoryProperties{};
+	VkDeviceSize nonCoherentAtomSize = 1;
+
+	// Indexed by memoryTypeIndex * POOL_KIND_COUNT + PoolKind
+	std::vector<std::vector<std::unique_ptr<MemoryBlock>>> pools;
+	std::vector<uint32_t> dedicatedAllocationCounts;
+	std::vector<VkDeviceSize> dedicatedAllocationBytes;
+
+	std::mutex allocatorMutex;
+};
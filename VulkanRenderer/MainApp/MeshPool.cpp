@@ -0,0 +1,200 @@
+#include "MeshPool.h"
+#include "UploadContext.h"
+#include "SwapChain.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+MeshPool::MeshPool(Device& device, VkDeviceSize vertexStride, uint32_t maxVertices, uint32_t maxIndices)
+	: device{device}, vertexStride{vertexStride}, maxVertices{maxVertices}, maxIndices{maxIndices}
+{
+	vertexBuffer = std::make_unique<Buffer>(device, vertexStride, maxVertices, VERTEX_BUFFER_USAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	indexBuffer = std::make_unique<Buffer>(device, sizeof(uint32_t), maxIndices, INDEX_BUFFER_USAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	freeVertexRanges.push_back({ 0, maxVertices });
+	freeIndexRanges.push_back({ 0, maxIndices });
+
+	CORE_INFO("Created mesh pool: {0} vertices ({1:.2f} MB), {2} indices ({3:.2f} MB)", maxVertices, vertexBuffer->getBufferSize() / (1024.0 * 1024.0),
+		maxIndices, indexBuffer->getBufferSize() / (1024.0 * 1024.0))
+}
+
+MeshPool::~MeshPool()
+{
+}
+
+uint64_t MeshPool::allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, MeshAllocation& outAllocation)
+{
+	std::lock_guard<std::mutex> lock(poolMutex);
+
+	MeshAllocation allocation{};
+	allocation.vertexCount = vertexCount;
+	allocation.indexCount = indexCount;
+
+	if (!allocateRange(freeVertexRanges, vertexCount, allocation.vertexOffset))
+	{
+		grow(vertexBuffer, freeVertexRanges, maxVertices, vertexCount, VERTEX_BUFFER_USAGE);
+		allocateRange(freeVertexRanges, vertexCount, allocation.vertexOffset);
+	}
+
+	if (indexCount > 0 && !allocateRange(freeIndexRanges, indexCount, allocation.firstIndex))
+	{
+		grow(indexBuffer, freeIndexRanges, maxIndices, indexCount, INDEX_BUFFER_USAGE);
+		allocateRange(freeIndexRanges, indexCount, allocation.firstIndex);
+	}
+
+	usedVertices += vertexCount;
+	usedIndices += indexCount;
+
+	UploadContext& uploadContext = device.getUploadContext();
+	uint64_t batchId = uploadContext.uploadBuffer(vertices, vertexStride * vertexCount, vertexBuffer->getBuffer(), vertexStride * allocation.vertexOffset);
+	if (indexCount > 0)
+	{
+		batchId = uploadContext.uploadBuffer(indices, sizeof(uint32_t) * indexCount, indexBuffer->getBuffer(), sizeof(uint32_t) * allocation.firstIndex);
+	}
+
+	outAllocation = allocation;
+	return batchId;
+}
+
+void MeshPool::free(MeshAllocation& allocation)
+{
+	if (!allocation.isValid())
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(poolMutex);
+
+	// One extra frame covers the frame that is currently being recorded
+	pendingFrees.push_back({ allocation, SwapChain::MAX_FRAMES_IN_FLIGHT + 1 });
+	allocation = MeshAllocation{};
+}
+
+void MeshPool::update()
+{
+	std::lock_guard<std::mutex> lock(poolMutex);
+
+	for (size_t i = 0; i < pendingFrees.size();)
+	{
+		PendingFree& pending = pendingFrees[i];
+		if (--pending.framesLeft > 0)
+		{
+			i++;
+			continue;
+		}
+
+		freeRange(freeVertexRanges, pending.allocation.vertexOffset, pending.allocation.vertexCount);
+		if (pending.allocation.indexCount > 0)
+		{
+			freeRange(freeIndexRanges, pending.allocation.firstIndex, pending.allocation.indexCount);
+		}
+		usedVertices -= pending.allocation.vertexCount;
+		usedIndices -= pending.allocation.indexCount;
+
+		pendingFrees[i] = pendingFrees.back();
+		pendingFrees.pop_back();
+	}
+
+	UploadContext& uploadContext = device.getUploadContext();
+	for (size_t i = 0; i < retiredBuffers.size();)
+	{
+		RetiredBuffer& retired = retiredBuffers[i];
+		if (retired.framesLeft > 0)
+		{
+			retired.framesLeft--;
+		}
+		if (retired.framesLeft > 0 || !uploadContext.isComplete(retired.copyBatchId))
+		{
+			i++;
+			continue;
+		}
+
+		retiredBuffers[i] = std::move(retiredBuffers.back());
+		retiredBuffers.pop_back();
+	}
+}
+
+void MeshPool::bind(VkCommandBuffer commandBuffer)
+{
+	// The buffers are replaced when the pool grows, which may happen on a loading thread
+	std::lock_guard<std::mutex> lock(poolMutex);
+
+	VkBuffer buffers[] = { vertexBuffer->getBuffer() };
+	VkDeviceSize offsets[] = { 0 };
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+void MeshPool::grow(std::unique_ptr<Buffer>& buffer, std::vector<FreeRange>& freeRanges, uint32_t& capacity, uint32_t count, VkBufferUsageFlags usage)
+{
+	uint64_t newCapacity = std::max<uint64_t>(2ull * capacity, uint64_t(capacity) + count);
+	if (newCapacity > UINT32_MAX)
+	{
+		throw std::runtime_error("mesh pool can't grow past 2^32 elements!");
+	}
+
+	std::unique_ptr<Buffer> newBuffer = std::make_unique<Buffer>(device, buffer->getInstanceSize(), (uint32_t)newCapacity, usage,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	// Submitted right away, so any frame that binds the new buffer is submitted after the copy
+	UploadContext& uploadContext = device.getUploadContext();
+	uploadContext.copyBuffer(buffer->getBuffer(), newBuffer->getBuffer(), buffer->getBufferSize());
+	uint64_t copyBatchId = uploadContext.submit();
+
+	// One extra frame covers the frame that is currently being recorded
+	retiredBuffers.push_back({ std::move(buffer), copyBatchId, SwapChain::MAX_FRAMES_IN_FLIGHT + 1 });
+	buffer = std::move(newBuffer);
+
+	freeRange(freeRanges, capacity, (uint32_t)newCapacity - capacity);
+	CORE_INFO("Grew mesh pool buffer from {0} to {1} elements ({2:.2f} MB)", capacity, newCapacity, buffer->getBufferSize() / (1024.0 * 1024.0))
+	capacity = (uint32_t)newCapacity;
+}
+
+bool MeshPool::allocateRange(std::vector<FreeRange>& freeRanges, uint32_t count, uint32_t& outOffset)
+{
+	// First fit, ranges are sorted by offset
+	for (size_t i = 0; i < freeRanges.size(); i++)
+	{
+		FreeRange& range = freeRanges[i];
+		if (range.count < count)
+		{
+			continue;
+		}
+
+		outOffset = range.offset;
+		range.offset += count;
+		range.count -= count;
+
+		if (range.count == 0)
+		{
+			freeRanges.erase(freeRanges.begin() + i);
+		}
+		return true;
+	}
+
+	return false;
+}
+
+void MeshPool::freeRange(std::vector<FreeRange>& freeRanges, uint32_t offset, uint32_t count)
+{
+	size_t i = 0;
+	while (i < freeRanges.size() && freeRanges[i].offset < offset)
+	{
+		i++;
+	}
+
+	freeRanges.insert(freeRanges.begin() + i, { offset, count });
+
+	// Merge with the following range, then with the preceding one
+	if (i + 1 < freeRanges.size() && freeRanges[i].offset + freeRanges[i].count == freeRanges[i + 1].offset)
+	{
+		freeRanges[i].count += freeRanges[i + 1].count;
+		freeRanges.erase(freeRanges.begin() + i + 1);
+	}
+	if (i > 0 && freeRanges[i - 1].offset + freeRanges[i - 1].count == freeRanges[i].offset)
+	{
+		freeRanges[i - 1].count += freeRanges[i].count;
+		freeRanges.erase(freeRanges.begin() + i);
+	}
+}
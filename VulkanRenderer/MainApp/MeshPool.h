@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Device.h"
+#include "Buffer.h"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <memory>
+#include <mutex>
+
+// Where a mesh lives inside the shared vertex and index buffers, in elements rather than bytes
+struct MeshAllocation
+{
+	uint32_t vertexOffset = 0;
+	uint32_t vertexCount = 0;
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+
+	bool isValid() const { return vertexCount > 0; }
+};
+
+/*
+ * Owns one device-local vertex buffer and one index buffer that every Model is sub-allocated from,
+ * so a frame can bind them once and select meshes with firstIndex/vertexOffset. Freed ranges are
+ * held back for a few frames before they are reused, since frames in flight may still read them.
+ * The capacities given to the constructor are only the starting size: a buffer that runs out is
+ * replaced by one at least twice as large, its contents copied over by the upload context, and the
+ * old one kept until neither the copy nor a frame in flight can still read it.
+ */
+class MeshPool
+{
+public:
+	MeshPool(Device& device, VkDeviceSize vertexStride, uint32_t maxVertices, uint32_t maxIndices);
+	~MeshPool();
+
+	MeshPool(const MeshPool&) = delete;
+	MeshPool& operator=(const MeshPool&) = delete;
+
+	// Copies are recorded into the device's upload context, returns the id of the batch they landed in
+	uint64_t allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, MeshAllocation& outAllocation);
+	void free(MeshAllocation& allocation);
+
+	// Called once per frame, releases ranges freed long enough ago that no frame in flight can use them
+	void update();
+
+	void bind(VkCommandBuffer commandBuffer);
+
+	uint32_t getUsedVertexCount() const { return usedVertices; }
+	uint32_t getUsedIndexCount() const { return usedIndices; }
+	uint32_t getMaxVertexCount() const { return maxVertices; }
+	uint32_t getMaxIndexCount() const { return maxIndices; }
+
+	// Starting capacities, the pool grows past them
+	static constexpr uint32_t DEFAULT_MAX_VERTICES = 1024 * 1024;
+	static constexpr uint32_t DEFAULT_MAX_INDICES = 4 * 1024 * 1024;
+
+private:
+	struct FreeRange
+	{
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	struct PendingFree
+	{
+		MeshAllocation allocation;
+		uint32_t framesLeft;
+	};
+
+	struct RetiredBuffer
+	{
+		std::unique_ptr<Buffer> buffer;
+		uint64_t copyBatchId; // Upload batch that copies out of it
+		uint32_t framesLeft;
+	};
+
+	// Replaces the buffer with a larger one that has room for at least count more elements
+	void grow(std::unique_ptr<Buffer>& buffer, std::vector<FreeRange>& freeRanges, uint32_t& capacity, uint32_t count, VkBufferUsageFlags usage);
+
+	static constexpr VkBufferUsageFlags VERTEX_BUFFER_USAGE = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	static constexpr VkBufferUsageFlags INDEX_BUFFER_USAGE = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+	static bool allocateRange(std::vector<FreeRange>& freeRanges, uint32_t count, uint32_t& outOffset);
+	static void freeRange(std::vector<FreeRange>& freeRanges, uint32_t offset, uint32_t count);
+
+	Device& device;
+	VkDeviceSize vertexStride;
+	uint32_t maxVertices;
+	uint32_t maxIndices;
+
+	std::unique_ptr<Buffer> vertexBuffer;
+	std::unique_ptr<Buffer> indexBuffer;
+
+	std::vector<FreeRange> freeVertexRanges; // Sorted by offset
+	std::vector<FreeRange> freeIndexRanges;
+	std::vector<PendingFree> pendingFrees;
+	std::vector<RetiredBuffer> retiredBuffers;
+
+	uint32_t usedVertices = 0;
+	uint32_t usedIndices = 0;
+
+	std::mutex poolMutex;
+};
@@ -1,11 +1,15 @@
 #include "Model.h"
 
 #include "Utils.h"
+#include "UploadContext.h"
+#include "MeshPool.h"
 #include "Log.h"
 
 #include <cassert>
 #include <unordered_map>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
@@ -31,13 +35,26 @@ namespace std
 
 Model::Model(Device& device, const Builder& builder) : device{device}
 {
-	createVertexBuffers(builder.vertices);
-	createIndexBuffers(builder.indices);
+	vertexCount = static_cast<uint32_t>(builder.vertices.size());
+	assert(vertexCount >= 3 && "Vertex count must be at least 3");
+
+	indexCount = static_cast<uint32_t>(builder.indices.size());
+	hasIndexBuffer = indexCount > 0;
+	bounds = builder.bounds;
+
+	uploadBatchId = device.getMeshPool().allocate(builder.vertices.data(), vertexCount, builder.indices.data(), indexCount, mesh);
 }
 
 Model::~Model()
 {
+	// The range can't be handed out again while the upload into it is still pending
+	device.getUploadContext().wait(uploadBatchId);
+	device.getMeshPool().free(mesh);
+}
 
+bool Model::isResident()
+{
+	return device.getUploadContext().isComplete(uploadBatchId);
 }
 
 std::unique_ptr<Model> Model::createModelFromFile(Device& device, const std::string& filename)
@@ -56,57 +73,16 @@ std::unique_ptr<Model> Model::createModelFromFile(Device& device, const std::str
 
 void Model::bind(VkCommandBuffer commandBuffer)
 {
-	VkBuffer buffers[] = {vertexBuffer->getBuffer()};
-	VkDeviceSize offsets[] = {0};
-	vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-
-	if(hasIndexBuffer)
-		vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+	// Every model shares the pool's buffers, draws select the mesh with firstIndex/vertexOffset
+	device.getMeshPool().bind(commandBuffer);
 }
 
-void Model::draw(VkCommandBuffer commandBuffer)
+void Model::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance)
 {
 	if(hasIndexBuffer)
-		vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+		vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, mesh.firstIndex, static_cast<int32_t>(mesh.vertexOffset), firstInstance);
 	else
-		vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
-}
-
-void Model::createVertexBuffers(const std::vector<Vertex>& vertices)
-{
-	vertexCount = static_cast<uint32_t>(vertices.size());
-	assert(vertexCount >= 3 && "Vertex count must be at least 3");
-
-	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-	uint32_t vertexSize = sizeof(vertices[0]);
-
-	Buffer stagingBuffer(device, vertexSize, vertexCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	stagingBuffer.map();
-	stagingBuffer.writeToBuffer((void*)vertices.data());
-
-	vertexBuffer = std::make_unique<Buffer>(device, vertexSize, vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-	device.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
-}
-
-void Model::createIndexBuffers(const std::vector<uint32_t>& indicies)
-{
-	indexCount = static_cast<uint32_t>(indicies.size());
-	hasIndexBuffer = indexCount > 0;
-
-	if(!hasIndexBuffer)
-		return;
-
-	VkDeviceSize bufferSize = sizeof(indicies[0]) * indexCount;
-	uint32_t indexSize = sizeof(indicies[0]);
-
-	Buffer stagingBuffer(device, indexSize, indexCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	stagingBuffer.map();
-	stagingBuffer.writeToBuffer((void*)indicies.data());
-
-	indexBuffer = std::make_unique<Buffer>(device, indexSize, indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-	device.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+		vkCmdDraw(commandBuffer, vertexCount, instanceCount, mesh.vertexOffset, firstInstance);
 }
 
 std::vector<VkVertexInputBindingDescription> Model::Vertex::getBindingDescriptions()
@@ -229,4 +205,33 @@ void Model::Builder::loadModel(const std::string& filepath)
 		v1.bitangent += bitangent;
 		v2.bitangent += bitangent;
 	}
+
+	computeBounds();
 }
+
+void Model::Builder::computeBounds()
+{
+	if (vertices.empty())
+	{
+		bounds = ModelBounds{};
+		return;
+	}
+
+	bounds.min = vertices[0].position;
+	bounds.max = vertices[0].position;
+	for (const Vertex& vertex : vertices)
+	{
+		bounds.min = glm::min(bounds.min, vertex.position);
+		bounds.max = glm::max(bounds.max, vertex.position);
+	}
+
+	// Sphere around the box center, tighter than the box's half diagonal for most meshes
+	bounds.center = (bounds.min + bounds.max) * 0.5f;
+	float radiusSqr = 0.0f;
+	for (const Vertex& vertex : vertices)
+	{
+		glm::vec3 offset = vertex.position - bounds.center;
+		radiusSqr = std::max(radiusSqr, glm::dot(offset, offset));
+	}
+	bounds.radius = std::sqrt(radiusSqr);
+}
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "Device.h"
 #include "Buffer.h"
+#include "MeshPool.h"
 
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
@@ -9,6 +10,15 @@
 #include <vector>
 #include <memory>
 
+// Object space bounds of a mesh, used for culling
+struct ModelBounds
+{
+	glm::vec3 min{ 0.0f };
+	glm::vec3 max{ 0.0f };
+	glm::vec3 center{ 0.0f }; // Bounding sphere center
+	float radius = 0.0f;
+};
+
 class Model
 {
 public:
@@ -35,8 +45,10 @@ public:
 	{
 		std::vector<Vertex> vertices{};
 		std::vector<uint32_t> indices{};
+		ModelBounds bounds{};
 
 		void loadModel(const std::string& filepath);
+		void computeBounds();
 	};
 
 
@@ -49,7 +61,17 @@ public:
 	static std::unique_ptr<Model> createModelFromFile(Device& device, const std::string& filename);
 
 	void bind(VkCommandBuffer commandBuffer);
-	void draw(VkCommandBuffer commandBuffer);
+	void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+
+	bool hasIndices() const { return hasIndexBuffer; }
+	uint32_t getIndexCount() const { return indexCount; }
+	uint32_t getVertexCount() const { return vertexCount; }
+	uint32_t getFirstIndex() const { return mesh.firstIndex; }
+	int32_t getVertexOffset() const { return static_cast<int32_t>(mesh.vertexOffset); }
+	const ModelBounds& getBounds() const { return bounds; }
+
+	// True once the vertex and index uploads for this model have finished on the GPU
+	bool isResident();
 
 	void setModelPath(const std::string& path) { modelPath = path; }
 	const std::string& getModelPath() { return modelPath; }
@@ -58,17 +80,18 @@ public:
 	static const std::string modelDir;
 
 private:
-	void createVertexBuffers(const std::vector<Vertex>& vertices);
-	void createIndexBuffers(const std::vector<uint32_t>& indicies);
-
 	Device& device;
 
-	std::unique_ptr<Buffer> vertexBuffer;
+	// Handle into the device's mesh pool
+	MeshAllocation mesh;
 	uint32_t vertexCount;
 
 	bool hasIndexBuffer = false;
-	std::unique_ptr<Buffer> indexBuffer;
 	uint32_t indexCount;
 
+	ModelBounds bounds;
+
 	std::string modelPath;
+
+	uint64_t uploadBatchId = 0;
 };
\ No newline at end of file
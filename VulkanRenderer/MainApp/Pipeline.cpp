@@ -2,6 +2,7 @@
 #include "VertexBuffer.h"
 #include "Light.h"
 #include "Model.h"
+#include "PipelineCache.h"
 
 #include <array>
 #include <fstream>
@@ -24,12 +25,20 @@ Pipeline::Pipeline(Device& device, const std::string& vertFilePath, const std::s
 	
 }
 
+Pipeline::Pipeline(Device& device, const std::string& compFilePath, VkPipelineLayout pipelineLayout)
+	:device(device)
+{
+	createComputePipeline(pipelineLayout, compFilePath);
+}
+
 Pipeline::~Pipeline()
 {
 	if(vertShaderModule != VK_NULL_HANDLE)
 		vkDestroyShaderModule(device.getDevice(), vertShaderModule, nullptr);
 	if(fragShaderModule != VK_NULL_HANDLE)
 		vkDestroyShaderModule(device.getDevice(), fragShaderModule, nullptr);
+	if(compShaderModule != VK_NULL_HANDLE)
+		vkDestroyShaderModule(device.getDevice(), compShaderModule, nullptr);
 	vkDestroyPipeline(device.getDevice(), graphicsPipeline, nullptr);
 }
 
@@ -44,6 +53,9 @@ void Pipeline::createGraphicsPipeline(const PipelineConfigInfo& configInfo, cons
 	createShaderModule(vertShaderCode, &vertShaderModule);
 	createShaderModule(fragShaderCode, &fragShaderModule);
 
+	VkSpecializationInfo specializationStorage;
+	const VkSpecializationInfo* specializationInfo = getSpecializationInfo(configInfo, specializationStorage);
+
 	VkPipelineShaderStageCreateInfo shaderStages[2];
 	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
@@ -51,14 +63,14 @@ void Pipeline::createGraphicsPipeline(const PipelineConfigInfo& configInfo, cons
 	shaderStages[0].pName = "main";
 	shaderStages[0].flags = 0;
 	shaderStages[0].pNext = nullptr;
-	shaderStages[0].pSpecializationInfo = nullptr;
+	shaderStages[0].pSpecializationInfo = specializationInfo;
 	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 	shaderStages[1].module = fragShaderModule;
 	shaderStages[1].pName = "main";
 	shaderStages[1].flags = 0;
 	shaderStages[1].pNext = nullptr;
-	shaderStages[1].pSpecializationInfo = nullptr;
+	shaderStages[1].pSpecializationInfo = specializationInfo;
 
 	std::vector<VkVertexInputBindingDescription> bindingDescriptions = configInfo.bindingDescriptions;
 	std::vector<VkVertexInputAttributeDescription> attributeDescriptions = configInfo.attributeDescriptions;
@@ -89,7 +101,7 @@ void Pipeline::createGraphicsPipeline(const PipelineConfigInfo& configInfo, cons
 	pipelineInfo.basePipelineIndex = -1;
 	pipelineInfo.basePipelineHandle = nullptr;
 
-	VkResult result = vkCreateGraphicsPipelines(device.getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline);
+	VkResult result = vkCreateGraphicsPipelines(device.getDevice(), device.getPipelineCache().getCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline);
 
 	if (result != VK_SUCCESS)
 	{
@@ -106,6 +118,9 @@ void Pipeline::createDepthPipeline(const PipelineConfigInfo& configInfo, const s
 
 	createShaderModule(vertShaderCode, &vertShaderModule);
 
+	VkSpecializationInfo specializationStorage;
+	const VkSpecializationInfo* specializationInfo = getSpecializationInfo(configInfo, specializationStorage);
+
 	VkPipelineShaderStageCreateInfo shaderStages[1];
 	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
@@ -113,7 +128,7 @@ void Pipeline::createDepthPipeline(const PipelineConfigInfo& configInfo, const s
 	shaderStages[0].pName = "main";
 	shaderStages[0].flags = 0;
 	shaderStages[0].pNext = nullptr;
-	shaderStages[0].pSpecializationInfo = nullptr;
+	shaderStages[0].pSpecializationInfo = specializationInfo;
 
 	std::vector<VkVertexInputBindingDescription> bindingDescriptions = configInfo.bindingDescriptions;
 	std::vector<VkVertexInputAttributeDescription> attributeDescriptions = configInfo.attributeDescriptions;
@@ -144,7 +159,7 @@ void Pipeline::createDepthPipeline(const PipelineConfigInfo& configInfo, const s
 	pipelineInfo.basePipelineIndex = -1;
 	pipelineInfo.basePipelineHandle = nullptr;
 
-	VkResult result = vkCreateGraphicsPipelines(device.getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline);
+	VkResult result = vkCreateGraphicsPipelines(device.getDevice(), device.getPipelineCache().getCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline);
 
 	if (result != VK_SUCCESS)
 	{
@@ -152,6 +167,38 @@ void Pipeline::createDepthPipeline(const PipelineConfigInfo& configInfo, const s
 	}
 }
 
+void Pipeline::createComputePipeline(VkPipelineLayout pipelineLayout, const std::string& compFilePath)
+{
+	assert(pipelineLayout != VK_NULL_HANDLE && "Cannot create compute pipeline: no pipelineLayout provided");
+
+	std::vector<char> compShaderCode = readFile(compFilePath);
+
+	createShaderModule(compShaderCode, &compShaderModule);
+
+	VkPipelineShaderStageCreateInfo shaderStage{};
+	shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	shaderStage.module = compShaderModule;
+	shaderStage.pName = "main";
+	shaderStage.flags = 0;
+	shaderStage.pNext = nullptr;
+	shaderStage.pSpecializationInfo = nullptr;
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = shaderStage;
+	pipelineInfo.layout = pipelineLayout;
+	pipelineInfo.basePipelineIndex = -1;
+	pipelineInfo.basePipelineHandle = nullptr;
+
+	VkResult result = vkCreateComputePipelines(device.getDevice(), device.getPipelineCache().getCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline);
+
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create compute pipeline!");
+	}
+}
+
 void Pipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule)
 {
 	VkShaderModuleCreateInfo createInfo{};
@@ -258,6 +305,37 @@ void Pipeline::disableWireframe(PipelineConfigInfo& configInfo)
 	configInfo.rasterizationInfo.polygonMode = VK_POLYGON_MODE_FILL;
 }
 
+void Pipeline::setSpecializationConstant(PipelineConfigInfo& configInfo, uint32_t constantID, uint32_t value)
+{
+	for (const VkSpecializationMapEntry& entry : configInfo.specializationEntries)
+	{
+		if (entry.constantID == constantID)
+		{
+			configInfo.specializationData[entry.offset / sizeof(uint32_t)] = value;
+			return;
+		}
+	}
+
+	VkSpecializationMapEntry entry{};
+	entry.constantID = constantID;
+	entry.offset = static_cast<uint32_t>(configInfo.specializationData.size() * sizeof(uint32_t));
+	entry.size = sizeof(uint32_t);
+	configInfo.specializationEntries.push_back(entry);
+	configInfo.specializationData.push_back(value);
+}
+
+const VkSpecializationInfo* Pipeline::getSpecializationInfo(const PipelineConfigInfo& configInfo, VkSpecializationInfo& specializationInfo)
+{
+	if (configInfo.specializationEntries.empty())
+		return nullptr;
+
+	specializationInfo.mapEntryCount = static_cast<uint32_t>(configInfo.specializationEntries.size());
+	specializationInfo.pMapEntries = configInfo.specializationEntries.data();
+	specializationInfo.dataSize = configInfo.specializationData.size() * sizeof(uint32_t);
+	specializationInfo.pData = configInfo.specializationData.data();
+	return &specializationInfo;
+}
+
 void Pipeline::bindPipeline(VkCommandBuffer commandBuffer, VkPipelineBindPoint pipelineBindPoint)
 {
 	vkCmdBindPipeline(commandBuffer, pipelineBindPoint, graphicsPipeline);
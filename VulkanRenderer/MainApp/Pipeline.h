@@ -1,6 +1,4 @@
-#ifndef PIPELINE_H
-#define PIPELINE_H
-#endif
+#pragma once
 
 #define GLFW_INCLUDE_VULKAN
 
@@ -37,6 +35,10 @@ struct PipelineConfigInfo
 	VkPipelineLayout pipelineLayout = nullptr;
 	VkRenderPass renderPass = nullptr;
 	uint32_t subpass = 0;
+
+	// Specialization constants, 32 bits each and given to every stage. Stages without a constant of that id ignore it.
+	std::vector<VkSpecializationMapEntry> specializationEntries{};
+	std::vector<uint32_t> specializationData{};
 };
 
 class Pipeline
@@ -46,6 +48,7 @@ public:
 
 	//Pipeline(VkDevice device);
 	Pipeline(Device& device, const std::string& vertFilePath, const std::string& fragFilePath, const PipelineConfigInfo& configInfo, PipelineType type = PIPELINE_TYPE_DEFAULT);
+	Pipeline(Device& device, const std::string& compFilePath, VkPipelineLayout pipelineLayout);
 
 	~Pipeline();
 
@@ -54,6 +57,7 @@ public:
 
 	void createGraphicsPipeline(const PipelineConfigInfo& configInfo, const std::string& vertFilePath, const std::string& fragFilePath);
 	void createDepthPipeline(const PipelineConfigInfo& configInfo, const std::string& vertFilePath);
+	void createComputePipeline(VkPipelineLayout pipelineLayout, const std::string& compFilePath);
 
 	void createShaderModule(const std::vector<char>& code,  VkShaderModule* shaderModule);
 
@@ -61,6 +65,8 @@ public:
 	static void enableAlphaBlending(PipelineConfigInfo& configInfo);
 	static void enableWireframe(PipelineConfigInfo& configInfo);
 	static void disableWireframe(PipelineConfigInfo& configInfo);
+	// Bools are 32 bits in SPIR-V, so they are set with 0 or 1
+	static void setSpecializationConstant(PipelineConfigInfo& configInfo, uint32_t constantID, uint32_t value);
 
 	void bindPipeline(VkCommandBuffer commandBuffer, VkPipelineBindPoint pipelineBindPoint);
 	void bind(VkCommandBuffer commandBuffer);
@@ -69,6 +75,8 @@ public:
 
 private:
 	static std::vector<char> readFile(const std::string& filename);
+	// Points into the config, null if it has no constants
+	static const VkSpecializationInfo* getSpecializationInfo(const PipelineConfigInfo& configInfo, VkSpecializationInfo& specializationInfo);
 
 private:
 
@@ -78,6 +86,7 @@ private:
 
 	VkShaderModule vertShaderModule = VK_NULL_HANDLE;
 	VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+	VkShaderModule compShaderModule = VK_NULL_HANDLE;
 	//
 
 };
@@ -0,0 +1,146 @@
+#include "PipelineBatch.h"
+#include "JobSystem.h"
+
+#include <exception>
+#include <filesystem>
+
+PipelineBatch::PipelineBatch(Device& device)
+	: device{device}
+{
+}
+
+PipelineConfigInfo& PipelineBatch::addGraphicsPipeline(std::unique_ptr<Pipeline>& target, const std::string& vertFilePath, const std::string& fragFilePath,
+	PipelineType type)
+{
+	Description description;
+	description.target = &target;
+	description.vertFilePath = vertFilePath;
+	description.fragFilePath = fragFilePath;
+	description.configInfo = std::make_unique<PipelineConfigInfo>();
+	description.type = type;
+
+	descriptions.push_back(std::move(description));
+	return *descriptions.back().configInfo;
+}
+
+void PipelineBatch::addComputePipeline(std::unique_ptr<Pipeline>& target, const std::string& compFilePath, VkPipelineLayout pipelineLayout)
+{
+	Description description;
+	description.target = &target;
+	description.compFilePath = compFilePath;
+	description.pipelineLayout = pipelineLayout;
+
+	descriptions.push_back(std::move(description));
+}
+
+void PipelineBatch::build(JobSystem& jobSystem)
+{
+	std::vector<uint32_t> indices;
+	for (uint32_t i = 0; i < size(); i++)
+	{
+		if (!descriptions[i].built && !descriptions[i].failed)
+			indices.push_back(i);
+	}
+
+	buildDescriptions(indices, jobSystem, nullptr, true);
+}
+
+uint32_t PipelineBatch::rebuild(const std::vector<std::string>& changedFiles, JobSystem& jobSystem, std::vector<std::unique_ptr<Pipeline>>& retired)
+{
+	std::vector<uint32_t> indices;
+	for (uint32_t i = 0; i < size(); i++)
+	{
+		const Description& description = descriptions[i];
+		for (const std::string& file : changedFiles)
+		{
+			if ((description.built || description.failed) && description.usesFile(file))
+			{
+				indices.push_back(i);
+				break;
+			}
+		}
+	}
+
+	buildDescriptions(indices, jobSystem, &retired, false);
+	return static_cast<uint32_t>(indices.size());
+}
+
+void PipelineBatch::replaceRenderPass(VkRenderPass oldRenderPass, VkRenderPass newRenderPass)
+{
+	for (Description& description : descriptions)
+	{
+		if (description.configInfo && description.configInfo->renderPass == oldRenderPass)
+			description.configInfo->renderPass = newRenderPass;
+	}
+}
+
+void PipelineBatch::buildDescriptions(const std::vector<uint32_t>& indices, JobSystem& jobSystem, std::vector<std::unique_ptr<Pipeline>>* retired,
+	bool keepBuilt)
+{
+	std::vector<std::unique_ptr<Pipeline>> pipelines(indices.size());
+	std::vector<std::exception_ptr> errors(indices.size());
+
+	// One pipeline per job, they differ too much in cost to batch them evenly.
+	// Exceptions can't leave a job, so they are kept and rethrown on this thread.
+	jobSystem.parallelFor(static_cast<uint32_t>(indices.size()), 1, [&](uint32_t begin, uint32_t end, uint32_t threadIndex)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			const Description& description = descriptions[indices[i]];
+			try
+			{
+				if (description.configInfo)
+					pipelines[i] = std::make_unique<Pipeline>(device, description.vertFilePath, description.fragFilePath, *description.configInfo, description.type);
+				else
+					pipelines[i] = std::make_unique<Pipeline>(device, description.compFilePath, description.pipelineLayout);
+			}
+			catch (...)
+			{
+				errors[i] = std::current_exception();
+			}
+		}
+	});
+
+	std::exception_ptr firstError;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		if (!errors[i])
+			continue;
+
+		if (!firstError)
+			firstError = errors[i];
+		if (keepBuilt)
+			descriptions[indices[i]].failed = true;
+	}
+
+	if (firstError && !keepBuilt)
+		std::rethrow_exception(firstError);
+
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		if (!pipelines[i])
+			continue;
+
+		Description& description = descriptions[indices[i]];
+		if (retired && *description.target)
+			retired->push_back(std::move(*description.target));
+
+		*description.target = std::move(pipelines[i]);
+		description.built = true;
+		description.failed = false;
+	}
+
+	if (firstError)
+		std::rethrow_exception(firstError);
+}
+
+bool PipelineBatch::Description::usesFile(const std::string& filePath) const
+{
+	std::filesystem::path path = std::filesystem::path(filePath).lexically_normal();
+	for (const std::string* file : { &vertFilePath, &fragFilePath, &compFilePath })
+	{
+		if (!file->empty() && std::filesystem::path(*file).lexically_normal() == path)
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Device.h"
+#include "Pipeline.h"
+
+#include <vector>
+#include <memory>
+#include <string>
+
+class JobSystem;
+
+/*
+ * Pipelines described up front and created together. Systems add their pipelines to a batch while
+ * they set up on the main thread, filling in a config the batch owns, then build() reads the SPIR-V
+ * and compiles them all at once on the job system. Every pipeline goes through the device's pipeline
+ * cache, which Vulkan lets several threads use at the same time.
+ * The descriptions are kept after building, so pipelines can be rebuilt when their shaders change.
+ */
+class PipelineBatch
+{
+public:
+	PipelineBatch(Device& device);
+
+	PipelineBatch(const PipelineBatch&) = delete;
+	PipelineBatch& operator=(const PipelineBatch&) = delete;
+
+	// The returned config is read when the pipeline is built, target is only assigned then.
+	// Both must outlive the batch.
+	PipelineConfigInfo& addGraphicsPipeline(std::unique_ptr<Pipeline>& target, const std::string& vertFilePath, const std::string& fragFilePath,
+		PipelineType type = PIPELINE_TYPE_DEFAULT);
+	void addComputePipeline(std::unique_ptr<Pipeline>& target, const std::string& compFilePath, VkPipelineLayout pipelineLayout);
+
+	// Creates every pipeline that hasn't been built or failed yet, one job each. The ones that fail are
+	// marked so later builds skip them, the others are still created, then the first error is rethrown.
+	void build(JobSystem& jobSystem);
+
+	// Recreates the built or failed pipelines that load any of the given SPIR-V files, returns how many there were.
+	// The pipelines they replace are moved to retired, since frames in flight may still be using them.
+	// If any of them fails the first error is rethrown and no target is changed.
+	uint32_t rebuild(const std::vector<std::string>& changedFiles, JobSystem& jobSystem, std::vector<std::unique_ptr<Pipeline>>& retired);
+
+	// Points pipelines made for a render pass that has been destroyed at its compatible replacement
+	void replaceRenderPass(VkRenderPass oldRenderPass, VkRenderPass newRenderPass);
+
+	uint32_t size() const { return static_cast<uint32_t>(descriptions.size()); }
+
+private:
+	struct Description
+	{
+		std::unique_ptr<Pipeline>* target;
+		std::string vertFilePath, fragFilePath, compFilePath;
+		// Heap allocated since the config points into itself, null for compute pipelines
+		std::unique_ptr<PipelineConfigInfo> configInfo;
+		PipelineType type = PIPELINE_TYPE_DEFAULT;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		bool built = false;
+		bool failed = false; // Skipped by build() until a rebuild succeeds
+
+		bool usesFile(const std::string& filePath) const;
+	};
+
+	// Builds the pipelines of the given descriptions, the old ones are moved to retired if there is somewhere to put them.
+	// With keepBuilt the pipelines that succeeded are kept when others fail, otherwise none are.
+	void buildDescriptions(const std::vector<uint32_t>& indices, JobSystem& jobSystem, std::vector<std::unique_ptr<Pipeline>>* retired, bool keepBuilt);
+
+	Device& device;
+	std::vector<Description> descriptions;
+};
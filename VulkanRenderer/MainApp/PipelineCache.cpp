@@ -0,0 +1,164 @@
+#include "PipelineCache.h"
+#include "Log.h"
+#include "Utils.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+PipelineCache::PipelineCache(Device& device, const std::string& filePath)
+	: device{device}, filePath{filePath}
+{
+	std::vector<char> data = load();
+	warm = !data.empty();
+
+	VkPipelineCacheCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = data.size();
+	createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	if (vkCreatePipelineCache(device.getDevice(), &createInfo, nullptr, &cache) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create pipeline cache!");
+	}
+
+	if (warm)
+		CORE_INFO("Loaded pipeline cache: {0:.2f} KB from {1}", data.size() / 1024.0, filePath)
+	else
+		CORE_INFO("No usable pipeline cache at {0}, starting cold", filePath)
+}
+
+PipelineCache::~PipelineCache()
+{
+	vkDestroyPipelineCache(device.getDevice(), cache, nullptr);
+}
+
+void PipelineCache::save()
+{
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(device.getDevice(), cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+	{
+		return;
+	}
+
+	std::vector<char> data(dataSize);
+	if (vkGetPipelineCacheData(device.getDevice(), cache, &dataSize, data.data()) != VK_SUCCESS)
+	{
+		CORE_WARN("Failed to read back the pipeline cache, it won't be saved")
+		return;
+	}
+	data.resize(dataSize);
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(filePath).parent_path(), error);
+
+	// Written to a temporary file first, so a crash mid-write can't leave a truncated cache behind
+	std::string tempPath = filePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			CORE_WARN("Failed to open {0} to save the pipeline cache", tempPath)
+			return;
+		}
+
+		FileHeader header = makeHeader(data.size(), Utils::hashBytes(data.data(), data.size()));
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(data.data(), data.size());
+		if (!file.good())
+		{
+			CORE_WARN("Failed to write the pipeline cache to {0}", tempPath)
+			return;
+		}
+	}
+
+	std::filesystem::rename(tempPath, filePath, error);
+	if (error)
+	{
+		CORE_WARN("Failed to replace {0}: {1}", filePath, error.message())
+		return;
+	}
+
+	CORE_INFO("Saved pipeline cache: {0:.2f} KB to {1}", data.size() / 1024.0, filePath)
+}
+
+std::vector<char> PipelineCache::load()
+{
+	std::ifstream file(filePath, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+	{
+		return {};
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+	if (fileSize < sizeof(FileHeader))
+	{
+		CORE_WARN("Pipeline cache {0} is truncated, ignoring it", filePath)
+		return {};
+	}
+
+	FileHeader header;
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	// Another GPU or driver can't use the data, the driver would at best throw it away
+	FileHeader expected = makeHeader(0, 0);
+	if (header.magic != expected.magic || header.version != expected.version)
+	{
+		CORE_WARN("Pipeline cache {0} has an unknown format, ignoring it", filePath)
+		return {};
+	}
+	if (header.vendorID != expected.vendorID || header.deviceID != expected.deviceID || header.driverVersion != expected.driverVersion ||
+		memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		CORE_INFO("Pipeline cache {0} was written by another device or driver, ignoring it", filePath)
+		return {};
+	}
+	if (header.dataSize != fileSize - sizeof(FileHeader))
+	{
+		CORE_WARN("Pipeline cache {0} is truncated, ignoring it", filePath)
+		return {};
+	}
+
+	std::vector<char> data(header.dataSize);
+	file.read(data.data(), data.size());
+	if (!file.good() || Utils::hashBytes(data.data(), data.size()) != header.dataHash)
+	{
+		CORE_WARN("Pipeline cache {0} is corrupt, ignoring it", filePath)
+		return {};
+	}
+
+	// The driver's own header must agree too: length, version 1, vendor, device, then the UUID
+	const size_t vulkanHeaderSize = 16 + VK_UUID_SIZE;
+	uint32_t vulkanHeader[4] = {};
+	if (data.size() >= vulkanHeaderSize)
+	{
+		memcpy(vulkanHeader, data.data(), sizeof(vulkanHeader));
+	}
+	if (data.size() < vulkanHeaderSize || vulkanHeader[0] < vulkanHeaderSize || vulkanHeader[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+		vulkanHeader[2] != expected.vendorID || vulkanHeader[3] != expected.deviceID ||
+		memcmp(data.data() + 16, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		CORE_WARN("Pipeline cache {0} holds data for another device, ignoring it", filePath)
+		return {};
+	}
+
+	return data;
+}
+
+PipelineCache::FileHeader PipelineCache::makeHeader(size_t dataSize, uint64_t dataHash) const
+{
+	const VkPhysicalDeviceProperties& properties = device.properties;
+
+	FileHeader header{};
+	header.magic = FILE_MAGIC;
+	header.version = FILE_VERSION;
+	header.vendorID = properties.vendorID;
+	header.deviceID = properties.deviceID;
+	header.driverVersion = properties.driverVersion;
+	memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = dataSize;
+	header.dataHash = dataHash;
+	return header;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Device.h"
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+
+/*
+ * A VkPipelineCache that persists across runs. The file starts with a header holding the vendor ID,
+ * device ID, driver version and pipeline cache UUID it was written with, plus the size and a hash of
+ * the data. Anything that doesn't match the current device, or is truncated or corrupt, is ignored and
+ * the cache starts empty rather than handing the driver data it might choke on.
+ */
+class PipelineCache
+{
+public:
+	PipelineCache(Device& device, const std::string& filePath);
+	~PipelineCache();
+
+	PipelineCache(const PipelineCache&) = delete;
+	PipelineCache& operator=(const PipelineCache&) = delete;
+
+	// Writes the cache to disk, the device must not be creating pipelines at the same time
+	void save();
+
+	VkPipelineCache getCache() const { return cache; }
+	// True if valid data from a previous run was loaded
+	bool isWarm() const { return warm; }
+
+	static constexpr const char* DEFAULT_PATH = "MainApp/cache/pipeline_cache.bin";
+
+private:
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t dataSize;
+		uint64_t dataHash;
+	};
+
+	static constexpr uint32_t FILE_MAGIC = 0x43504b56; // "VKPC"
+	static constexpr uint32_t FILE_VERSION = 1;
+
+	// Returns the cache data stored in the file, or nothing if it can't be used on this device
+	std::vector<char> load();
+	FileHeader makeHeader(size_t dataSize, uint64_t dataHash) const;
+
+	Device& device;
+	std::string filePath;
+	VkPipelineCache cache = VK_NULL_HANDLE;
+	bool warm = false;
+};
@@ -14,11 +14,13 @@ RenderPass::~RenderPass()
 	
 }
 
-void RenderPass::begin(VkCommandBuffer commandBuffer, int frameIndex)
+void RenderPass::begin(VkCommandBuffer commandBuffer, int frameIndex, bool continuePass, VkSubpassContents contents)
 {
+	assert((!continuePass || continueRenderPass != VK_NULL_HANDLE) && "Render pass has no continue variant!");
+
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = renderPass;
+	renderPassInfo.renderPass = continuePass ? continueRenderPass : renderPass;
 	renderPassInfo.framebuffer = framebuffers[frameIndex];
 	renderPassInfo.renderArea.offset = { 0, 0 };
 	renderPassInfo.renderArea.extent = {width, height};
@@ -30,8 +32,17 @@ void RenderPass::begin(VkCommandBuffer commandBuffer, int frameIndex)
 	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 	renderPassInfo.pClearValues = clearValues.data();
 
-	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+
+	// Only secondary command buffers may record into the pass, they set their own viewport
+	if (contents == VK_SUBPASS_CONTENTS_INLINE)
+	{
+		setViewportAndScissor(commandBuffer);
+	}
+}
 
+void RenderPass::setViewportAndScissor(VkCommandBuffer commandBuffer)
+{
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
@@ -44,6 +55,17 @@ void RenderPass::begin(VkCommandBuffer commandBuffer, int frameIndex)
 	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
 
+VkCommandBufferInheritanceInfo RenderPass::getInheritanceInfo(int frameIndex)
+{
+	// The continue pass is compatible with the main one, so one inheritance info covers both
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = renderPass;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = framebuffers[frameIndex];
+	return inheritanceInfo;
+}
+
 void RenderPass::end(VkCommandBuffer commandBuffer)
 {
 	vkCmdEndRenderPass(commandBuffer);
@@ -64,7 +86,7 @@ void RenderPass::createRenderPass(Device& device, uint32_t passWidth, uint32_t p
 	depthAttachment.format = depthFormat;
 	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE; // Read back by the Hi-Z build between the two draw phases
 	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -117,9 +139,72 @@ void RenderPass::createRenderPass(Device& device, uint32_t passWidth, uint32_t p
 		throw std::runtime_error("failed to create render pass!");
 	}
 
+	createContinueRenderPass(device);
 	createRenderPassFramebuffers(device, width, height);
 }
 
+void RenderPass::createContinueRenderPass(Device& device)
+{
+	// Same attachments as the main pass, so its framebuffers and pipelines are compatible
+	VkAttachmentDescription depthAttachment{};
+	depthAttachment.format = depthFormat;
+	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference depthAttachmentRef{};
+	depthAttachmentRef.attachment = 1;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentDescription colorAttachment = {};
+	colorAttachment.format = imageFormat;
+	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	VkAttachmentReference colorAttachmentRef = {};
+	colorAttachmentRef.attachment = 0;
+	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorAttachmentRef;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+	// Waits for the color written by the first pass, depth is handed back with an explicit barrier
+	VkSubpassDependency dependency = {};
+	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependency.dstSubpass = 0;
+	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
+	VkRenderPassCreateInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+	renderPassInfo.pAttachments = attachments.data();
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = 1;
+	renderPassInfo.pDependencies = &dependency;
+
+	if (vkCreateRenderPass(device.getDevice(), &renderPassInfo, nullptr, &continueRenderPass) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create continue render pass!");
+	}
+}
+
 void RenderPass::createRenderPassFramebuffers(Device& device, uint32_t framebufferWidth, uint32_t framebufferHeight)
 {
 	assert(maxFramebuffers > 0 && "RenderPass must have at least 1 frame buffer");
@@ -227,23 +312,23 @@ void RenderPass::cleanup(Device& device)
 
 		if ((uint32_t)colors.size() > 0)
 		{
-			for (FrameBufferAttachment color : colors)
+			for (FrameBufferAttachment& color : colors)
 			{
 				vkDestroyImageView(device.getDevice(), color.view, nullptr);
 				if(shouldDestroyColorImages)
 					vkDestroyImage(device.getDevice(), color.image, nullptr);
-				vkFreeMemory(device.getDevice(), color.memory, nullptr);
+				device.freeMemory(color.memory);
 			}
 		}
 		
 		if ((uint32_t)depths.size() > 0)
 		{
-			for (FrameBufferAttachment depth : depths)
+			for (FrameBufferAttachment& depth : depths)
 			{
 				vkDestroyImageView(device.getDevice(), depth.view, nullptr);
 				if(shouldDestroyDepthImages)
 					vkDestroyImage(device.getDevice(), depth.image, nullptr);
-				vkFreeMemory(device.getDevice(), depth.memory, nullptr);
+				device.freeMemory(depth.memory);
 			}
 		}
 
@@ -256,6 +341,11 @@ void RenderPass::cleanup(Device& device)
 		}
 
 		vkDestroyRenderPass(device.getDevice(), renderPass, nullptr);
+		if (continueRenderPass != VK_NULL_HANDLE)
+		{
+			vkDestroyRenderPass(device.getDevice(), continueRenderPass, nullptr);
+			continueRenderPass = VK_NULL_HANDLE;
+		}
 	}
 }
 
@@ -1,12 +1,14 @@
 #pragma once
 
+#include "MemoryAllocator.h"
+
 #include <vulkan/vulkan.h>
 #include <vector>
 
 struct FrameBufferAttachment
 {
 	VkImage image;
-	VkDeviceMemory memory;
+	MemoryAllocation memory;
 	VkImageView view;
 };
 
@@ -16,9 +18,15 @@ public:
 	RenderPass();
 	~RenderPass();
 
-	void begin(VkCommandBuffer commandBuffer, int frameIndex = 0);
+	// Continuing a pass loads the attachments rendered so far instead of clearing them
+	// With secondary command buffer contents the pass is only recorded into through vkCmdExecuteCommands
+	void begin(VkCommandBuffer commandBuffer, int frameIndex = 0, bool continuePass = false, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 	void end(VkCommandBuffer commandBuffer);
 
+	void setViewportAndScissor(VkCommandBuffer commandBuffer);
+	// For secondary command buffers that continue this pass
+	VkCommandBufferInheritanceInfo getInheritanceInfo(int frameIndex);
+
 	void setMaxFramebufferCount(uint32_t count) { maxFramebuffers = count; }
 	VkFramebuffer getFramebuffer(int index) { return framebuffers[index]; }
 
@@ -32,6 +40,7 @@ public:
 	virtual void createRenderPassFramebuffers(class Device& device, uint32_t framebufferWidth, uint32_t framebufferHeight);
 	virtual void createRenderPassSampler(class Device& device);
 	virtual void createRenderPassImageViews(class Device& device);
+	void createContinueRenderPass(class Device& device);
 
 	virtual void cleanup(class Device& device);
 
@@ -39,6 +48,7 @@ public:
 	std::vector<VkFramebuffer> framebuffers;
 	std::vector<FrameBufferAttachment> colors, depths;
 	VkRenderPass renderPass;
+	VkRenderPass continueRenderPass = VK_NULL_HANDLE;
 	VkSampler sampler = VK_NULL_HANDLE;
 	VkDescriptorImageInfo descriptor;
 	VkClearColorValue clearColor = { {0.01f, 0.01f, 0.01f, 1.0f} };
@@ -0,0 +1,219 @@
+#include "CullingSystem.h"
+#include "../Pipeline.h"
+#include "../PipelineBatch.h"
+#include "../SwapChain.h"
+#include "../IndirectDrawList.h"
+#include "../LayoutCache.h"
+
+#include <array>
+
+// Matches CullData in FrustumCull.comp, std140
+struct CullData
+{
+	glm::vec4 frustumPlanes[6];
+	glm::mat4 viewProj;
+	glm::mat4 hizViewProj;
+	glm::vec2 depthSize;
+	uint32_t hizMipCount;
+	uint32_t objectCount;
+	uint32_t commandOffset;
+	uint32_t cullingEnabled;
+	uint32_t occlusionEnabled;
+	uint32_t hizValid;
+};
+
+struct CullPushConstants
+{
+	uint32_t phase;
+};
+
+static const char* SHADER_PATH = "MainApp/resources/vulkan/shaders/FrustumCullComp.spv";
+
+CullingSystem::CullingSystem(Device& device)
+	: device{ device }
+{
+}
+
+CullingSystem::~CullingSystem()
+{
+	cleanup();
+}
+
+void CullingSystem::init(IndirectDrawList& drawList, RenderPass& renderPass, PipelineBatch& batch)
+{
+	hiz.init(batch);
+	hiz.createResources(renderPass);
+
+	shaders = ShaderReflection({ SHADER_PATH });
+
+	createBuffers(drawList);
+	createDescriptorSets(drawList);
+	createPipelineLayout();
+	createPipeline(batch);
+}
+
+void CullingSystem::cleanup()
+{
+	pipeline.reset();
+	pipelineLayout = VK_NULL_HANDLE;
+
+	descriptorSets.clear();
+	descriptorPool = nullptr;
+	cullSetLayout = nullptr;
+
+	occludedBuffers.clear();
+	cullDataBuffers.clear();
+
+	hiz.cleanup();
+}
+
+void CullingSystem::onSwapChainRecreated(RenderPass& renderPass)
+{
+	hiz.createResources(renderPass);
+	hizBuiltLastFrame = false;
+
+	VkDescriptorImageInfo hizInfo = hiz.getDescriptorInfo();
+	for (VkDescriptorSet& set : descriptorSets)
+	{
+		DescriptorWriter(*cullSetLayout, *descriptorPool)
+			.writeImage(6, &hizInfo)
+			.overwrite(set);
+	}
+}
+
+void CullingSystem::cull(FrameInfo& frameInfo)
+{
+	IndirectDrawList& drawList = *frameInfo.drawList;
+
+	// Without indirect firstInstance the draw list falls back to CPU instance counts, so nothing may be dropped
+	bool cullingEnabled = frameInfo.cullingMode == CULLING_GPU && device.supportsDrawIndirectFirstInstance();
+
+	CullData data{};
+	std::array<glm::vec4, 6> planes = frameInfo.camera.getFrustumPlanes();
+	for (size_t i = 0; i < planes.size(); i++)
+	{
+		data.frustumPlanes[i] = planes[i];
+	}
+	data.viewProj = frameInfo.camera.proj * frameInfo.camera.view;
+	data.hizViewProj = hizViewProj;
+	data.depthSize = hiz.getDepthSize();
+	data.hizMipCount = hiz.getMipCount();
+	data.objectCount = drawList.getObjectCount();
+	data.commandOffset = drawList.getMaxObjects();
+	data.cullingEnabled = cullingEnabled ? 1 : 0;
+	data.occlusionEnabled = cullingEnabled && frameInfo.occlusionCulling ? 1 : 0;
+	data.hizValid = hizBuiltLastFrame ? 1 : 0;
+
+	cullDataBuffers[frameInfo.frameIndex]->writeToBuffer(&data);
+	frameViewProj = data.viewProj;
+
+	// The pyramid only stays valid while every frame rebuilds it
+	if (!data.occlusionEnabled)
+		hizBuiltLastFrame = false;
+
+	if (data.objectCount == 0)
+		return;
+
+	dispatch(frameInfo, 0);
+}
+
+void CullingSystem::cullSecondPhase(FrameInfo& frameInfo, uint32_t imageIndex)
+{
+	hiz.build(frameInfo.commandBuffer, imageIndex);
+	hizViewProj = frameViewProj;
+	hizBuiltLastFrame = true;
+
+	if (frameInfo.drawList->getObjectCount() == 0)
+		return;
+
+	dispatch(frameInfo, 1);
+}
+
+void CullingSystem::dispatch(FrameInfo& frameInfo, uint32_t phase)
+{
+	uint32_t objectCount = frameInfo.drawList->getObjectCount();
+
+	CullPushConstants push{};
+	push.phase = phase;
+
+	pipeline->bindPipeline(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+	vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[frameInfo.frameIndex], 0, nullptr);
+	vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &push);
+
+	vkCmdDispatch(frameInfo.commandBuffer, (objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+	// Instance counts feed the indirect draws, visible indices are read by the vertex shaders and occluded flags by the second phase
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(frameInfo.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void CullingSystem::createBuffers(IndirectDrawList& drawList)
+{
+	occludedBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+	cullDataBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+	for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		occludedBuffers[i] = std::make_unique<Buffer>(device, sizeof(uint32_t), drawList.getMaxObjects(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		cullDataBuffers[i] = std::make_unique<Buffer>(device, sizeof(CullData), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		cullDataBuffers[i]->map();
+	}
+}
+
+void CullingSystem::createDescriptorSets(IndirectDrawList& drawList)
+{
+	// Objects, draw commands, visible indices, stats, occluded flags, cull data and the Hi-Z pyramid
+	cullSetLayout = &device.getLayoutCache().getSetLayout(shaders, 0);
+
+	descriptorPool = DescriptorPool::Builder(device)
+		.setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT * 5)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+		.build();
+
+	VkDescriptorImageInfo hizInfo = hiz.getDescriptorInfo();
+
+	descriptorSets.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+	for (int i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		VkDescriptorBufferInfo objectInfo = drawList.getObjectBufferInfo(i);
+		VkDescriptorBufferInfo commandInfo = drawList.getCommandBufferInfo(i);
+		VkDescriptorBufferInfo visibleInfo = drawList.getVisibleBufferInfo(i);
+		VkDescriptorBufferInfo statsInfo = drawList.getStatsBufferInfo(i);
+		VkDescriptorBufferInfo occludedInfo = occludedBuffers[i]->descriptorInfo();
+		VkDescriptorBufferInfo cullDataInfo = cullDataBuffers[i]->descriptorInfo();
+		DescriptorWriter(*cullSetLayout, *descriptorPool)
+			.writeBuffer(0, &objectInfo)
+			.writeBuffer(1, &commandInfo)
+			.writeBuffer(2, &visibleInfo)
+			.writeBuffer(3, &statsInfo)
+			.writeBuffer(4, &occludedInfo)
+			.writeBuffer(5, &cullDataInfo)
+			.writeImage(6, &hizInfo)
+			.build(descriptorSets[i]);
+	}
+}
+
+void CullingSystem::createPipelineLayout()
+{
+	if (shaders.getPushConstantSize() != sizeof(CullPushConstants))
+		throw std::runtime_error("FrustumCull.comp push constants don't match CullPushConstants!");
+
+	pipelineLayout = device.getLayoutCache().getPipelineLayout(shaders, { cullSetLayout->getDescriptorSetLayout() });
+}
+
+void CullingSystem::createPipeline(PipelineBatch& batch)
+{
+	assert(pipelineLayout != VK_NULL_HANDLE && "Cannot create pipeline before pipeline layout!");
+
+	batch.addComputePipeline(pipeline, SHADER_PATH, pipelineLayout);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "../Device.h"
+#include "../Descriptors.h"
+#include "../FrameInfo.h"
+#include "../Buffer.h"
+#include "../HiZPyramid.h"
+#include "../ShaderReflection.h"
+
+#include <vector>
+#include <memory>
+
+/*
+ * Culls every object against the camera frustum and a Hi-Z depth pyramid in compute, and appends
+ * the visible ones to their indirect draw commands. The first phase runs before the render pass and
+ * tests objects against the pyramid built from last frame's depth. Objects it rejects are retested
+ * in the second phase, once this frame's first draw has been turned into a new pyramid, and the ones
+ * that turn out visible are drawn from the draw list's second phase commands. The first phase always
+ * runs, since it also fills the visible index buffer, but only rejects objects in CULLING_GPU mode.
+ */
+class CullingSystem
+{
+public:
+	CullingSystem(Device& device);
+	~CullingSystem();
+
+	CullingSystem(const CullingSystem&) = delete;
+	CullingSystem& operator=(const CullingSystem&) = delete;
+
+	void init(class IndirectDrawList& drawList, RenderPass& renderPass, class PipelineBatch& batch);
+	void cleanup();
+
+	// The Hi-Z pyramid follows the swap chain's depth attachments
+	void onSwapChainRecreated(RenderPass& renderPass);
+	bool isInitialized() const { return pipeline != nullptr; }
+
+	// First phase, recorded before the render pass
+	void cull(FrameInfo& frameInfo);
+
+	// Builds the Hi-Z pyramid from the depth drawn so far and retests the occluded objects, recorded outside the render pass
+	void cullSecondPhase(FrameInfo& frameInfo, uint32_t imageIndex);
+
+private:
+	void createBuffers(class IndirectDrawList& drawList);
+	void createDescriptorSets(class IndirectDrawList& drawList);
+	void createPipelineLayout();
+	void createPipeline(class PipelineBatch& batch);
+	void dispatch(FrameInfo& frameInfo, uint32_t phase);
+
+	Device& device;
+
+	HiZPyramid hiz{ device };
+
+	std::vector<std::unique_ptr<Buffer>> occludedBuffers; // One flag per object, set by the first phase for the second
+	std::vector<std::unique_ptr<Buffer>> cullDataBuffers;
+
+	ShaderReflection shaders;
+	DescriptorSetLayout* cullSetLayout = nullptr; // Owned by the device's layout cache
+	std::unique_ptr<DescriptorPool> descriptorPool;
+	std::vector<VkDescriptorSet> descriptorSets;
+
+	std::unique_ptr<class Pipeline> pipeline;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE; // Owned by the device's layout cache
+
+	glm::mat4 frameViewProj{ 1.0f };
+	glm::mat4 hizViewProj{ 1.0f }; // View projection of the frame the pyramid was built from
+	bool hizBuiltLastFrame = false;
+
+	static constexpr uint32_t WORKGROUP_SIZE = 64;
+};
@@ -12,6 +12,10 @@
 #include "../Utils.h"
 #include "../Material.h"
 #include "../SceneSerializer.h"
+#include "../IndirectDrawList.h"
+#include "../JobSystem.h"
+#include "../SwapChain.h"
+#include "../Scene/SimulationThread.h"
 
 #include <iostream>
 
@@ -49,7 +53,7 @@ void ImGuiSystem::drawImGui(FrameInfo& frameInfo)
 			if (ImGui::MenuItem("Serialize"))
 			{
 				SceneSerializer serializer;
-				serializer.serialize("MainApp/resources/scenes/untitled.scene", frameInfo.gameObjects);
+				serializer.serialize("MainApp/resources/scenes/untitled.scene", frameInfo.registry);
 			}
 
 			ImGui::EndMenu();
@@ -63,6 +67,12 @@ void ImGuiSystem::drawImGui(FrameInfo& frameInfo)
 	drawDeviceSpecs();
 	ImGui::NewLine();
 
+	drawMemoryStats();
+	ImGui::NewLine();
+
+	drawCullingStats(frameInfo);
+	ImGui::NewLine();
+
 	drawRenderModeText(frameInfo.renderMode);
 
 	ImGui::NewLine();
@@ -71,6 +81,14 @@ void ImGuiSystem::drawImGui(FrameInfo& frameInfo)
 
 	ImGui::NewLine();
 
+	drawSimulationText(frameInfo);
+
+	ImGui::NewLine();
+
+	drawFramePacingText(frameInfo);
+
+	ImGui::NewLine();
+
 	drawSceneInfo(frameInfo);
 
 	//drawGizmos(frameInfo);
@@ -118,6 +136,68 @@ void ImGuiSystem::drawDeviceSpecs()
 	ImGui::Text("CPU: %s", cpuInfo.c_str());
 }
 
+void ImGuiSystem::drawMemoryStats()
+{
+	if (ImGui::CollapsingHeader("Device Memory"))
+	{
+		std::vector<MemoryHeapStats> heapStats = device.getAllocator().getHeapStats();
+		for (uint32_t i = 0; i < (uint32_t)heapStats.size(); i++)
+		{
+			const MemoryHeapStats& stats = heapStats[i];
+			const float toMB = 1.0f / (1024.0f * 1024.0f);
+
+			ImGui::Text("Heap %u (%s)", i, stats.deviceLocal ? "Device Local" : "Host");
+			ImGui::Text("  Used: %.2f / %.2f MB reserved (%.0f MB heap)", stats.usedBytes * toMB, stats.reservedBytes * toMB, stats.heapSize * toMB);
+			ImGui::Text("  Allocations: %u in %u blocks, %u dedicated", stats.allocationCount, stats.blockCount, stats.dedicatedAllocationCount);
+		}
+	}
+}
+
+void ImGuiSystem::drawCullingStats(FrameInfo& frameInfo)
+{
+	if (!frameInfo.drawList)
+		return;
+
+	IndirectDrawList& drawList = *frameInfo.drawList;
+
+	ImGui::Text("Culling:");
+	ImGui::SameLine();
+	switch (frameInfo.cullingMode)
+	{
+	case CULLING_GPU:
+		ImGui::TextColored(ImVec4(0.2f, 0.8f, 0.1f, 1.0f), frameInfo.occlusionCulling ? "GPU + Hi-Z occlusion" : "GPU");
+		break;
+	case CULLING_CPU:
+		ImGui::TextColored(ImVec4(0.8f, 0.8f, 0.0f, 1.0f), "CPU (SSE)");
+		break;
+	case CULLING_NONE:
+		ImGui::TextColored(ImVec4(0.8f, 0.1f, 0.1f, 1.0f), "Off");
+		break;
+	}
+
+	ImGui::Text("Visible Objects: %u", drawList.getVisibleCount());
+	ImGui::SameLine();
+	ImGui::TextColored(ImVec4(0.8f, 0.4f, 0.1f, 1.0f), "(%u culled)", drawList.getCulledCount());
+	if (frameInfo.occlusionCulling)
+	{
+		ImGui::Text("Occluded Objects: %u", drawList.getOccludedCount());
+		ImGui::SameLine();
+		ImGui::TextColored(ImVec4(0.2f, 0.6f, 0.8f, 1.0f), "(%u disoccluded)", drawList.getDisoccludedCount());
+	}
+	ImGui::Text("Draw Commands: %u in %u draw calls", drawList.getCommandCount(), drawList.getDrawCallCount());
+	ImGui::Text("Recording: %.3f ms on %u thread%s", frameInfo.recordTime, frameInfo.recordingThreadCount, frameInfo.recordingThreadCount == 1 ? "" : "s");
+
+	if (ImGui::Button("Run CPU Culling Benchmark"))
+	{
+		FrustumCuller::benchmark();
+	}
+
+	if (frameInfo.jobSystem && ImGui::Button("Run Job System Benchmark"))
+	{
+		JobSystem::benchmark(*frameInfo.jobSystem);
+	}
+}
+
 void ImGuiSystem::drawSceneInfo(FrameInfo& frameInfo)
 {
 	if (ImGui::CollapsingHeader("Scene", ImGuiTreeNodeFlags_DefaultOpen))
@@ -130,57 +210,110 @@ void ImGuiSystem::drawSceneInfo(FrameInfo& frameInfo)
 			ImGui::TreePop();
 		}
 
-		for (auto& keyValue : frameInfo.gameObjects)
+		Registry& registry = frameInfo.registry;
+		for (Entity entity : registry.getEntities())
 		{
-			GameObject& obj = keyValue.second;
-			ImGuiTreeNodeFlags flags = (selectionContext == obj.getID() ? ImGuiTreeNodeFlags_Selected : 0) | ImGuiTreeNodeFlags_OpenOnArrow;
-
-			bool opened = ImGui::TreeNodeEx((void*)(uint64_t)(uint32_t)obj.getID(), flags, obj.getObjectName().c_str());
+			if (registry.getParent(entity) == NULL_ENTITY)
+				drawEntityNode(registry, entity);
+		}
+	}
+}
 
-			if(ImGui::IsItemClicked())
-			{
-				selectionContext = obj.getID();
-			}
+void ImGuiSystem::drawEntityNode(Registry& registry, Entity entity)
+{
+	ImGuiTreeNodeFlags flags = (selectionContext == entity ? ImGuiTreeNodeFlags_Selected : 0) | ImGuiTreeNodeFlags_OpenOnArrow;
 
-			if (opened)
-			{
-				DrawVec3Control("Position", obj.transform.translation, 0.0f, 120.0f);
-				DrawVec3Control("Rotation", obj.transform.rotation, 0.0f, 120.0f, true);
-				DrawVec3Control("Scale", obj.transform.scale, 1.0f, 120.0f);
-				ImGui::NewLine();
+	bool opened = ImGui::TreeNodeEx((void*)(uint64_t)entity, flags, registry.get<TagComponent>(entity).name.c_str());
 
-				drawMaterialEditor(obj);
+	if(ImGui::IsItemClicked())
+	{
+		selectionContext = entity;
+	}
 
-				if (obj.pointLight)
-				{
-					DrawFloatControl("Intensity", obj.pointLight->intensity, 1.0f, 120.0f, 0.0f, 20.0f, true);
-					DrawColor3Control("Color", obj.pointLight->color, 0.0f, 120.0f);
-				}
+	if (opened)
+	{
+		TransformComponent& transform = registry.get<TransformComponent>(entity);
+		glm::vec3 translation = transform.translation;
+		glm::vec3 rotation = transform.rotation;
+		glm::vec3 scale = transform.scale;
+		DrawVec3Control("Position", transform.translation, 0.0f, 120.0f);
+		DrawVec3Control("Rotation", transform.rotation, 0.0f, 120.0f, true);
+		DrawVec3Control("Scale", transform.scale, 1.0f, 120.0f);
+		if (transform.translation != translation || transform.rotation != rotation || transform.scale != scale)
+			transform.markDirty();
+		ImGui::NewLine();
+
+		drawParentSelector(registry, entity);
+		drawMaterialEditor(registry, entity);
+
+		PointLightComponent* pointLight = registry.tryGet<PointLightComponent>(entity);
+		SpotLightComponent* spotLight = registry.tryGet<SpotLightComponent>(entity);
+		DirectionalLightComponent* directionalLight = registry.tryGet<DirectionalLightComponent>(entity);
+
+		if (pointLight)
+		{
+			DrawFloatControl("Intensity", pointLight->intensity, 1.0f, 120.0f, 0.0f, 20.0f, true);
+			DrawColor3Control("Color", pointLight->color, 0.0f, 120.0f);
+		}
 
-				if(obj.spotLight)
-				{
-					DrawFloatControl("Intensity", obj.spotLight->intensity, 1.0f, 120.0f, 0.0f, 20.0f, true);
-					DrawFloatControl("Cutoff Angle", obj.spotLight->outerCutoffAngle, 0.0f, 120.0f, 0.0f, obj.spotLight->cutoffAngle, true);
-					DrawFloatControl("Outer Cutoff Angle", obj.spotLight->cutoffAngle, 0.0f, 120.0f, 0.0f, 90.0f, true);
-					DrawColor3Control("Color", obj.spotLight->color, 0.0f, 120.0f);
-					ImGui::NewLine();
-				}
+		if(spotLight)
+		{
+			DrawFloatControl("Intensity", spotLight->intensity, 1.0f, 120.0f, 0.0f, 20.0f, true);
+			DrawFloatControl("Cutoff Angle", spotLight->outerCutoffAngle, 0.0f, 120.0f, 0.0f, spotLight->cutoffAngle, true);
+			DrawFloatControl("Outer Cutoff Angle", spotLight->cutoffAngle, 0.0f, 120.0f, 0.0f, 90.0f, true);
+			DrawColor3Control("Color", spotLight->color, 0.0f, 120.0f);
+			ImGui::NewLine();
+		}
 
-				if(obj.directionalLight)
-				{
-					glm::vec3 direction = obj.directionalLight->direction;
-					DrawVec3ControlClamped("Direction", direction, 0.0f, 120.0f, -1.0f, 1.0f);
-					obj.directionalLight->direction = direction;
-					DrawVec3Control("Color", obj.directionalLight->color, 0.0f, 120.0f);
-					DrawFloatControl("Intensity", obj.directionalLight->intensity, 1.0f, 120.0f, 0.0f, 20.0f, true);
-				}
+		if(directionalLight)
+		{
+			glm::vec3 direction = directionalLight->direction;
+			DrawVec3ControlClamped("Direction", direction, 0.0f, 120.0f, -1.0f, 1.0f);
+			directionalLight->direction = direction;
+			DrawVec3Control("Color", directionalLight->color, 0.0f, 120.0f);
+			DrawFloatControl("Intensity", directionalLight->intensity, 1.0f, 120.0f, 0.0f, 20.0f, true);
+		}
 
-				ImGui::TreePop();
-			}
+		// Collected up front, since a child's parent selector may reorder the parent pool
+		std::vector<Entity> children;
+		registry.each<ParentComponent>([entity, &children](Entity child, ParentComponent& parent)
+		{
+			if (parent.parent == entity)
+				children.push_back(child);
+		});
+		for (Entity child : children)
+		{
+			drawEntityNode(registry, child);
 		}
+
+		ImGui::TreePop();
 	}
 }
 
+void ImGuiSystem::drawParentSelector(Registry& registry, Entity entity)
+{
+	Entity parent = registry.getParent(entity);
+	const char* preview = parent != NULL_ENTITY ? registry.get<TagComponent>(parent).name.c_str() : "None";
+	if (!ImGui::BeginCombo("Parent", preview))
+		return;
+
+	if (ImGui::Selectable("None", parent == NULL_ENTITY))
+		registry.setParent(entity, NULL_ENTITY);
+
+	for (Entity candidate : registry.getEntities())
+	{
+		if (candidate == entity)
+			continue;
+
+		ImGui::PushID((int)candidate);
+		// Descendants are rejected by the registry, the selection is simply ignored
+		if (ImGui::Selectable(registry.get<TagComponent>(candidate).name.c_str(), candidate == parent))
+			registry.setParent(entity, candidate);
+		ImGui::PopID();
+	}
+	ImGui::EndCombo();
+}
+
 void ImGuiSystem::drawShowGridText(FrameInfo& frameInfo)
 {
 	ImGui::Text("Grid Enabled:");
@@ -191,36 +324,71 @@ void ImGuiSystem::drawShowGridText(FrameInfo& frameInfo)
 		ImGui::TextColored(ImVec4(0.8f, 0.1f, 0.1f, 1.0f), "False");
 }
 
+void ImGuiSystem::drawSimulationText(FrameInfo& frameInfo)
+{
+	ImGui::Text("Simulation:");
+	ImGui::SameLine();
+	if (frameInfo.threadedSimulation)
+		ImGui::TextColored(ImVec4(0.2f, 0.8f, 0.1f, 1.0f), "Threaded, %.0f Hz (tick %llu)", 1.0f / SimulationThread::TIMESTEP,
+			static_cast<unsigned long long>(frameInfo.simulationTick));
+	else
+		ImGui::TextColored(ImVec4(0.8f, 0.8f, 0.0f, 1.0f), "Per Frame");
+}
+
+void ImGuiSystem::drawFramePacingText(FrameInfo& frameInfo)
+{
+	ImGui::Text("Frames In Flight: %u (%s)", frameInfo.framesInFlight, frameInfo.timelinePacing ? "timeline semaphore" : "fences");
+	ImGui::SameLine();
+	if (frameInfo.lowLatency)
+		ImGui::TextColored(ImVec4(0.2f, 0.8f, 0.1f, 1.0f), "Low Latency");
+	else
+		ImGui::TextColored(ImVec4(0.8f, 0.8f, 0.0f, 1.0f), "Throughput");
+	ImGui::Text("Input Latency: %.2f ms", frameInfo.inputLatency);
+
+	ImGui::Text("Present Mode: %s", SwapChain::getPresentModeName(frameInfo.presentMode));
+	if (frameInfo.uncappedBenchmark)
+	{
+		ImGui::TextColored(ImVec4(0.8f, 0.4f, 0.1f, 1.0f), "Uncapped Benchmark: %u frames, %.3f ms avg (%.1f FPS)", frameInfo.benchmarkFrameCount,
+			frameInfo.benchmarkFrameTime, frameInfo.benchmarkFrameTime > 0.0f ? 1000.0f / frameInfo.benchmarkFrameTime : 0.0f);
+	}
+}
+
 void ImGuiSystem::drawGizmos(FrameInfo& frameInfo)
 {
 	//TODO: Switch to using Imgui viewport so gizmos work properly
 
-	if(frameInfo.gameObjects.empty())
+	if(!frameInfo.registry.valid(selectionContext))
 		return;
 
-	GameObject& selectedObject = getSelectedObject(frameInfo);
-	if(selectedObject.getID() != -1)
-	{
-		ImGuizmo::SetOrthographic(false);
-		ImGuizmo::SetDrawlist();
-		float windowWidth = (float)ImGui::GetWindowWidth();
-		float windowHeight = (float)ImGui::GetWindowHeight();
-		float x = ImGui::GetWindowPos().x;
-		float y = ImGui::GetWindowPos().y;
-		ImGuizmo::SetRect(x, y, windowWidth, windowHeight);
+	ImGuizmo::SetOrthographic(false);
+	ImGuizmo::SetDrawlist();
+	float windowWidth = (float)ImGui::GetWindowWidth();
+	float windowHeight = (float)ImGui::GetWindowHeight();
+	float x = ImGui::GetWindowPos().x;
+	float y = ImGui::GetWindowPos().y;
+	ImGuizmo::SetRect(x, y, windowWidth, windowHeight);
 
-		glm::mat4 cameraView = glm::inverse(frameInfo.camera.getTransform());
-		glm::mat4 cameraProjection = frameInfo.camera.proj;
+	glm::mat4 cameraView = glm::inverse(frameInfo.camera.getTransform());
+	glm::mat4 cameraProjection = frameInfo.camera.proj;
 
-		glm::mat4 transform = selectedObject.transform.getTransform();
+	TransformComponent& selectedTransform = frameInfo.registry.get<TransformComponent>(selectionContext);
+	glm::mat4 transform = selectedTransform.getTransform();
 
-		ImGuizmo::Manipulate(glm::value_ptr(cameraView), glm::value_ptr(cameraProjection), ImGuizmo::OPERATION::TRANSLATE, IMGUIZMO_NAMESPACE::LOCAL, glm::value_ptr(transform));
+	if (ImGuizmo::Manipulate(glm::value_ptr(cameraView), glm::value_ptr(cameraProjection), ImGuizmo::OPERATION::TRANSLATE, IMGUIZMO_NAMESPACE::LOCAL, glm::value_ptr(transform)))
+	{
+		// The gizmo works in world space, the edit is stored relative to the parent
+		Entity parent = frameInfo.registry.getParent(selectionContext);
+		if (parent != NULL_ENTITY)
+			transform = glm::inverse(frameInfo.registry.get<TransformComponent>(parent).getTransform()) * transform;
+
+		selectedTransform.setLocalMatrixTranslation(glm::vec3(transform[3]));
 	}
 }
 
-void ImGuiSystem::drawMaterialEditor(GameObject& obj)
+void ImGuiSystem::drawMaterialEditor(Registry& registry, Entity entity)
 {
-	if (obj.model)
+	MaterialComponent* materialComp = registry.tryGet<MaterialComponent>(entity);
+	if (registry.has<MeshComponent>(entity))
 	{
 		if (ImGui::Button("Edit Material"))
 		{
@@ -241,8 +409,8 @@ void ImGuiSystem::drawMaterialEditor(GameObject& obj)
 					if(ImGui::MenuItem("Serialize"))
 					{
 						MaterialSerializer serializer;
-						const std::string path = MaterialBuilder::getMaterialFilePath() + obj.materialComp->materialFileName;
-						serializer.serialize(path, obj.materialComp->material);
+						const std::string path = MaterialBuilder::getMaterialFilePath() + materialComp->materialFileName;
+						serializer.serialize(path, materialComp->material);
 					}
 					ImGui::EndMenu();
 				}
@@ -250,27 +418,36 @@ void ImGuiSystem::drawMaterialEditor(GameObject& obj)
 			}
 			ImGui::GetStyle().Colors[ImGuiCol_ModalWindowDimBg] = ImVec4(0.0f, 0.0f, 0.0f, 0.0f);
 
-			if(obj.materialComp)
+			if(materialComp)
 			{
-				ShaderParameters shaderParams = obj.materialComp->material->getShaderParameters();
+				Material& material = *materialComp->material;
+				ShaderParameters& shaderParams = material.getShaderParameters();
 
 				if(shaderParams.toggleTexture == 0)
 				{
 					glm::vec3 albedo = (glm::vec3)shaderParams.albedo;
 					DrawColor3Control("Albedo", albedo, 0.0f, 120.0f);
-					shaderParams.albedo = glm::vec4(albedo, 1.0f);
 
 					float roughness = shaderParams.roughness;
 					DrawFloatControl("Roughness", roughness, 1.0f, 120.0f, 0.1f, 1.0f, true);
-					shaderParams.roughness = roughness;
 
 					float ambientOcclusion = shaderParams.ambientOcclusion;
 					DrawFloatControl("Ambient Occlusion", ambientOcclusion, 1.0f, 120.0f, 0.0f, 1.0f, true);
-					shaderParams.ambientOcclusion = ambientOcclusion;
 
 					float metallic = shaderParams.metallic;
 					DrawFloatControl("Metallic", metallic, 1.0f, 120.0f, 0.0f, 1.0f, true);
-					shaderParams.metallic = metallic;
+
+					// Only edits bump the version, so an open editor does not re-upload the material every frame
+					glm::vec4 newAlbedo = glm::vec4(albedo, 1.0f);
+					if (newAlbedo != shaderParams.albedo || roughness != shaderParams.roughness || ambientOcclusion != shaderParams.ambientOcclusion ||
+						metallic != shaderParams.metallic)
+					{
+						shaderParams.albedo = newAlbedo;
+						shaderParams.roughness = roughness;
+						shaderParams.ambientOcclusion = ambientOcclusion;
+						shaderParams.metallic = metallic;
+						material.markDirty();
+					}
 				}
 				else
 				{
@@ -279,14 +456,12 @@ void ImGuiSystem::drawMaterialEditor(GameObject& obj)
 					int imageCount = 6;
 					float windowVisibleX2 = ImGui::GetWindowPos().x + ImGui::GetWindowContentRegionMax().x;
 					
-					uint32_t start = shaderParams.textureIndex * imageCount;
 					uint32_t n = 0;
-					ShaderParameters& params = obj.materialComp->material->getShaderParameters();
 
-					for(std::pair<uint32_t, Texture> texture : params.materialTextures)
+					for(std::pair<const uint32_t, Texture>& texture : shaderParams.materialTextures)
 					{
 						ImGui::PushID(n);
-						Texture tex = texture.second;
+						Texture& tex = texture.second;
 						ImGui::Image(tex.getDescriptorSet(), imageSize);
 						float lastImageX2 = ImGui::GetItemRectMax().x;
 						float nextImageX2 = lastImageX2 + style.ItemSpacing.x + imageSize.x; // Expected position if next button was on same line
@@ -296,8 +471,6 @@ void ImGuiSystem::drawMaterialEditor(GameObject& obj)
 						n++;
 					}
 				}
-
-				obj.materialComp->material->setShaderParameters(shaderParams);
 			}
 			
 
@@ -308,11 +481,6 @@ void ImGuiSystem::drawMaterialEditor(GameObject& obj)
 	}
 }
 
-GameObject& ImGuiSystem::getSelectedObject(FrameInfo& frameInfo)
-{
-	return frameInfo.gameObjects.at(selectionContext);
-}
-
 void ImGuiSystem::setViewportInfo(float x, float y, float width, float height)
 {
 	viewportInfo = {x, y, width, height};
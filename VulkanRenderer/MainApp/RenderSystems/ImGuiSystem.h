@@ -3,7 +3,7 @@
 #include "../Device.h"
 #include "../FrameInfo.h"
 #include "../Enums.h"
-#include "../GameObject.h"
+#include "../Scene/Registry.h"
 
 #include <vector>
 #include <memory>
@@ -33,13 +33,17 @@ public:
 	void drawRenderModeText(RenderMode mode);
 	void drawFrameInfo(float framerate, float frameTime);
 	void drawDeviceSpecs();
+	void drawMemoryStats();
+	void drawCullingStats(FrameInfo& frameInfo);
 	void drawSceneInfo(FrameInfo& frameInfo);
 	void drawShowGridText(FrameInfo& frameInfo);
+	void drawSimulationText(FrameInfo& frameInfo);
+	void drawFramePacingText(FrameInfo& frameInfo);
 	void drawGizmos(FrameInfo& frameInfo);
 
-	void drawMaterialEditor(GameObject& obj);
-
-	GameObject& getSelectedObject(FrameInfo& frameInfo);
+	void drawEntityNode(Registry& registry, Entity entity);
+	void drawParentSelector(Registry& registry, Entity entity);
+	void drawMaterialEditor(Registry& registry, Entity entity);
 
 	void setViewportInfo(float x, float y, float width, float height);
 
@@ -52,7 +56,7 @@ public:
 private:
 	Device& device;
 
-	uint32_t selectionContext = 0;
+	Entity selectionContext = 0;
 
 	std::string cpuInfo;
 
@@ -1,32 +1,38 @@
 #pragma once
 
 #include "../Device.h"
-#include "../GameObject.h"
+#include "../Scene/Registry.h"
 #include "../FrameInfo.h"
+#include "../ShaderReflection.h"
 
 #include <vector>
 #include <memory>
 
+class PipelineBatch;
+
 class PointLightSystem
 {
 public:
 	PointLightSystem(Device& device);
-	~PointLightSystem();
 
 	PointLightSystem(const PointLightSystem&) = delete;
 	PointLightSystem& operator=(const PointLightSystem&) = delete;
 
-	void init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+	void init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, PipelineBatch& batch);
 
-	void update(FrameInfo& frameInfo, LightUbo& ubo);
+	// Orbits the point lights, before transforms are updated
+	static void simulate(Registry& registry, float deltaTime);
+	// Copies the point lights into the ubo, once transforms are up to date
+	static void update(Registry& registry, LightUbo& ubo);
 	void render(FrameInfo& frameInfo, LightUbo& ubo);
 
 private:
 	void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-	void createPipeline(VkRenderPass renderPass);
+	void createPipeline(VkRenderPass renderPass, PipelineBatch& batch);
 
 	Device& device;
 
 	std::unique_ptr<class Pipeline> pipeline;
-	VkPipelineLayout pipelineLayout;
+	VkPipelineLayout pipelineLayout; // Owned by the device's layout cache
+	ShaderReflection shaders;
 };
\ No newline at end of file
@@ -1,5 +1,24 @@
 #include "RenderSystem.h"
 #include "../Pipeline.h"
+#include "../PipelineBatch.h"
+#include "../IndirectDrawList.h"
+#include "../LayoutCache.h"
+#include "../Material.h"
+#include "../Log.h"
+
+#include <algorithm>
+#include <chrono>
+
+// constant_id of the specialization constants in PBR.frag
+enum PBRConstant
+{
+	PBR_CONSTANT_TEXTURED,
+	PBR_CONSTANT_NORMAL_MAP,
+	PBR_CONSTANT_PARALLAX,
+	PBR_CONSTANT_METALLIC_MAP,
+	PBR_CONSTANT_MAX_POINT_LIGHTS,
+	PBR_CONSTANT_MAX_SPOT_LIGHTS
+};
 
 RenderSystem::RenderSystem(Device& device)
 	: RenderSystemBase(device)
@@ -11,7 +30,7 @@ RenderSystem::~RenderSystem()
 	RenderSystemBase::~RenderSystemBase();
 }
 
-void RenderSystem::init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout additionalLayout)
+void RenderSystem::init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, PipelineBatch& batch, VkDescriptorSetLayout additionalLayout)
 {
 	textureDescriptorSets.resize(maxDescriptorSets);
 	//vertFilePath = "MainApp/resources/vulkan/shaders/TestVert.spv";
@@ -19,102 +38,159 @@ void RenderSystem::init(VkRenderPass renderPass, VkDescriptorSetLayout globalSet
 	vertFilePath = "MainApp/resources/vulkan/shaders/PBRVert.spv";
 	fragFilePath = "MainApp/resources/vulkan/shaders/PBRFrag.spv";
 
-	RenderSystemBase::init(renderPass, globalSetLayout, additionalLayout);
+	RenderSystemBase::init(renderPass, globalSetLayout, batch, additionalLayout);
 }
 
-void RenderSystem::update(FrameInfo& frameInfo, Buffer* buffer)
+void RenderSystem::render(FrameInfo& frameInfo)
 {
-	uint32_t i = 0;
-	// TODO: Probably shouldn't iterate through every game object a second time but can't think of a better solution atm
-	for (auto& keyValue : frameInfo.gameObjects)
+	VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+	IndirectDrawList& drawList = *frameInfo.drawList;
+
+	// Every permutation shares the layout, so the sets stay bound across pipeline changes
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 0, nullptr);
+
+	if (frameInfo.materialDescriptorSet)
 	{
-		GameObject& obj = keyValue.second;
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &frameInfo.materialDescriptorSet, 0, nullptr);
+	}
 
-		if (!obj.model)
-			continue;
+	if (permutations.empty())
+	{
+		pipeline->bind(commandBuffer);
+		drawList.draw(commandBuffer, frameInfo.frameIndex, frameInfo.drawPhase, frameInfo.firstDrawCommand, frameInfo.drawCommandCount);
+		return;
+	}
 
-		ShaderParameters shaderParams = obj.materialComp->material->getShaderParameters();
+	// Groups with the same permutation are next to each other, so each is bound once per range
+	Pipeline* boundPipeline = nullptr;
+	for (const DrawGroup& group : drawList.getDrawGroups())
+	{
+		DrawRange range = drawList.getGroupRange(group, frameInfo.drawPhase, frameInfo.firstDrawCommand, frameInfo.drawCommandCount);
+		if (range.isEmpty())
+			continue;
 
-		MaterialUbo ubo{};
-		ubo.albedo = shaderParams.albedo;
-		ubo.ambientOcclusion = shaderParams.ambientOcclusion;
-		ubo.roughness = shaderParams.roughness;
-		ubo.metalic = shaderParams.metallic;
+		Pipeline* groupPipeline = &getPermutation(group.materialFeatures);
+		if (groupPipeline != boundPipeline)
+		{
+			groupPipeline->bind(commandBuffer);
+			boundPipeline = groupPipeline;
+		}
 
-		VkDeviceSize dynamicOffset = static_cast<VkDeviceSize>(i) * frameInfo.dynamicOffset;
-		buffer->writeToBuffer(&ubo, buffer->getAlignmentSize(), dynamicOffset);
-		buffer->flush(buffer->getBufferSize());
-		i++;
+		drawList.draw(commandBuffer, frameInfo.frameIndex, frameInfo.drawPhase, range);
 	}
 }
 
-void RenderSystem::render(FrameInfo& frameInfo)
+void RenderSystem::cleanup()
 {
-	pipeline->bind(frameInfo.commandBuffer);
+	permutations.clear();
+	baseConfig = nullptr;
 
-	vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 0, nullptr);
-	
-	uint32_t i = 0;
-	for (auto& keyValue : frameInfo.gameObjects)
-	{
-		GameObject& obj = keyValue.second;
+	RenderSystemBase::cleanup();
+}
 
-		if (!obj.model)
+uint32_t RenderSystem::addPermutations(const std::vector<uint32_t>& materialFeatures, uint32_t lightCountClass, PipelineBatch& batch)
+{
+	assert(baseConfig != nullptr && "Cannot add permutations before the pipeline!");
+	assert(lightCountClass < LIGHT_COUNT_CLASS_COUNT);
+
+	static const uint32_t maxLights[LIGHT_COUNT_CLASS_COUNT] = { 0, FEW_LIGHTS, MAX_LIGHTS };
+
+	uint32_t added = 0;
+	for (uint32_t features : materialFeatures)
+	{
+		auto [it, inserted] = permutations.try_emplace(getPermutationKey(features, lightCountClass));
+		if (!inserted)
 			continue;
 
-		ShaderParameters shaderParams = obj.materialComp->material->getShaderParameters();
+		PipelineConfigInfo& pipelineConfig = addPipeline(it->second, baseConfig->renderPass, batch);
+		Pipeline::setSpecializationConstant(pipelineConfig, PBR_CONSTANT_TEXTURED, (features & MATERIAL_FEATURE_TEXTURED) != 0);
+		Pipeline::setSpecializationConstant(pipelineConfig, PBR_CONSTANT_NORMAL_MAP, (features & MATERIAL_FEATURE_NORMAL_MAP) != 0);
+		Pipeline::setSpecializationConstant(pipelineConfig, PBR_CONSTANT_PARALLAX, (features & MATERIAL_FEATURE_PARALLAX) != 0);
+		Pipeline::setSpecializationConstant(pipelineConfig, PBR_CONSTANT_METALLIC_MAP, (features & MATERIAL_FEATURE_METALLIC_MAP) != 0);
+		Pipeline::setSpecializationConstant(pipelineConfig, PBR_CONSTANT_MAX_POINT_LIGHTS, maxLights[lightCountClass]);
+		Pipeline::setSpecializationConstant(pipelineConfig, PBR_CONSTANT_MAX_SPOT_LIGHTS, maxLights[lightCountClass]);
+		added++;
+	}
 
-		SimplePushConstantData push{};
-		push.modelMatrix = obj.transform.getTransform();
-		push.normalMatrix = obj.transform.getNormalMatrix();
-		push.textureIndex = shaderParams.textureIndex;
-		push.toggleTexture = shaderParams.toggleTexture;
+	return added;
+}
 
-		vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
+void RenderSystem::updatePermutations(const IndirectDrawList& drawList, const LightUbo& lightUbo, PipelineBatch& batch, JobSystem& jobSystem)
+{
+	lightCountClass = getLightCountClass(lightUbo);
 
-		if (frameInfo.materialDescriptorSet)
-		{
-			uint32_t dynamicOffset = static_cast<uint32_t>(i * frameInfo.dynamicOffset);
-			vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &frameInfo.materialDescriptorSet, 1, &dynamicOffset);
-		}
+	missingFeatures.clear();
+	for (const DrawGroup& group : drawList.getDrawGroups())
+	{
+		if (permutations.find(getPermutationKey(group.materialFeatures, lightCountClass)) == permutations.end())
+			missingFeatures.push_back(group.materialFeatures);
+	}
+
+	if (missingFeatures.empty())
+		return;
 
-		obj.model->bind(frameInfo.commandBuffer);
-		obj.model->draw(frameInfo.commandBuffer);
+	auto start = std::chrono::high_resolution_clock::now();
+	uint32_t added = addPermutations(missingFeatures, lightCountClass, batch);
 
-		i++;
+	try
+	{
+		batch.build(jobSystem);
+	}
+	catch (const std::exception& e)
+	{
+		// The batch still built the others and won't retry the failed ones, their groups keep drawing with the full pipeline
+		CORE_ERROR("Failed to build PBR permutations: {0}", e.what())
+		return;
 	}
+
+	float buildTime = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+	CORE_INFO("Built {0} PBR permutations in {1:.2f} ms", added, buildTime)
+}
+
+uint32_t RenderSystem::getLightCountClass(const LightUbo& lightUbo)
+{
+	uint32_t lightCount = std::max(lightUbo.numLights, lightUbo.numSpotLights);
+	if (lightCount == 0)
+		return LIGHT_COUNT_NONE;
+
+	return lightCount <= FEW_LIGHTS ? LIGHT_COUNT_FEW : LIGHT_COUNT_MANY;
+}
+
+Pipeline& RenderSystem::getPermutation(uint32_t materialFeatures) const
+{
+	auto it = permutations.find(getPermutationKey(materialFeatures, lightCountClass));
+	return it != permutations.end() && it->second ? *it->second : *pipeline;
 }
 
 void RenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout additionalLayout /*= VK_NULL_HANDLE*/)
 {
-	VkPushConstantRange pushConstantRange{};
-	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-	pushConstantRange.offset = 0;
-	pushConstantRange.size = sizeof(SimplePushConstantData);
-	
+	std::vector<std::string> shaderFilePaths{ vertFilePath };
+	if (!fragFilePath.empty())
+		shaderFilePaths.push_back(fragFilePath);
+	shaders = ShaderReflection(shaderFilePaths);
+
+	// The shaders decide how many of the sets and which push constants the layout has, systems using the
+	// same ones share one layout
 	std::vector<VkDescriptorSetLayout> descriptorSetLayouts {globalSetLayout};
 	if(additionalLayout != VK_NULL_HANDLE)
 		descriptorSetLayouts.push_back(additionalLayout);
-	
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-	pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-	pipelineLayoutInfo.pushConstantRangeCount = 1;
-	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-	
-	VkResult res = vkCreatePipelineLayout(device.getDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout);
-	if (res != VK_SUCCESS)
-		throw std::runtime_error("Failed to create pipeline layout!");
+
+	pipelineLayout = device.getLayoutCache().getPipelineLayout(shaders, descriptorSetLayouts);
 }
 
-void RenderSystem::createPipeline(VkRenderPass renderPass)
+void RenderSystem::createPipeline(VkRenderPass renderPass, PipelineBatch& batch)
 {
 	assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!");
 
-	PipelineConfigInfo pipelineConfig{};
+	baseConfig = &addPipeline(pipeline, renderPass, batch);
+}
+
+PipelineConfigInfo& RenderSystem::addPipeline(std::unique_ptr<Pipeline>& target, VkRenderPass renderPass, PipelineBatch& batch)
+{
+	PipelineConfigInfo& pipelineConfig = batch.addGraphicsPipeline(target, vertFilePath, fragFilePath);
 	Pipeline::defaultPipelineConfigInfo(pipelineConfig);
+	shaders.applyVertexInput(pipelineConfig);
 	pipelineConfig.renderPass = renderPass;
 	pipelineConfig.pipelineLayout = pipelineLayout;
-	pipeline = std::make_unique<Pipeline>(device, vertFilePath, fragFilePath, pipelineConfig);
+	return pipelineConfig;
 }
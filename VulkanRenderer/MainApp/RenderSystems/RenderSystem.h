@@ -3,37 +3,68 @@
 #include "RenderSystemBase.h"
 
 #include "../Device.h"
-#include "../GameObject.h"
+#include "../Scene/Registry.h"
 #include "../FrameInfo.h"
 
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
-struct SimplePushConstantData
+// Bounds of the light loops in a PBR permutation, so scenes with few lights don't pay for the full ones
+enum LightCountClass
 {
-	glm::mat4 modelMatrix{ 1.0f };
-	glm::mat4 normalMatrix{ 1.0f };
-	uint32_t textureIndex = 0;
-	uint32_t toggleTexture = 0;
+	LIGHT_COUNT_NONE,
+	LIGHT_COUNT_FEW,
+	LIGHT_COUNT_MANY,
+	LIGHT_COUNT_CLASS_COUNT
 };
 
+/*
+ * Draws the meshes with PBR.frag. Besides the full pipeline, which can draw any material, it keeps
+ * permutations of the shader specialized for a set of material features and a light count class,
+ * so simple materials skip the texture, normal and parallax paths entirely. The draw list groups
+ * objects by features and each group is drawn with its permutation, or the full pipeline until the
+ * permutation exists.
+ */
 class RenderSystem : public RenderSystemBase
 {
 public:
 	RenderSystem(Device& device);
 	~RenderSystem();
 
-	virtual void init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout additionalLayout = VK_NULL_HANDLE) override;
-	virtual void update(FrameInfo& frameInfo, Buffer* buffer) override;
+	virtual void init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, PipelineBatch& batch, VkDescriptorSetLayout additionalLayout = VK_NULL_HANDLE) override;
 	virtual void render(FrameInfo& frameInfo) override;
+	virtual void cleanup() override;
+
+	// Adds the permutations for these MaterialFeatureFlags at a light count class to the batch, skipping ones that exist.
+	// Returns how many were added.
+	uint32_t addPermutations(const std::vector<uint32_t>& materialFeatures, uint32_t lightCountClass, PipelineBatch& batch);
+	// Builds the permutations the draw list's groups need that don't exist yet, and draws with the lights' count class
+	// from now on. Call on the main thread before recording.
+	void updatePermutations(const class IndirectDrawList& drawList, const LightUbo& lightUbo, PipelineBatch& batch, class JobSystem& jobSystem);
+
+	uint32_t getPermutationCount() const { return static_cast<uint32_t>(permutations.size()); }
+
+	static uint32_t getLightCountClass(const LightUbo& lightUbo);
+
+	static constexpr uint32_t FEW_LIGHTS = 4;
 
 protected:
 	virtual void createPipelineLayout(VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout additionalLayout = VK_NULL_HANDLE) override;
-	virtual void createPipeline(VkRenderPass renderPass) override;
+	virtual void createPipeline(VkRenderPass renderPass, PipelineBatch& batch) override;
 
-public:
-	std::vector<VkDescriptorSet> textureDescriptorSets;
+	PipelineConfigInfo& addPipeline(std::unique_ptr<class Pipeline>& target, VkRenderPass renderPass, PipelineBatch& batch);
 
 private:
-	uint32_t dynamicOffset;
+	// The full pipeline stands in for permutations that don't exist or failed to build
+	class Pipeline& getPermutation(uint32_t materialFeatures) const;
+	static uint32_t getPermutationKey(uint32_t materialFeatures, uint32_t lightCountClass) { return lightCountClass << 4 | materialFeatures; }
+
+	std::unordered_map<uint32_t, std::unique_ptr<class Pipeline>> permutations; // Batch targets, so entries are never erased
+	const PipelineConfigInfo* baseConfig = nullptr; // The full pipeline's, the batch keeps its render pass current
+	uint32_t lightCountClass = LIGHT_COUNT_MANY;
+	std::vector<uint32_t> missingFeatures; // Reused every frame to avoid reallocating
+
+public:
+	std::vector<VkDescriptorSet> textureDescriptorSets;
 };
\ No newline at end of file
@@ -8,10 +8,10 @@ RenderSystemBase::RenderSystemBase(Device& device)
 
 }
 
-void RenderSystemBase::init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout additionalLayout /*= VK_NULL_HANDLE*/)
+void RenderSystemBase::init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, PipelineBatch& batch, VkDescriptorSetLayout additionalLayout /*= VK_NULL_HANDLE*/)
 {
 	createPipelineLayout(globalSetLayout, additionalLayout);
-	createPipeline(renderPass);
+	createPipeline(renderPass, batch);
 }
 
 void RenderSystemBase::update(FrameInfo& frameInfo, Buffer* buffer)
@@ -21,7 +21,6 @@ void RenderSystemBase::update(FrameInfo& frameInfo, Buffer* buffer)
 
 void RenderSystemBase::cleanup()
 {
-	vkDestroyPipelineLayout(device.getDevice(), pipelineLayout, nullptr);
 	pipeline.reset();
 }
 
@@ -2,11 +2,14 @@
 
 #include "../Device.h"
 #include "../FrameInfo.h"
+#include "../ShaderReflection.h"
 
 #include <vector>
 #include <memory>
 #include <string.h>
 
+class PipelineBatch;
+
 class RenderSystemBase
 {
 public:
@@ -16,7 +19,7 @@ public:
 	RenderSystemBase(const RenderSystemBase&) = delete;
 	RenderSystemBase& operator=(const RenderSystemBase&) = delete;
 
-	virtual void init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout additionalLayout = VK_NULL_HANDLE);
+	virtual void init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, PipelineBatch& batch, VkDescriptorSetLayout additionalLayout = VK_NULL_HANDLE);
 	virtual void update(FrameInfo& frameInfo, Buffer* buffer);
 	virtual void render(FrameInfo& frameInfo) = 0;
 	virtual void cleanup();
@@ -26,15 +29,16 @@ public:
 
 protected:
 	virtual void createPipelineLayout(VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout additionalLayout = VK_NULL_HANDLE) = 0;
-	virtual void createPipeline(VkRenderPass renderPass) = 0;
+	virtual void createPipeline(VkRenderPass renderPass, PipelineBatch& batch) = 0;
 
 protected:
 	Device& device;
 
 	std::unique_ptr<class Pipeline> pipeline;
-	VkPipelineLayout pipelineLayout;
+	VkPipelineLayout pipelineLayout; // Owned by the device's layout cache
 
 	std::string vertFilePath, fragFilePath;
+	ShaderReflection shaders; // Reflected from the shader files when the pipeline layout is created
 
 	const uint32_t maxDescriptorSets = 2;
 };
\ No newline at end of file
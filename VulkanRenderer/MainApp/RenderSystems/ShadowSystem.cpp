@@ -1,5 +1,7 @@
 #include "ShadowSystem.h"
 #include "../Pipeline.h"
+#include "../PipelineBatch.h"
+#include "../IndirectDrawList.h"
 
 ShadowSystem::ShadowSystem(Device& device)
 	:RenderSystem(device)
@@ -7,12 +9,12 @@ ShadowSystem::ShadowSystem(Device& device)
 	
 }
 
-void ShadowSystem::init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout additionalLayout /*= VK_NULL_HANDLE*/)
+void ShadowSystem::init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, PipelineBatch& batch, VkDescriptorSetLayout additionalLayout /*= VK_NULL_HANDLE*/)
 {
 	vertFilePath = "MainApp/resources/vulkan/shaders/ShadowsVert.spv";
 	//fragFilePath = "MainApp/resources/vulkan/shaders/PBRFrag.spv";
 
-	RenderSystemBase::init(renderPass, globalSetLayout, additionalLayout);
+	RenderSystemBase::init(renderPass, globalSetLayout, batch, additionalLayout);
 }
 
 void ShadowSystem::render(FrameInfo& frameInfo)
@@ -21,22 +23,7 @@ void ShadowSystem::render(FrameInfo& frameInfo)
 
 	vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 0, nullptr);
 
-	for (auto& keyValue : frameInfo.gameObjects)
-	{
-		GameObject& obj = keyValue.second;
-
-		if (!obj.model)
-			continue;
-
-		SimplePushConstantData push{};
-		push.modelMatrix = obj.transform.getTransform();
-		push.normalMatrix = obj.transform.getNormalMatrix();
-
-		vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
-
-		obj.model->bind(frameInfo.commandBuffer);
-		obj.model->draw(frameInfo.commandBuffer);
-	}
+	frameInfo.drawList->draw(frameInfo.commandBuffer, frameInfo.frameIndex);
 }
 
 void ShadowSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout additionalLayout /*= VK_NULL_HANDLE*/)
@@ -44,13 +31,13 @@ void ShadowSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout, V
 	RenderSystem::createPipelineLayout(globalSetLayout, additionalLayout);
 }
 
-void ShadowSystem::createPipeline(VkRenderPass renderPass)
+void ShadowSystem::createPipeline(VkRenderPass renderPass, PipelineBatch& batch)
 {
 	assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!");
 
-	PipelineConfigInfo pipelineConfig{};
+	PipelineConfigInfo& pipelineConfig = batch.addGraphicsPipeline(pipeline, vertFilePath, fragFilePath, PIPELINE_TYPE_DEPTH); // TODO: Create new function in Pipeline to create a pipeline mean for only depth output
 	Pipeline::defaultPipelineConfigInfo(pipelineConfig);
+	shaders.applyVertexInput(pipelineConfig);
 	pipelineConfig.renderPass = renderPass;
 	pipelineConfig.pipelineLayout = pipelineLayout;
-	pipeline = std::make_unique<Pipeline>(device, vertFilePath, fragFilePath, pipelineConfig, PIPELINE_TYPE_DEPTH); // TODO: Create new function in Pipeline to create a pipeline mean for only depth output
 }
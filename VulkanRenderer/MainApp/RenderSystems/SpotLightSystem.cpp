@@ -1,5 +1,10 @@
 #include "SpotLightSystem.h"
 #include "../Pipeline.h"
+#include "../PipelineBatch.h"
+#include "../LayoutCache.h"
+
+static const char* VERT_SHADER_PATH = "MainApp/resources/vulkan/shaders/SpotLightVert.spv";
+static const char* FRAG_SHADER_PATH = "MainApp/resources/vulkan/shaders/SpotLightFrag.spv";
 
 SpotLightSystem::SpotLightSystem(Device& device)
 	:device {device}
@@ -7,48 +12,38 @@ SpotLightSystem::SpotLightSystem(Device& device)
 
 }
 
-SpotLightSystem::~SpotLightSystem()
-{
-	vkDestroyPipelineLayout(device.getDevice(), pipelineLayout, nullptr);
-}
-
-void SpotLightSystem::init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+void SpotLightSystem::init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, PipelineBatch& batch)
 {
 	createPipelineLayout(globalSetLayout);
-	createPipeline(renderPass);
+	createPipeline(renderPass, batch);
 }
 
-void SpotLightSystem::update(FrameInfo& frameInfo, LightUbo& ubo)
+void SpotLightSystem::update(Registry& registry, LightUbo& ubo)
 {
 	int lightIndex = 0;
 
-	for (auto& keyValue : frameInfo.gameObjects)
+	registry.each<DirectionalLightComponent, TransformComponent>([&](Entity entity, DirectionalLightComponent& directionalLight,
+		TransformComponent& transform)
 	{
-		GameObject& obj = keyValue.second;
+		ubo.directionalLight.position = glm::vec4(transform.getWorldPosition(), directionalLight.lightType);
+		ubo.directionalLight.color = glm::vec4(directionalLight.color, directionalLight.intensity);
 
-		if(obj.directionalLight)
-		{
-			ubo.directionalLight.position = glm::vec4(obj.transform.translation, obj.directionalLight->lightType);
-			ubo.directionalLight.color = glm::vec4(obj.directionalLight->color, obj.directionalLight->intensity);
+		glm::vec3 direction = directionalLight.direction;
+		ubo.directionalLight.direction = glm::vec4(direction, 0.0f);
+	});
 
-			glm::vec3 direction = obj.directionalLight->direction;
-			ubo.directionalLight.direction = glm::vec4(direction, 0.0f);
-		}
-
-		if (!obj.spotLight)
-			continue;
-
-		obj.transform.updateTransform();
+	registry.each<SpotLightComponent, TransformComponent>([&](Entity entity, SpotLightComponent& spotLight, TransformComponent& transform)
+	{
 		// copy light info to ubo
-		ubo.spotLights[lightIndex].position = glm::vec4(obj.transform.translation, obj.spotLight->lightType);
-		ubo.spotLights[lightIndex].color = glm::vec4(obj.spotLight->color, obj.spotLight->intensity);
+		ubo.spotLights[lightIndex].position = glm::vec4(transform.getWorldPosition(), spotLight.lightType);
+		ubo.spotLights[lightIndex].color = glm::vec4(spotLight.color, spotLight.intensity);
 
-		glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f) * obj.transform.orientation;
-		ubo.spotLights[lightIndex].direction = glm::vec4(direction, glm::cos(glm::radians(obj.spotLight->cutoffAngle)));
-		ubo.spotLights[lightIndex].outerCutoff = glm::cos(glm::radians(obj.spotLight->outerCutoffAngle));
+		glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f) * transform.getWorldOrientation();
+		ubo.spotLights[lightIndex].direction = glm::vec4(direction, glm::cos(glm::radians(spotLight.cutoffAngle)));
+		ubo.spotLights[lightIndex].outerCutoff = glm::cos(glm::radians(spotLight.outerCutoffAngle));
 
 		lightIndex++;
-	}
+	});
 	ubo.numSpotLights = lightIndex;
 }
 
@@ -63,30 +58,18 @@ void SpotLightSystem::render(FrameInfo& frameInfo, LightUbo& ubo)
 
 void SpotLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout)
 {
-	std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout };
-
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-	pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-	pipelineLayoutInfo.pPushConstantRanges = nullptr;
-
-	VkResult res = vkCreatePipelineLayout(device.getDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout);
-	if (res != VK_SUCCESS)
-		throw std::runtime_error("Failed to create pipeline layout!");
+	shaders = ShaderReflection({ VERT_SHADER_PATH, FRAG_SHADER_PATH });
+	pipelineLayout = device.getLayoutCache().getPipelineLayout(shaders, { globalSetLayout });
 }
 
-void SpotLightSystem::createPipeline(VkRenderPass renderPass)
+void SpotLightSystem::createPipeline(VkRenderPass renderPass, PipelineBatch& batch)
 {
 	assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!");
 
-	PipelineConfigInfo pipelineConfig{};
+	PipelineConfigInfo& pipelineConfig = batch.addGraphicsPipeline(pipeline, VERT_SHADER_PATH, FRAG_SHADER_PATH);
 	Pipeline::defaultPipelineConfigInfo(pipelineConfig);
 	Pipeline::enableAlphaBlending(pipelineConfig);
-	pipelineConfig.attributeDescriptions.clear();
-	pipelineConfig.bindingDescriptions.clear();
+	shaders.applyVertexInput(pipelineConfig);
 	pipelineConfig.renderPass = renderPass;
 	pipelineConfig.pipelineLayout = pipelineLayout;
-	pipeline = std::make_unique<Pipeline>(device, "MainApp/resources/vulkan/shaders/SpotLightVert.spv", "MainApp/resources/vulkan/shaders/SpotLightFrag.spv", pipelineConfig);
 }
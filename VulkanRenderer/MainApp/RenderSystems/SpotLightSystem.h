@@ -1,32 +1,36 @@
 #pragma once
 
 #include "../Device.h"
-#include "../GameObject.h"
+#include "../Scene/Registry.h"
 #include "../FrameInfo.h"
+#include "../ShaderReflection.h"
 
 #include <vector>
 #include <memory>
 
+class PipelineBatch;
+
 class SpotLightSystem
 {
 public:
 	SpotLightSystem(Device& device);
-	~SpotLightSystem();
 
 	SpotLightSystem(const SpotLightSystem&) = delete;
 	SpotLightSystem& operator=(const SpotLightSystem&) = delete;
 
-	void init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+	void init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, PipelineBatch& batch);
 
-	void update(FrameInfo& frameInfo, LightUbo& ubo);
+	// Copies the directional and spot lights into the ubo, once transforms are up to date
+	static void update(Registry& registry, LightUbo& ubo);
 	void render(FrameInfo& frameInfo, LightUbo& ubo);
 
 private:
 	void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-	void createPipeline(VkRenderPass renderPass);
+	void createPipeline(VkRenderPass renderPass, PipelineBatch& batch);
 
 	Device& device;
 
 	std::unique_ptr<class Pipeline> pipeline;
-	VkPipelineLayout pipelineLayout;
+	VkPipelineLayout pipelineLayout; // Owned by the device's layout cache
+	ShaderReflection shaders;
 };
\ No newline at end of file
@@ -7,12 +7,12 @@ UnlitSystem::UnlitSystem(Device& device)
 
 }
 
-void UnlitSystem::init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout additionalLayout /*= VK_NULL_HANDLE*/)
+void UnlitSystem::init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, PipelineBatch& batch, VkDescriptorSetLayout additionalLayout /*= VK_NULL_HANDLE*/)
 {
 	vertFilePath = "MainApp/resources/vulkan/shaders/BasicUnlitVert.spv";
 	fragFilePath = "MainApp/resources/vulkan/shaders/BasicUnlitFrag.spv";
 
-	RenderSystemBase::init(renderPass, globalSetLayout, additionalLayout);
+	RenderSystemBase::init(renderPass, globalSetLayout, batch, additionalLayout);
 }
 
 void UnlitSystem::render(FrameInfo& frameInfo)
@@ -25,7 +25,7 @@ void UnlitSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout, Vk
 	RenderSystem::createPipelineLayout(globalSetLayout, additionalLayout);
 }
 
-void UnlitSystem::createPipeline(VkRenderPass renderPass)
+void UnlitSystem::createPipeline(VkRenderPass renderPass, PipelineBatch& batch)
 {
-	RenderSystem::createPipeline(renderPass);
+	RenderSystem::createPipeline(renderPass, batch);
 }
@@ -11,10 +11,10 @@ class UnlitSystem : public RenderSystem
 public:
 	UnlitSystem(Device& device);
 
-	virtual void init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout additionalLayout = VK_NULL_HANDLE) override;
+	virtual void init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, PipelineBatch& batch, VkDescriptorSetLayout additionalLayout = VK_NULL_HANDLE) override;
 	virtual void render(FrameInfo& frameInfo) override;
 
 private:
 	virtual void createPipelineLayout(VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout additionalLayout = VK_NULL_HANDLE) override;
-	virtual void createPipeline(VkRenderPass renderPass) override;
+	virtual void createPipeline(VkRenderPass renderPass, PipelineBatch& batch) override;
 };
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "WireframeSystem.h"
 #include "../Pipeline.h"
+#include "../PipelineBatch.h"
+#include "../IndirectDrawList.h"
 
 WireframeSystem::WireframeSystem(Device& device)
 	:RenderSystem(device)
@@ -7,12 +9,12 @@ WireframeSystem::WireframeSystem(Device& device)
 
 }
 
-void WireframeSystem::init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout additionalLayout /*= VK_NULL_HANDLE*/)
+void WireframeSystem::init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, PipelineBatch& batch, VkDescriptorSetLayout additionalLayout /*= VK_NULL_HANDLE*/)
 {
 	vertFilePath = "MainApp/resources/vulkan/shaders/WireframeVert.spv";
 	fragFilePath = "MainApp/resources/vulkan/shaders/WireframeFrag.spv";
 
-	RenderSystemBase::init(renderPass, globalSetLayout, additionalLayout);
+	RenderSystemBase::init(renderPass, globalSetLayout, batch, additionalLayout);
 }
 
 void WireframeSystem::render(FrameInfo& frameInfo)
@@ -21,22 +23,7 @@ void WireframeSystem::render(FrameInfo& frameInfo)
 
 	vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 0, nullptr);
 
-	for (auto& keyValue : frameInfo.gameObjects)
-	{
-		GameObject& obj = keyValue.second;
-
-		if (!obj.model)
-			continue;
-
-		SimplePushConstantData push{};
-		push.modelMatrix = obj.transform.getTransform();
-		push.normalMatrix = obj.transform.getNormalMatrix();
-
-		vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
-
-		obj.model->bind(frameInfo.commandBuffer);
-		obj.model->draw(frameInfo.commandBuffer);
-	}
+	frameInfo.drawList->draw(frameInfo.commandBuffer, frameInfo.frameIndex, frameInfo.drawPhase, frameInfo.firstDrawCommand, frameInfo.drawCommandCount);
 }
 
 void WireframeSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout additionalLayout /*= VK_NULL_HANDLE*/)
@@ -44,14 +31,14 @@ void WireframeSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout
 	RenderSystem::createPipelineLayout(globalSetLayout, additionalLayout);
 }
 
-void WireframeSystem::createPipeline(VkRenderPass renderPass)
+void WireframeSystem::createPipeline(VkRenderPass renderPass, PipelineBatch& batch)
 {
 	assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!");
 
-	PipelineConfigInfo pipelineConfig{};
+	PipelineConfigInfo& pipelineConfig = batch.addGraphicsPipeline(pipeline, vertFilePath, fragFilePath);
 	Pipeline::defaultPipelineConfigInfo(pipelineConfig);
+	shaders.applyVertexInput(pipelineConfig);
 	Pipeline::enableWireframe(pipelineConfig);
 	pipelineConfig.renderPass = renderPass;
 	pipelineConfig.pipelineLayout = pipelineLayout;
-	pipeline = std::make_unique<Pipeline>(device, vertFilePath, fragFilePath, pipelineConfig);
 }
@@ -1,5 +1,10 @@
 #include "WorldGridSystem.h"
 #include "../Pipeline.h"
+#include "../PipelineBatch.h"
+#include "../LayoutCache.h"
+
+static const char* VERT_SHADER_PATH = "MainApp/resources/vulkan/shaders/WorldGridVert.spv";
+static const char* FRAG_SHADER_PATH = "MainApp/resources/vulkan/shaders/WorldGridFrag.spv";
 
 WorldGridSystem::WorldGridSystem(Device& device)
 	: device{ device }
@@ -7,10 +12,10 @@ WorldGridSystem::WorldGridSystem(Device& device)
 
 }
 
-void WorldGridSystem::init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+void WorldGridSystem::init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, PipelineBatch& batch)
 {
 	createPipelineLayout(globalSetLayout);
-	createPipeline(renderPass);
+	createPipeline(renderPass, batch);
 }
 
 void WorldGridSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo)
@@ -29,35 +34,18 @@ void WorldGridSystem::render(FrameInfo& frameInfo, GlobalUbo& ubo)
 
 void WorldGridSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout)
 {
-	std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout };
-
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-	pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-	pipelineLayoutInfo.pPushConstantRanges = nullptr;//&pushConstantRange;
-
-	VkResult res = vkCreatePipelineLayout(device.getDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout);
-	if (res != VK_SUCCESS)
-		throw std::runtime_error("Failed to create pipeline layout!");
+	shaders = ShaderReflection({ VERT_SHADER_PATH, FRAG_SHADER_PATH });
+	pipelineLayout = device.getLayoutCache().getPipelineLayout(shaders, { globalSetLayout });
 }
 
-void WorldGridSystem::createPipeline(VkRenderPass renderPass)
+void WorldGridSystem::createPipeline(VkRenderPass renderPass, PipelineBatch& batch)
 {
 	assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!");
 
-	PipelineConfigInfo pipelineConfig{};
+	PipelineConfigInfo& pipelineConfig = batch.addGraphicsPipeline(pipeline, VERT_SHADER_PATH, FRAG_SHADER_PATH);
 	Pipeline::defaultPipelineConfigInfo(pipelineConfig);
 	Pipeline::enableAlphaBlending(pipelineConfig);
-	pipelineConfig.attributeDescriptions.clear();
-	pipelineConfig.bindingDescriptions.clear();
+	shaders.applyVertexInput(pipelineConfig);
 	pipelineConfig.renderPass = renderPass;
 	pipelineConfig.pipelineLayout = pipelineLayout;
-	pipeline = std::make_unique<Pipeline>(device, "MainApp/resources/vulkan/shaders/WorldGridVert.spv", "MainApp/resources/vulkan/shaders/WorldGridFrag.spv", pipelineConfig);
-}
-
-WorldGridSystem::~WorldGridSystem()
-{
-	vkDestroyPipelineLayout(device.getDevice(), pipelineLayout, nullptr);
 }
@@ -1,34 +1,37 @@
 #pragma once
 
 #include "../Device.h"
-#include "../GameObject.h"
+#include "../Scene/Registry.h"
 #include "../FrameInfo.h"
+#include "../ShaderReflection.h"
 
 #include <vector>
 #include <memory>
 
+class PipelineBatch;
+
 class WorldGridSystem
 {
 public:
 	WorldGridSystem(Device& device);
-	~WorldGridSystem();
 
 	WorldGridSystem(const WorldGridSystem&) = delete;
 	WorldGridSystem& operator=(const WorldGridSystem&) = delete;
 
-	void init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+	void init(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, PipelineBatch& batch);
 
 	void update(FrameInfo& frameInfo, GlobalUbo& ubo);
 	void render(FrameInfo& frameInfo, GlobalUbo& ubo);
 
 private:
 	void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-	void createPipeline(VkRenderPass renderPass);
+	void createPipeline(VkRenderPass renderPass, PipelineBatch& batch);
 
 	Device& device;
 
 	std::unique_ptr<class Pipeline> pipeline;
-	VkPipelineLayout pipelineLayout;
+	VkPipelineLayout pipelineLayout; // Owned by the device's layout cache
+	ShaderReflection shaders;
 
 	float minClip = 0.1f;
 	float maxClip = 500.0f;
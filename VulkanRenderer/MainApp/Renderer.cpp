@@ -1,7 +1,11 @@
 #include "Renderer.h"
 #include "Log.h"
-//#include "GameObject.h"
 #include "SceneSerializer.h"
+#include "UploadContext.h"
+#include "PipelineCache.h"
+#include "PipelineBatch.h"
+#include "LayoutCache.h"
+#include "ShaderReflection.h"
 
 #include <set>
 #include <algorithm>
@@ -28,14 +32,14 @@
 
 Renderer* Renderer::rendererInstance = nullptr;
 
-Renderer* Renderer::initInstance(Window* window)
+Renderer* Renderer::initInstance(Window* window, const RendererSettings& settings)
 {
 	Log::init();
 	CORE_WARN("Log initialized!");
 
 	if (!Renderer::rendererInstance)
 	{
-		Renderer::rendererInstance = new Renderer(window);
+		Renderer::rendererInstance = new Renderer(window, settings);
 
 		return Renderer::rendererInstance;
 	}
@@ -54,11 +58,19 @@ void Renderer::cleanupInstance()
 	}
 }
 
-Renderer::Renderer(Window* appWindow)
+Renderer::Renderer(Window* appWindow, const RendererSettings& settings)
 	:window(appWindow)
 {
+	framesInFlight = requestedFramesInFlight = std::clamp(settings.framesInFlight, 1u, static_cast<uint32_t>(SwapChain::MAX_FRAMES_IN_FLIGHT));
+	presentMode = requestedPresentMode = settings.presentMode;
+	uncappedBenchmark = requestedUncappedBenchmark = settings.uncappedBenchmark;
+
 	compileShaders();
+
+	auto start = std::chrono::high_resolution_clock::now();
 	init();
+	float startupTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	CORE_WARN("Renderer initialized in {0:.2f} ms ({1} start)", startupTime, mDevice.getPipelineCache().isWarm() ? "warm" : "cold")
 }
 
 void Renderer::init()
@@ -67,11 +79,11 @@ void Renderer::init()
 
 	globalDescriptorPool =
 		DescriptorPool::Builder(mDevice)
-		.setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT * 2)
+		.setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
 		.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
 		.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
-		.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 6)
-		.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, SwapChain::MAX_FRAMES_IN_FLIGHT)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT) // objects
+		.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT) // visible object indices
 		.build();
 
 	imguiDescriptorPool =
@@ -81,80 +93,81 @@ void Renderer::init()
 		.setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
 		.build();
 
-	createCommandBuffers();
-
 	imguiInit();
 
-	uboBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
-	for (int i = 0; i < uboBuffers.size(); i++)
-	{
-		uboBuffers[i] = std::make_unique<Buffer>(mDevice, sizeof(GlobalUbo), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-		uboBuffers[i]->map();
-	}
-
-	lightUboBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
-	for (int i = 0; i < lightUboBuffers.size(); i++)
-	{
-		lightUboBuffers[i] = std::make_unique<Buffer>(mDevice, sizeof(LightUbo), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-		lightUboBuffers[i]->map();
-	}
-
-	// highest set common to all shaders
-	std::unique_ptr<DescriptorSetLayout> globalSetLayout = DescriptorSetLayout::Builder(mDevice)
-		.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
-		.addBinding(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
-		.build();
-
-	std::unique_ptr<DescriptorSetLayout> materialSetLayout = DescriptorSetLayout::Builder(mDevice)
-		.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, MAX_TEXTURE_BINDINGS)
-		.addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, MAX_TEXTURE_BINDINGS)
-		.addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, MAX_TEXTURE_BINDINGS)
-		.addBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, MAX_TEXTURE_BINDINGS)
-		.addBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, MAX_TEXTURE_BINDINGS)
-		.addBinding(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, MAX_TEXTURE_BINDINGS)
-		.addBinding(6, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL_GRAPHICS) // per material ubo
-		.build();
-
-	globalDescriptorSets.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
-	for (int i = 0; i < globalDescriptorSets.size(); i++)
-	{
-		VkDescriptorBufferInfo bufferInfo = uboBuffers[i]->descriptorInfo();
-		VkDescriptorBufferInfo lightBufferInfo = lightUboBuffers[i]->descriptorInfo();
-		DescriptorWriter(*globalSetLayout, *globalDescriptorPool)
-			.writeBuffer(0, &bufferInfo)
-			.writeBuffer(1, &lightBufferInfo)
-			.build(globalDescriptorSets[i]);
-	}
-
-	materialDescriptorSets.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+	// Set 0 is bound once for every graphics pipeline, so its layout is the union of what all of their
+	// shaders declare: camera and light ubos, per object data and visible object indices
+	ShaderReflection graphicsShaders({
+		"MainApp/resources/vulkan/shaders/PBRVert.spv", "MainApp/resources/vulkan/shaders/PBRFrag.spv",
+		"MainApp/resources/vulkan/shaders/BasicUnlitVert.spv", "MainApp/resources/vulkan/shaders/BasicUnlitFrag.spv",
+		"MainApp/resources/vulkan/shaders/WireframeVert.spv", "MainApp/resources/vulkan/shaders/WireframeFrag.spv",
+		"MainApp/resources/vulkan/shaders/PointLightVert.spv", "MainApp/resources/vulkan/shaders/PointLightFrag.spv",
+		"MainApp/resources/vulkan/shaders/SpotLightVert.spv", "MainApp/resources/vulkan/shaders/SpotLightFrag.spv",
+		"MainApp/resources/vulkan/shaders/WorldGridVert.spv", "MainApp/resources/vulkan/shaders/WorldGridFrag.spv",
+		"MainApp/resources/vulkan/shaders/ShadowsVert.spv" });
+	globalSetLayout = &mDevice.getLayoutCache().getSetLayout(graphicsShaders, 0);
 
 	CORE_WARN("Loading Game Objects...")
 	SceneSerializer serializer;
-	if(!serializer.deserialize("MainApp/resources/scenes/untitled.scene", mDevice, sceneData))
+	if(!serializer.deserialize("MainApp/resources/scenes/untitled.scene", mDevice, sceneData, &jobSystem))
 	{
 		CORE_ERROR("Failed to load scene!")
 	}
 	CORE_WARN("Game Object Load Complete!")
 
-	materialUboBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
-	minUboAlignment = mDevice.properties.limits.minUniformBufferOffsetAlignment;
-	for (size_t i = 0; i < materialUboBuffers.size(); i++)
-	{
-		materialUboBuffers[i] = std::make_unique<Buffer>(mDevice, sizeof(MaterialUbo), sceneData.materialCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, minUboAlignment);
-		materialUboBuffers[i]->map(materialUboBuffers[i]->getBufferSize());
-	}	
+	drawList.init(sceneData.registry.pool<MeshComponent>().size());
+
+	createFrameResources();
 
+	// Materials and their textures are bound once per frame, indexed by ObjectData
 	CORE_WARN("Loading Materials...")
-	loadMaterials(*materialSetLayout);
+	materialTable.init(graphicsShaders);
+	for (auto& material : sceneData.materials)
+	{
+		materialTable.registerMaterial(material.second);
+	}
 	CORE_WARN("Material Load Finished!")
 
-	renderSystem.init(getSwapChainRenderPass().renderPass, globalSetLayout->getDescriptorSetLayout(), materialSetLayout->getDescriptorSetLayout());
-	pointLightSystem.init(getSwapChainRenderPass().renderPass, globalSetLayout->getDescriptorSetLayout());
-	wireframeSystem.init(getSwapChainRenderPass().renderPass, globalSetLayout->getDescriptorSetLayout());
-	unlitSystem.init(getSwapChainRenderPass().renderPass, globalSetLayout->getDescriptorSetLayout(), materialSetLayout->getDescriptorSetLayout());
-	gridSystem.init(getSwapChainRenderPass().renderPass, globalSetLayout->getDescriptorSetLayout());
-	spotLightSystem.init(getSwapChainRenderPass().renderPass, globalSetLayout->getDescriptorSetLayout());
-	//shadowSystem.init(depthPass.renderPass, globalSetLayout->getDescriptorSetLayout());
+	// Scene assets only record their copies, kick them all off in one submission
+	mDevice.getUploadContext().submit();
+	mDevice.getAllocator().logHeapStats();
+
+	// Startup is dominated by pipeline compilation when the cache is cold. The systems only describe
+	// their pipelines here, the batch then compiles all of them at once on the job system.
+	auto pipelineStart = std::chrono::high_resolution_clock::now();
+	renderSystem.init(getSwapChainRenderPass().renderPass, globalSetLayout->getDescriptorSetLayout(), pipelineBatch, materialTable.getSetLayout());
+	{
+		// PBR permutations for the scene's materials at its current light count, anything else is built the first time it's drawn
+		std::vector<uint32_t> materialFeatures;
+		for (auto& material : sceneData.materials)
+		{
+			materialFeatures.push_back(material.second->getFeatures());
+		}
+		LightUbo sceneLights{};
+		PointLightSystem::update(sceneData.registry, sceneLights);
+		SpotLightSystem::update(sceneData.registry, sceneLights);
+		renderSystem.addPermutations(materialFeatures, RenderSystem::getLightCountClass(sceneLights), pipelineBatch);
+	}
+	pointLightSystem.init(getSwapChainRenderPass().renderPass, globalSetLayout->getDescriptorSetLayout(), pipelineBatch);
+	wireframeSystem.init(getSwapChainRenderPass().renderPass, globalSetLayout->getDescriptorSetLayout(), pipelineBatch);
+	unlitSystem.init(getSwapChainRenderPass().renderPass, globalSetLayout->getDescriptorSetLayout(), pipelineBatch, materialTable.getSetLayout());
+	gridSystem.init(getSwapChainRenderPass().renderPass, globalSetLayout->getDescriptorSetLayout(), pipelineBatch);
+	spotLightSystem.init(getSwapChainRenderPass().renderPass, globalSetLayout->getDescriptorSetLayout(), pipelineBatch);
+	//shadowSystem.init(depthPass.renderPass, globalSetLayout->getDescriptorSetLayout(), pipelineBatch);
+	cullingSystem.init(drawList, mSwapChain->getRenderPass(), pipelineBatch);
+	uint32_t pipelineCount = pipelineBatch.size();
+	pipelineBatch.build(jobSystem);
+	float pipelineTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - pipelineStart).count();
+	CORE_INFO("Created {0} pipelines in {1:.2f} ms on {2} threads ({3} pipeline cache)", pipelineCount, pipelineTime, jobSystem.getWorkerCount() + 1,
+		mDevice.getPipelineCache().isWarm() ? "warm" : "cold")
+	LayoutCache& layoutCache = mDevice.getLayoutCache();
+	CORE_INFO("Created {0} descriptor set layouts and {1} pipeline layouts for {2} requests", layoutCache.getSetLayoutCount(),
+		layoutCache.getPipelineLayoutCount(), layoutCache.getRequestCount())
+
+	// One pool for every thread that can run a job
+	secondaryCommandPools.init(jobSystem.getThreadCount());
+
+	setCullingMode(CULLING_GPU);
 
 	mainCamera = Camera();
 	mainCamera.updateModel(0.0f);
@@ -181,6 +194,7 @@ void Renderer::imguiInit()
 	init_info.MinImageCount = 3;
 	init_info.ImageCount = 3;
 	init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+	init_info.PipelineCache = mDevice.getPipelineCache().getCache();
 
 	ImGui_ImplVulkan_Init(&init_info, getSwapChainRenderPass().renderPass);
 
@@ -203,11 +217,21 @@ void Renderer::setRenderMode(RenderMode mode)
 	renderMode = mode;
 }
 
+void Renderer::setCullingMode(CullingMode mode)
+{
+	// The compute pass can only drop instances when indirect draws honor firstInstance
+	if (mode == CULLING_GPU && !mDevice.supportsDrawIndirectFirstInstance())
+	{
+		CORE_WARN("GPU culling needs drawIndirectFirstInstance, culling on the CPU instead")
+		mode = CULLING_CPU;
+	}
+	cullingMode = mode;
+}
+
 void Renderer::compileShaders()
 {
-	// TODO: Shift this to the actual proper API call
 	CORE_WARN("Compiling Shaders:")
-	system("CompileShaders.bat");
+	shaderCompiler.compileAll(jobSystem);
 	CORE_WARN("Shader Compilation Complete!")
 }
 
@@ -228,9 +252,48 @@ std::vector<char> Renderer::readBinaryFile(const std::string& filename)
 	return buffer;
 }
 
+void Renderer::createFrameResources()
+{
+	freeCommandBuffers();
+	createCommandBuffers();
+
+	uboBuffers.clear();
+	uboBuffers.resize(framesInFlight);
+	for (int i = 0; i < uboBuffers.size(); i++)
+	{
+		uboBuffers[i] = std::make_unique<Buffer>(mDevice, sizeof(GlobalUbo), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+		uboBuffers[i]->map();
+	}
+
+	lightUboBuffers.clear();
+	lightUboBuffers.resize(framesInFlight);
+	for (int i = 0; i < lightUboBuffers.size(); i++)
+	{
+		lightUboBuffers[i] = std::make_unique<Buffer>(mDevice, sizeof(LightUbo), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+		lightUboBuffers[i]->map();
+	}
+
+	// The pool is sized for the most frames in flight, so the sets are simply reallocated
+	globalDescriptorPool->resetPool();
+	globalDescriptorSets.resize(framesInFlight);
+	for (int i = 0; i < globalDescriptorSets.size(); i++)
+	{
+		VkDescriptorBufferInfo bufferInfo = uboBuffers[i]->descriptorInfo();
+		VkDescriptorBufferInfo lightBufferInfo = lightUboBuffers[i]->descriptorInfo();
+		VkDescriptorBufferInfo objectBufferInfo = drawList.getObjectBufferInfo(i);
+		VkDescriptorBufferInfo visibleBufferInfo = drawList.getVisibleBufferInfo(i);
+		DescriptorWriter(*globalSetLayout, *globalDescriptorPool)
+			.writeBuffer(0, &bufferInfo)
+			.writeBuffer(1, &lightBufferInfo)
+			.writeBuffer(2, &objectBufferInfo)
+			.writeBuffer(3, &visibleBufferInfo)
+			.build(globalDescriptorSets[i]);
+	}
+}
+
 void Renderer::createCommandBuffers()
 {
-	commandBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+	commandBuffers.resize(framesInFlight);
 
 	VkCommandBufferAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -244,7 +307,7 @@ void Renderer::createCommandBuffers()
 		throw std::runtime_error("Failed to allocate command buffers!");
 	}
 
-	shadowCommandBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+	shadowCommandBuffers.resize(framesInFlight);
 	if (vkAllocateCommandBuffers(mDevice.getDevice(), &allocInfo, shadowCommandBuffers.data()) != VK_SUCCESS)
 	{
 		CORE_ERROR("Failed to allocate shadow pass command buffers!")
@@ -254,13 +317,20 @@ void Renderer::createCommandBuffers()
 
 void Renderer::freeCommandBuffers()
 {
-	vkFreeCommandBuffers(mDevice.getDevice(), mDevice.getCommandPool(), static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-	commandBuffers.clear();
+	if (!commandBuffers.empty())
+	{
+		vkFreeCommandBuffers(mDevice.getDevice(), mDevice.getCommandPool(), static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+		commandBuffers.clear();
+	}
+	if (!shadowCommandBuffers.empty())
+	{
+		vkFreeCommandBuffers(mDevice.getDevice(), mDevice.getCommandPool(), static_cast<uint32_t>(shadowCommandBuffers.size()), shadowCommandBuffers.data());
+		shadowCommandBuffers.clear();
+	}
 }
 
 void Renderer::recreateSwapChain()
 {	
-	//Rework
 	VkExtent2D extent = window->getExtent();
 
 	// Check if window is minimized
@@ -270,76 +340,144 @@ void Renderer::recreateSwapChain()
 		glfwWaitEvents();
 	}
 
-	if(depthPass.renderPass)
-		depthPass.cleanup(mDevice);
-
-	vkDeviceWaitIdle(mDevice.getDevice());
-	mSwapChain = nullptr;
+	VkPresentModeKHR requestedMode = uncappedBenchmark ? VK_PRESENT_MODE_IMMEDIATE_KHR : presentMode;
+	VkRenderPass oldRenderPass = mSwapChain ? mSwapChain->getRenderPass().renderPass : VK_NULL_HANDLE;
 	if (mSwapChain == nullptr)
 	{
-		mSwapChain = std::make_unique<SwapChain>(mDevice, extent);
-		depthPass.createRenderPass(mDevice, mSwapChain->getWidth(), mSwapChain->getHeight());
+		mSwapChain = std::make_unique<SwapChain>(mDevice, extent, framesInFlight, requestedMode);
 	}
 	else
 	{
+		// Only the old swap chain's frames and presents have to finish, unlike vkDeviceWaitIdle this leaves
+		// uploads on the transfer queue running. Handing the old swap chain over lets the driver reuse its images.
+		mSwapChain->waitForFrames(0);
+		vkQueueWaitIdle(mDevice.presentQueue());
+
+		// Pipelines replaced by a shader reload can only have been used by those frames
+		retiredPipelines.clear();
+
 		std::shared_ptr<SwapChain> oldSwapChain = std::move(mSwapChain); // std::move makes a copy of ptr and sets mSwapChain to nullptr
-		mSwapChain = std::make_unique<SwapChain>(mDevice, extent, oldSwapChain); 
-		depthPass.createRenderPass(mDevice, mSwapChain->getWidth(), mSwapChain->getHeight());
+		mSwapChain = std::make_unique<SwapChain>(mDevice, extent, framesInFlight, requestedMode, oldSwapChain);
 
 		if (!oldSwapChain->compareSwapFormats(*mSwapChain.get()))
 		{
 			throw std::runtime_error("Swap chain image or depth format has changed!");
 		}
 	}
+
+	// Immediate tears but is not always available, mailbox is the next best way to run uncapped
+	if (uncappedBenchmark && mSwapChain->getPresentMode() == VK_PRESENT_MODE_FIFO_KHR)
+	{
+		std::shared_ptr<SwapChain> oldSwapChain = std::move(mSwapChain);
+		mSwapChain = std::make_unique<SwapChain>(mDevice, extent, framesInFlight, VK_PRESENT_MODE_MAILBOX_KHR, oldSwapChain);
+	}
+
+	// Pipelines are rebuilt against the new render passes when their shaders change
+	if (oldRenderPass != VK_NULL_HANDLE)
+		pipelineBatch.replaceRenderPass(oldRenderPass, mSwapChain->getRenderPass().renderPass);
+
+	VkRenderPass oldDepthPass = depthPass.renderPass;
+	if(depthPass.renderPass)
+		depthPass.cleanup(mDevice);
+	depthPass.createRenderPass(mDevice, mSwapChain->getWidth(), mSwapChain->getHeight());
+	if (oldDepthPass != VK_NULL_HANDLE)
+		pipelineBatch.replaceRenderPass(oldDepthPass, depthPass.renderPass);
+
+	// The new swap chain starts over at its first frame slot
+	currentFrameIndex = 0;
+
+	if (cullingSystem.isInitialized())
+		cullingSystem.onSwapChainRecreated(mSwapChain->getRenderPass());
+}
+
+void Renderer::setFramesInFlight(uint32_t count)
+{
+	requestedFramesInFlight = std::clamp(count, 1u, static_cast<uint32_t>(SwapChain::MAX_FRAMES_IN_FLIGHT));
+}
+
+void Renderer::setPresentMode(VkPresentModeKHR mode)
+{
+	requestedPresentMode = mode;
 }
 
-void Renderer::loadMaterials(DescriptorSetLayout& layout)
+void Renderer::setUncappedBenchmark(bool uncapped)
 {
-	for (uint32_t i = 0; i < (uint32_t)materialDescriptorSets.size(); i++)
+	requestedUncappedBenchmark = uncapped;
+}
+
+void Renderer::applySwapChainSettings()
+{
+	bool framesInFlightChanged = requestedFramesInFlight != framesInFlight;
+	if (!framesInFlightChanged && requestedPresentMode == presentMode && requestedUncappedBenchmark == uncappedBenchmark)
+		return;
+
+	if (requestedUncappedBenchmark && !uncappedBenchmark)
 	{
-		VkDescriptorBufferInfo bufferInfo = materialUboBuffers[i]->descriptorInfo(materialUboBuffers[i]->getAlignmentSize());
-		DescriptorWriter(layout, *globalDescriptorPool).writeBuffer(6, &bufferInfo).build(materialDescriptorSets[i]);
+		benchmarkFrameCount = 0;
+		benchmarkTime = 0.0f;
 	}
 
-	uint32_t textureIndex = 0;
-	for (std::pair<std::string, std::shared_ptr<Material>> material : sceneData.materials)
+	framesInFlight = requestedFramesInFlight;
+	presentMode = requestedPresentMode;
+	uncappedBenchmark = requestedUncappedBenchmark;
+	recreateSwapChain();
+
+	// recreateSwapChain waited for every frame, so nothing is using the old per-frame resources
+	if (framesInFlightChanged)
 	{
-		ShaderParameters& params = material.second->getShaderParameters();
-		if (params.toggleTexture)
-		{
-			for (std::pair<uint32_t, Texture> texture : params.materialTextures)
-			{
-				uint32_t binding = texture.first;
-				Texture& tex = texture.second;
-
-				VkDescriptorImageInfo imageInfo{};
-				imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-				imageInfo.imageView = tex.getTextureImageView();
-				imageInfo.sampler = tex.getTextureSampler();
-
-				for (uint32_t j = 0; j < materialDescriptorSets.size(); j++)
-				{
-					DescriptorWriter(layout, *globalDescriptorPool).writeImageAtIndex(binding, textureIndex, &imageInfo).overwrite(materialDescriptorSets[j]);
-				}
-			}
-			params.textureIndex = textureIndex;
-			sceneData.materials[material.first]->setShaderParameters(params);
-			textureIndex++;
-		}
+		createFrameResources();
+		CORE_INFO("Frames in flight: {0}", framesInFlight)
 	}
 }
 
-void Renderer::cleanupTextures()
+void Renderer::updateShaders()
 {
-	for(auto& mat : sceneData.materials)
+	retiredPipelines.erase(std::remove_if(retiredPipelines.begin(), retiredPipelines.end(), [this](const RetiredPipeline& retired)
+	{
+		return mSwapChain->isFrameComplete(retired.lastFrame);
+	}), retiredPipelines.end());
+
+	// The watcher catches saved files, a requested reload checks every shader in case it missed one
+	std::vector<std::string> changedFiles;
+	if (shaderReloadRequested)
+	{
+		shaderReloadRequested = false;
+		changedFiles = shaderCompiler.compileAll(jobSystem);
+	}
+	else
+	{
+		std::vector<std::string> writtenSources = shaderWatcher.poll();
+		if (!writtenSources.empty())
+			changedFiles = shaderCompiler.compile(writtenSources, jobSystem);
+	}
+
+	if (changedFiles.empty())
+		return;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector<std::unique_ptr<Pipeline>> replaced;
+	try
+	{
+		uint32_t rebuiltCount = pipelineBatch.rebuild(changedFiles, jobSystem, replaced);
+		float rebuildTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		CORE_INFO("Rebuilt {0} pipelines in {1:.2f} ms", rebuiltCount, rebuildTime)
+	}
+	catch (const std::exception& e)
+	{
+		CORE_ERROR("Failed to rebuild pipelines, keeping the old ones: {0}", e.what())
+	}
+
+	for (std::unique_ptr<Pipeline>& pipeline : replaced)
 	{
-		mat.second->cleanup(mDevice);
+		retiredPipelines.push_back({ mSwapChain->getSubmittedFrames(), std::move(pipeline) });
 	}
 }
 
-bool Renderer::hasStencilComponent(VkFormat format)
+void Renderer::waitForNextFrame()
 {
-	return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
+	// Normally the CPU may run framesInFlight - 1 frames ahead, in low latency mode it never does
+	mSwapChain->waitForFrames(lowLatency ? 0 : framesInFlight - 1);
+	mSwapChain->markInputSampled();
 }
 
 VkCommandBuffer Renderer::beginFrame()
@@ -377,19 +515,61 @@ VkCommandBuffer Renderer::beginFrame()
 
 void Renderer::drawFrame(float dt)
 {
+	applySwapChainSettings();
+	updateShaders();
+
+	if (uncappedBenchmark)
+	{
+		benchmarkFrameCount++;
+		benchmarkTime += dt;
+	}
+
+	// Uploads recorded since last frame are submitted ahead of this frame's work
+	mDevice.getUploadContext().update();
+	mDevice.getMeshPool().update();
+
+	if (!simulation.isRunning())
+	{
+		PointLightSystem::simulate(sceneData.registry, dt);
+
+		// Edits made since last frame, by the editor or by systems, are applied before anything reads the matrices
+		transformSystem.update(sceneData.registry, &jobSystem);
+	}
+
 	VkCommandBuffer commandBuffer = beginFrame();
 	int frameIndex = getFrameIndex();
 
+	// Taken after the fence wait in beginFrame, so it is as recent as possible
+	const RenderSnapshot* snapshot = simulation.isRunning() ? &simulation.acquireSnapshot() : nullptr;
+
 	FrameInfo frameInfo
 	{
 		frameIndex, currentFrametime, currentFramerate, dt,
 		showGrid, renderMode, commandBuffer, mainCamera,
-		globalDescriptorSets[frameIndex], materialDescriptorSets[frameIndex], sceneData.objects,
-		0, 0
+		globalDescriptorSets[frameIndex], materialTable.getDescriptorSet(frameIndex), sceneData.registry,
+		0
 	};
 
 	frameInfo.numObjs = totalObjects;
-	frameInfo.dynamicOffset = materialUboBuffers[frameIndex]->getAlignmentSize();
+	frameInfo.drawList = &drawList;
+	frameInfo.jobSystem = &jobSystem;
+	frameInfo.cullingMode = cullingMode;
+	frameInfo.occlusionCulling = cullingMode == CULLING_GPU && renderMode != WIREFRAME;
+	frameInfo.recordingThreadCount = recordingThreadCount;
+	frameInfo.recordTime = recordTime;
+	frameInfo.threadedSimulation = snapshot != nullptr;
+	frameInfo.simulationTick = snapshot ? snapshot->tick : 0;
+	frameInfo.framesInFlight = framesInFlight;
+	frameInfo.lowLatency = lowLatency;
+	frameInfo.timelinePacing = mSwapChain->usesTimelineSemaphore();
+	frameInfo.inputLatency = mSwapChain->getInputLatency();
+	frameInfo.presentMode = mSwapChain->getPresentMode();
+	frameInfo.uncappedBenchmark = uncappedBenchmark;
+	frameInfo.benchmarkFrameCount = benchmarkFrameCount;
+	frameInfo.benchmarkFrameTime = benchmarkFrameCount > 0 ? benchmarkTime * 1000.0f / benchmarkFrameCount : 0.0f;
+
+	// Camera input was handled right before this frame, it goes into the ubo without waiting for the simulation
+	mainCamera.updateModel(dt);
 
 	// update ubos
 	GlobalUbo ubo{};
@@ -400,44 +580,41 @@ void Renderer::drawFrame(float dt)
 	uboBuffers[frameIndex]->flush();
 
 	LightUbo lightUbo{};
-	pointLightSystem.update(frameInfo, lightUbo);
-	spotLightSystem.update(frameInfo, lightUbo);
+	if (snapshot)
+	{
+		lightUbo = snapshot->lights;
+	}
+	else
+	{
+		PointLightSystem::update(sceneData.registry, lightUbo);
+		SpotLightSystem::update(sceneData.registry, lightUbo);
+	}
 	lightUboBuffers[frameIndex]->writeToBuffer(&lightUbo);
 	lightUboBuffers[frameIndex]->flush();
 
 	if (commandBuffer)
 	{
-		// render
-		beginSwapChainRenderPass(commandBuffer);
-		mainCamera.updateModel(dt);
-
-		switch (renderMode)
+		// Object data and draw commands are shared by every mesh render system this frame
+		std::array<glm::vec4, 6> frustumPlanes = mainCamera.getFrustumPlanes();
+		const std::array<glm::vec4, 6>* cpuCullPlanes = cullingMode == CULLING_CPU ? &frustumPlanes : nullptr;
+		if (snapshot)
 		{
-		case DEFAULT_LIT:
-			// order matters for transparency
-			renderSystem.update(frameInfo, materialUboBuffers[frameIndex].get());
-			renderSystem.render(frameInfo);
-			pointLightSystem.render(frameInfo, lightUbo);
-			spotLightSystem.render(frameInfo, lightUbo);
-			break;
-		case WIREFRAME:
-			wireframeSystem.render(frameInfo);
-			break;
-		case UNLIT:
-			unlitSystem.update(frameInfo, materialUboBuffers[frameIndex].get());
-			unlitSystem.render(frameInfo);
-			break;
-		default:
-			break;
+			materialTable.update(frameIndex, *snapshot);
+			drawList.build(frameIndex, *snapshot, cpuCullPlanes, &jobSystem);
 		}
+		else
+		{
+			materialTable.update(frameIndex, sceneData.registry);
+			drawList.build(frameIndex, sceneData.registry, cpuCullPlanes, &jobSystem);
+		}
+		renderSystem.updatePermutations(drawList, lightUbo, pipelineBatch, jobSystem);
+		cullingSystem.cull(frameInfo);
 
-		if(showGrid)
-			gridSystem.render(frameInfo, ubo);
-
-		drawImGui(frameInfo);
-		ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
-
-		endSwapChainRenderPass(commandBuffer);
+		// render
+		if (parallelRecording)
+			recordSwapChainPassParallel(frameInfo, ubo, lightUbo);
+		else
+			recordSwapChainPass(frameInfo, ubo, lightUbo);
 
 		//depthPass.begin(commandBuffer);
 		//shadowSystem.render(frameInfo);
@@ -472,7 +649,7 @@ void Renderer::endFrame()
 		throw std::runtime_error("Failed to present swap chain image!");
 
 	frameStarted = false;
-	currentFrameIndex = (currentFrameIndex + 1) % SwapChain::MAX_FRAMES_IN_FLIGHT;
+	currentFrameIndex = (currentFrameIndex + 1) % framesInFlight;
 }
 
 VkResult Renderer::submit(std::vector<VkCommandBuffer> commadBuffers)
@@ -497,19 +674,167 @@ void Renderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer)
 	//vkCmdEndRenderPass(commandBuffer);
 }
 
+void Renderer::recordSwapChainPass(FrameInfo& frameInfo, GlobalUbo& ubo, LightUbo& lightUbo)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+	beginSwapChainRenderPass(commandBuffer);
+
+	renderMeshes(frameInfo);
+
+	if (frameInfo.occlusionCulling)
+	{
+		// Redraw what last frame's Hi-Z hid but this frame's depth does not
+		endSwapChainRenderPass(commandBuffer);
+		cullingSystem.cullSecondPhase(frameInfo, currentImageIndex);
+		getSwapChainRenderPass().begin(commandBuffer, currentImageIndex, true);
+
+		frameInfo.drawPhase = 1;
+		renderMeshes(frameInfo);
+		frameInfo.drawPhase = 0;
+	}
+
+	drawImGui(frameInfo);
+	renderOverlays(frameInfo, ubo, lightUbo);
+
+	endSwapChainRenderPass(commandBuffer);
+
+	recordingThreadCount = 1;
+	recordTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void Renderer::recordSwapChainPassParallel(FrameInfo& frameInfo, GlobalUbo& ubo, LightUbo& lightUbo)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+	int frameIndex = frameInfo.frameIndex;
+
+	// This frame's fence has been waited on, so its secondary command buffers can be recorded again
+	secondaryCommandPools.reset(frameIndex);
+
+	// Chunks are ranges of draw commands, large enough that recording one outweighs handing it out
+	const uint32_t commandCount = drawList.getCommandCount();
+	const uint32_t threadCount = jobSystem.getWorkerCount() + 1;
+	const uint32_t commandsPerChunk = std::max((commandCount + threadCount - 1) / threadCount, MIN_COMMANDS_PER_CHUNK);
+	const uint32_t chunkCount = std::max((commandCount + commandsPerChunk - 1) / commandsPerChunk, 1u);
+	const uint32_t phaseCount = frameInfo.occlusionCulling ? IndirectDrawList::PHASE_COUNT : 1;
+
+	meshCommandBuffers.assign(chunkCount * phaseCount, VK_NULL_HANDLE);
+	jobSystem.parallelFor(chunkCount * phaseCount, 1, [&](uint32_t chunk, uint32_t, uint32_t threadIndex)
+	{
+		FrameInfo chunkInfo = frameInfo;
+		chunkInfo.commandBuffer = beginSecondaryCommandBuffer(frameIndex, threadIndex);
+		chunkInfo.drawPhase = chunk / chunkCount;
+		chunkInfo.firstDrawCommand = (chunk % chunkCount) * commandsPerChunk;
+		chunkInfo.drawCommandCount = commandsPerChunk;
+
+		renderMeshes(chunkInfo);
+
+		secondaryCommandPools.end(chunkInfo.commandBuffer);
+		meshCommandBuffers[chunk] = chunkInfo.commandBuffer;
+	});
+
+	// The editor can change the scene, so it only runs once the workers are done reading the draw list
+	drawImGui(frameInfo);
+
+	FrameInfo overlayInfo = frameInfo;
+	overlayInfo.commandBuffer = beginSecondaryCommandBuffer(frameIndex, jobSystem.getThreadIndex());
+	renderOverlays(overlayInfo, ubo, lightUbo);
+	secondaryCommandPools.end(overlayInfo.commandBuffer);
+
+	VkCommandBuffer* phaseCommandBuffers = meshCommandBuffers.data();
+	getSwapChainRenderPass().begin(commandBuffer, currentImageIndex, false, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	vkCmdExecuteCommands(commandBuffer, chunkCount, phaseCommandBuffers);
+
+	if (frameInfo.occlusionCulling)
+	{
+		// Redraw what last frame's Hi-Z hid but this frame's depth does not
+		endSwapChainRenderPass(commandBuffer);
+		cullingSystem.cullSecondPhase(frameInfo, currentImageIndex);
+		getSwapChainRenderPass().begin(commandBuffer, currentImageIndex, true, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		vkCmdExecuteCommands(commandBuffer, chunkCount, phaseCommandBuffers + chunkCount);
+	}
+
+	vkCmdExecuteCommands(commandBuffer, 1, &overlayInfo.commandBuffer);
+	endSwapChainRenderPass(commandBuffer);
+
+	recordingThreadCount = std::min(chunkCount * phaseCount, threadCount);
+	recordTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+VkCommandBuffer Renderer::beginSecondaryCommandBuffer(int frameIndex, uint32_t threadIndex)
+{
+	VkCommandBufferInheritanceInfo inheritanceInfo = getSwapChainRenderPass().getInheritanceInfo(currentImageIndex);
+	VkCommandBuffer commandBuffer = secondaryCommandPools.begin(frameIndex, threadIndex, inheritanceInfo);
+
+	// Dynamic state is not inherited from the primary command buffer
+	getSwapChainRenderPass().setViewportAndScissor(commandBuffer);
+	return commandBuffer;
+}
+
+void Renderer::renderOverlays(FrameInfo& frameInfo, GlobalUbo& ubo, LightUbo& lightUbo)
+{
+	// order matters for transparency
+	if (renderMode == DEFAULT_LIT)
+	{
+		pointLightSystem.render(frameInfo, lightUbo);
+		spotLightSystem.render(frameInfo, lightUbo);
+	}
+
+	if(showGrid)
+		gridSystem.render(frameInfo, ubo);
+
+	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), frameInfo.commandBuffer);
+}
+
+void Renderer::renderMeshes(FrameInfo& frameInfo)
+{
+	switch (renderMode)
+	{
+	case DEFAULT_LIT:
+		renderSystem.render(frameInfo);
+		break;
+	case WIREFRAME:
+		wireframeSystem.render(frameInfo);
+		break;
+	case UNLIT:
+		unlitSystem.render(frameInfo);
+		break;
+	default:
+		break;
+	}
+}
+
 void Renderer::drawImGui(FrameInfo& frameInfo)
 {
+	// The editor changes the scene directly, so the simulation has to be between ticks
+	std::unique_lock<std::mutex> sceneLock = simulation.lockScene();
 	imguiSystem.drawImGui(frameInfo);
 }
 
+void Renderer::setThreadedSimulation(bool threaded)
+{
+	if (threaded)
+		simulation.start();
+	else
+		simulation.stop();
+}
+
 void Renderer::cleanup()
 {
 	cleanupTextures();
 	depthPass.cleanup(mDevice);
 
+	retiredPipelines.clear();
 	renderSystem.cleanup();
 	unlitSystem.cleanup();
 	wireframeSystem.cleanup();
+	cullingSystem.cleanup();
+	simulation.stop();
+	drawList.cleanup();
+	materialTable.cleanup();
+	secondaryCommandPools.cleanup();
 
 	freeCommandBuffers();
 	window->cleanupWindow();
@@ -24,8 +24,16 @@
 #include "Descriptors.h"
 #include "Enums.h"
 #include "Utils.h"
+#include "IndirectDrawList.h"
+#include "MaterialTable.h"
+#include "JobSystem.h"
+#include "SecondaryCommandPools.h"
+#include "PipelineBatch.h"
+#include "ShaderCompiler.h"
 
 #include "Scene/Scene.h"
+#include "Scene/TransformSystem.h"
+#include "Scene/SimulationThread.h"
 
 // Render Systems
 #include "RenderSystems/RenderSystem.h"
@@ -36,13 +44,22 @@
 #include "RenderSystems/WorldGridSystem.h"
 #include "RenderSystems/SpotLightSystem.h"
 #include "RenderSystems/ShadowSystem.h"
+#include "RenderSystems/CullingSystem.h"
+
+// Options the renderer starts with, all of them can be changed at runtime
+struct RendererSettings
+{
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+	bool uncappedBenchmark = false;
+	uint32_t framesInFlight = SwapChain::DEFAULT_FRAMES_IN_FLIGHT;
+};
 
 class Renderer
 {
 public:
 	static Renderer* rendererInstance;
 
-	static Renderer* initInstance(Window* window);
+	static Renderer* initInstance(Window* window, const RendererSettings& settings = RendererSettings());
 	static Renderer* getInstance(){ return rendererInstance; }
 	static void cleanupInstance();
 
@@ -58,17 +75,21 @@ public:
 	void createCommandBuffers();
 	void freeCommandBuffers();
 
+	// UBOs, global descriptor sets and command buffers, one per frame in flight. No frame may still be using them.
+	void createFrameResources();
+
 	Device& getDevice() { return mDevice; }
 
 	void recreateSwapChain();
 	RenderPass getSwapChainRenderPass() const { return mSwapChain->getRenderPass(); }
 
-	void loadMaterials(DescriptorSetLayout& layout);
 	void cleanupTextures();
 
 	bool hasStencilComponent(VkFormat format);
 
 	// Frame Drawing
+	// Paces the CPU against the GPU, call right before reading input for the next frame
+	void waitForNextFrame();
 	VkCommandBuffer beginFrame();
 	void drawFrame(float dt);
 	void endFrame();
@@ -86,6 +107,17 @@ public:
 
 	void drawImGui(FrameInfo& frameInfo);
 
+	// Draws the draw list's current phase with the mesh system for the render mode
+	void renderMeshes(FrameInfo& frameInfo);
+
+	// Records the swap chain pass inline on this thread
+	void recordSwapChainPass(FrameInfo& frameInfo, GlobalUbo& ubo, LightUbo& lightUbo);
+	// Splits the mesh draws into chunks recorded into secondary command buffers by the job system,
+	// then records lights, grid and ImGui into one more and executes them all in the swap chain pass
+	void recordSwapChainPassParallel(FrameInfo& frameInfo, GlobalUbo& ubo, LightUbo& lightUbo);
+	// Lights, grid and ImGui, drawn over the meshes
+	void renderOverlays(FrameInfo& frameInfo, GlobalUbo& ubo, LightUbo& lightUbo);
+
 	// Clean up application
 	void cleanup();
 
@@ -101,10 +133,39 @@ public:
 
 	void setRenderMode(RenderMode mode);
 
+	void setCullingMode(CullingMode mode);
+	CullingMode getCullingMode() const { return cullingMode; }
+
 	void setShowGrid(bool show) { showGrid = show; }
 	bool getShowGrid() { return showGrid; }
 
-	static void compileShaders();
+	void setParallelRecording(bool parallel) { parallelRecording = parallel; }
+	bool getParallelRecording() const { return parallelRecording; }
+
+	// Advances the scene on its own thread at a fixed timestep, drawing from its snapshots
+	void setThreadedSimulation(bool threaded);
+	bool getThreadedSimulation() const { return simulation.isRunning(); }
+
+	// Clamped to [1, SwapChain::MAX_FRAMES_IN_FLIGHT], applied before the next frame begins
+	void setFramesInFlight(uint32_t count);
+	uint32_t getFramesInFlight() const { return framesInFlight; }
+
+	// Waits for the GPU to finish every frame before reading input, trading throughput for latency
+	void setLowLatency(bool enabled) { lowLatency = enabled; }
+	bool getLowLatency() const { return lowLatency; }
+
+	// Falls back to FIFO when the surface lacks the mode, applied before the next frame begins
+	void setPresentMode(VkPresentModeKHR mode);
+	VkPresentModeKHR getPresentMode() const { return requestedPresentMode; }
+
+	// Presents without v-sync, whatever the present mode, and averages frame times while enabled
+	void setUncappedBenchmark(bool uncapped);
+	bool getUncappedBenchmark() const { return requestedUncappedBenchmark; }
+
+	// Compiles the shaders whose source changed since they were last built
+	void compileShaders();
+	// Compiles any changed shaders before the next frame and rebuilds the pipelines that use them
+	void reloadShaders() { shaderReloadRequested = true; }
 
 	static std::vector<char> readBinaryFile(const std::string& filename);
 
@@ -114,7 +175,20 @@ public:
 	std::vector<Texture> textures;
 
 private:
-	Renderer(Window* appWindow);
+	Renderer(Window* appWindow, const RendererSettings& settings);
+
+	// Begins a secondary command buffer that continues the swap chain pass, from the thread with this index
+	VkCommandBuffer beginSecondaryCommandBuffer(int frameIndex, uint32_t threadIndex);
+
+	// Rebuilds the swap chain, and the per-frame resources if needed, when frames in flight or presentation settings have changed
+	void applySwapChainSettings();
+
+	// Recompiles shaders that were saved or asked to be reloaded, then swaps in new pipelines for them.
+	// Nothing waits for the GPU, the replaced pipelines are destroyed once the frames using them finish.
+	void updateShaders();
+
+	// Fewer draw commands than this are not worth a chunk of their own
+	static constexpr uint32_t MIN_COMMANDS_PER_CHUNK = 256;
 
 	std::unique_ptr<Window> window;
 
@@ -128,15 +202,15 @@ private:
 	
 	Device mDevice{*window};
 	std::unique_ptr <SwapChain> mSwapChain;
+	IndirectDrawList drawList{mDevice};
+	MaterialTable materialTable{mDevice};
 
 	std::unique_ptr<DescriptorPool> globalDescriptorPool{};
 	std::unique_ptr<DescriptorPool> imguiDescriptorPool{};
+	DescriptorSetLayout* globalSetLayout = nullptr; // Owned by the device's layout cache
 	std::vector<VkDescriptorSet> globalDescriptorSets;
-	std::vector<VkDescriptorSet> materialDescriptorSets;
 	std::vector<std::unique_ptr<Buffer>> uboBuffers;
 	std::vector<std::unique_ptr<Buffer>> lightUboBuffers;
-	std::vector<std::unique_ptr<Buffer>> materialUboBuffers;
-	class GameObject::Map gameObjects;
 
 	DepthPass depthPass;
 
@@ -148,11 +222,32 @@ private:
 	WorldGridSystem gridSystem {mDevice};
 	SpotLightSystem spotLightSystem {mDevice};
 	ShadowSystem shadowSystem {mDevice};
+	CullingSystem cullingSystem {mDevice};
+	PipelineBatch pipelineBatch {mDevice}; // Every system's pipelines, kept to rebuild them when their shaders change
 
 	RenderMode renderMode = DEFAULT_LIT;
+	CullingMode cullingMode = CULLING_GPU;
 
 	bool showGrid = false;
 
+	JobSystem jobSystem;
+	SecondaryCommandPools secondaryCommandPools{mDevice};
+	std::vector<VkCommandBuffer> meshCommandBuffers; // One per chunk, phase major
+	bool parallelRecording = true;
+	uint32_t recordingThreadCount = 1;
+	float recordTime = 0.0f;
+
+	struct RetiredPipeline
+	{
+		uint64_t lastFrame; // Last frame submitted before it was replaced
+		std::unique_ptr<Pipeline> pipeline;
+	};
+
+	ShaderCompiler shaderCompiler;
+	ShaderWatcher shaderWatcher{shaderCompiler};
+	bool shaderReloadRequested = false;
+	std::vector<RetiredPipeline> retiredPipelines;
+
 	size_t currentFrame = 0;
 	bool framebufferResized = false;
 	bool canResizeWindow = false;
@@ -161,6 +256,17 @@ private:
 	int currentFrameIndex = 0;
 	bool frameStarted = false;
 
+	uint32_t framesInFlight = SwapChain::DEFAULT_FRAMES_IN_FLIGHT;
+	uint32_t requestedFramesInFlight = SwapChain::DEFAULT_FRAMES_IN_FLIGHT;
+	bool lowLatency = false;
+
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+	VkPresentModeKHR requestedPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+	bool uncappedBenchmark = false;
+	bool requestedUncappedBenchmark = false;
+	uint32_t benchmarkFrameCount = 0;
+	float benchmarkTime = 0.0f; // Seconds since the uncapped benchmark was enabled
+
 	VkClearColorValue clearColor = { {0.01f, 0.01f, 0.01f, 1.0f} };
 
 	VkImage textureImage;
@@ -173,10 +279,11 @@ private:
 	VkImageView depthImageView;
 
 	SceneData sceneData;
+	TransformSystem transformSystem;
+	SimulationThread simulation{sceneData.registry, transformSystem, jobSystem};
 
 	std::vector<Material> materials;
 	size_t minUboAlignment;
-	const uint32_t MAX_TEXTURE_BINDINGS = 3;
 	uint32_t totalObjects = 0;
 };
 
@@ -0,0 +1,52 @@
+#include "Components.h"
+
+void TransformComponent::updateLocalTransform()
+{
+	if (!dirty)
+		return;
+
+	glm::mat4 transate = glm::translate(glm::mat4{ 1.0f }, translation);
+
+	glm::quat qPitch = glm::angleAxis(glm::radians(rotation.x), glm::vec3(1, 0, 0));
+	glm::quat qYaw = glm::angleAxis(glm::radians(rotation.z), glm::vec3(0, 0, 1));
+	glm::quat qRoll = glm::angleAxis(glm::radians(rotation.y), glm::vec3(0, 1, 0));
+
+	orientation = qPitch * qYaw * qRoll;
+	glm::mat4 rotate = glm::mat4_cast(orientation);
+
+	glm::quat invOrient = glm::conjugate(orientation);
+	forward = invOrient * glm::vec3(0.0f, 0.0f, 1.0f);
+	up = invOrient * glm::vec3(0.0f, 1.0f, 0.0f);
+	right = glm::normalize(glm::cross(forward, up));
+
+	glm::mat4 scaleMat = glm::scale(transate, scale);
+
+	localMatrix = scaleMat * transate * rotate;
+	dirty = false;
+}
+
+void TransformComponent::updateWorldTransform(const TransformComponent* parent)
+{
+	if (parent)
+	{
+		worldMatrix = parent->worldMatrix * localMatrix;
+		worldPosition = glm::vec3(parent->worldMatrix * glm::vec4(translation, 1.0f));
+		worldOrientation = parent->worldOrientation * orientation;
+	}
+	else
+	{
+		worldMatrix = localMatrix;
+		worldPosition = translation;
+		worldOrientation = orientation;
+	}
+
+	// The matrix is affine, so inverting the upper 3x3 is enough
+	normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(worldMatrix))));
+}
+
+void TransformComponent::setLocalMatrixTranslation(const glm::vec3& matrixTranslation)
+{
+	// The local matrix applies the translation both before and after scaling
+	translation = matrixTranslation / (glm::vec3(1.0f) + scale);
+	markDirty();
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "../Model.h"
+#include "../Material.h"
+#include "../Enums.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+#include <glm/gtc/quaternion.hpp>
+
+#include <memory>
+#include <string>
+
+using Entity = uint32_t;
+constexpr Entity NULL_ENTITY = 0xFFFFFFFF;
+
+struct TagComponent
+{
+	std::string name = "Empty";
+};
+
+/*
+ * Translation, rotation and scale are edited directly and are relative to the parent, if there is one.
+ * Whoever changes them calls markDirty(); the cached local and world data is rebuilt by the
+ * TransformSystem once per frame, along with every descendant.
+ */
+struct TransformComponent
+{
+	glm::vec3 translation{0.0f, 0.0f, 0.0f};
+	glm::vec3 scale{1.0f, 1.0f, 1.0f};
+	glm::vec3 rotation{0.0f, 0.0f, 0.0f};
+
+	glm::vec3 forward;
+	glm::vec3 up;
+	glm::vec3 right;
+
+	glm::quat orientation;
+
+	const glm::mat4& getLocalTransform() const { return localMatrix; }
+	const glm::mat4& getTransform() const { return worldMatrix; }
+	const glm::mat4& getNormalMatrix() const { return normalMatrix; }
+
+	// Translation and orientation with the parents applied, what lights are placed with
+	const glm::vec3& getWorldPosition() const { return worldPosition; }
+	const glm::quat& getWorldOrientation() const { return worldOrientation; }
+
+	bool isDirty() const { return dirty; }
+	void markDirty() { dirty = true; }
+
+	// Moves the object so its local matrix ends up with the given translation
+	void setLocalMatrixTranslation(const glm::vec3& matrixTranslation);
+
+	// Rebuilds the local matrix and basis vectors if they are dirty
+	void updateLocalTransform();
+	// Parent is null for root objects and must already be up to date
+	void updateWorldTransform(const TransformComponent* parent);
+
+private:
+	glm::mat4 localMatrix{1.0f};
+	glm::mat4 worldMatrix{1.0f};
+	glm::mat4 normalMatrix{1.0f};
+	glm::vec3 worldPosition{0.0f};
+	glm::quat worldOrientation{1.0f, 0.0f, 0.0f, 0.0f};
+	bool dirty = true;
+};
+
+// Only present on entities that have a parent
+struct ParentComponent
+{
+	Entity parent = NULL_ENTITY;
+};
+
+struct MeshComponent
+{
+	std::shared_ptr<Model> model;
+};
+
+struct MaterialComponent
+{
+	std::shared_ptr<Material> material;
+	std::string materialFileName = "";
+};
+
+struct LightComponent
+{
+	LightType lightType;
+	glm::vec3 color;
+};
+
+struct DirectionalLightComponent : LightComponent
+{
+	glm::vec3 direction; 
+	float intensity = 1.0f;
+};
+
+struct PointLightComponent : LightComponent
+{
+	float intensity = 1.0f;
+};
+
+struct SpotLightComponent : PointLightComponent
+{
+	float cutoffAngle = 15.0f;
+	float outerCutoffAngle;
+};
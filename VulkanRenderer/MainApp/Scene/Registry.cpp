@@ -0,0 +1,83 @@
+#include "Registry.h"
+
+Entity Registry::create(const std::string& name)
+{
+	Entity entity;
+	if (!freeEntities.empty())
+	{
+		entity = freeEntities.back();
+		freeEntities.pop_back();
+	}
+	else
+	{
+		entity = nextEntity++;
+	}
+
+	entities.insert(entity);
+	emplace<TagComponent>(entity, name);
+	emplace<TransformComponent>(entity);
+	hierarchyVersion++;
+	return entity;
+}
+
+void Registry::destroy(Entity entity)
+{
+	if (!valid(entity))
+		return;
+
+	// Children become roots, collected first since detaching them reorders the parent pool
+	std::vector<Entity> children;
+	each<ParentComponent>([entity, &children](Entity child, ParentComponent& parent)
+	{
+		if (parent.parent == entity)
+			children.push_back(child);
+	});
+	for (Entity child : children)
+	{
+		setParent(child, NULL_ENTITY);
+	}
+
+	std::apply([entity](auto&... componentPools) { (componentPools.remove(entity), ...); }, pools);
+
+	entities.erase(entity);
+	freeEntities.push_back(entity);
+	hierarchyVersion++;
+}
+
+bool Registry::setParent(Entity entity, Entity parent)
+{
+	if (!valid(entity) || (parent != NULL_ENTITY && !valid(parent)))
+		return false;
+
+	for (Entity ancestor = parent; ancestor != NULL_ENTITY; ancestor = getParent(ancestor))
+	{
+		if (ancestor == entity)
+			return false;
+	}
+
+	if (parent == NULL_ENTITY)
+		remove<ParentComponent>(entity);
+	else
+		emplace<ParentComponent>(entity, parent);
+
+	// Local values are kept, so the world transform moves with the new parent
+	get<TransformComponent>(entity).markDirty();
+	hierarchyVersion++;
+	return true;
+}
+
+Entity Registry::getParent(Entity entity)
+{
+	ParentComponent* parent = tryGet<ParentComponent>(entity);
+	return parent ? parent->parent : NULL_ENTITY;
+}
+
+void Registry::clear()
+{
+	std::apply([](auto&... componentPools) { (componentPools.clear(), ...); }, pools);
+
+	entities.clear();
+	freeEntities.clear();
+	nextEntity = 0;
+	hierarchyVersion++;
+}
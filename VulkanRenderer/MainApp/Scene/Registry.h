@@ -0,0 +1,215 @@
+#pragma once
+
+#include "Components.h"
+
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <string>
+
+/*
+ * Set of entity IDs stored twice: a dense array that can be walked without holes, and a sparse array
+ * indexed by entity that holds each entity's position in the dense one. Lookups are two array reads.
+ * Removal moves the last entity into the gap, so the dense order is not stable.
+ */
+class SparseSet
+{
+public:
+	bool contains(Entity entity) const { return entity < sparse.size() && sparse[entity] != INVALID_INDEX; }
+	uint32_t indexOf(Entity entity) const { return sparse[entity]; }
+
+	uint32_t size() const { return static_cast<uint32_t>(dense.size()); }
+	bool empty() const { return dense.empty(); }
+	const std::vector<Entity>& getEntities() const { return dense; }
+
+	// Returns the dense index the entity was placed at
+	uint32_t insert(Entity entity)
+	{
+		if (entity >= sparse.size())
+			sparse.resize(entity + 1, INVALID_INDEX);
+
+		sparse[entity] = static_cast<uint32_t>(dense.size());
+		dense.push_back(entity);
+		return sparse[entity];
+	}
+
+	// Returns the dense index that was freed, the last entity has been moved into it
+	uint32_t erase(Entity entity)
+	{
+		uint32_t index = sparse[entity];
+		Entity last = dense.back();
+		dense[index] = last;
+		sparse[last] = index;
+		dense.pop_back();
+		sparse[entity] = INVALID_INDEX;
+		return index;
+	}
+
+	void clear()
+	{
+		dense.clear();
+		sparse.clear();
+	}
+
+	static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+private:
+	std::vector<Entity> dense;
+	std::vector<uint32_t> sparse;
+};
+
+/*
+ * Components of one type, packed in the same order as the entities of their sparse set.
+ */
+template<typename T>
+class ComponentPool
+{
+public:
+	template<typename... Args>
+	T& emplace(Entity entity, Args&&... args)
+	{
+		if (set.contains(entity))
+		{
+			T& component = components[set.indexOf(entity)];
+			component = T{ std::forward<Args>(args)... };
+			return component;
+		}
+
+		set.insert(entity);
+		components.push_back(T{ std::forward<Args>(args)... });
+		return components.back();
+	}
+
+	void remove(Entity entity)
+	{
+		if (!set.contains(entity))
+			return;
+
+		uint32_t index = set.erase(entity);
+		if (index != components.size() - 1)
+			components[index] = std::move(components.back());
+		components.pop_back();
+	}
+
+	bool contains(Entity entity) const { return set.contains(entity); }
+	T& get(Entity entity) { return components[set.indexOf(entity)]; }
+	T* tryGet(Entity entity) { return set.contains(entity) ? &components[set.indexOf(entity)] : nullptr; }
+
+	uint32_t size() const { return set.size(); }
+	const std::vector<Entity>& getEntities() const { return set.getEntities(); }
+	const SparseSet& getSet() const { return set; }
+	T* data() { return components.data(); }
+
+	void clear()
+	{
+		set.clear();
+		components.clear();
+	}
+
+private:
+	SparseSet set;
+	std::vector<T> components;
+};
+
+/*
+ * Owns every entity of a scene and one ComponentPool per component type. Systems walk only the pools
+ * they need through each(), which iterates the smallest of them and looks the entity up in the rest,
+ * instead of visiting every object and testing which components it has.
+ * Adding or removing components of the iterated types from inside each() is not allowed.
+ * Parent links are ParentComponents, changed through setParent() so cycles are rejected.
+ */
+class Registry
+{
+public:
+	Registry() = default;
+
+	Registry(const Registry&) = delete;
+	Registry& operator=(const Registry&) = delete;
+
+	// Every entity is created with a tag and a transform
+	Entity create(const std::string& name = "Empty");
+	void destroy(Entity entity);
+	void clear();
+
+	bool valid(Entity entity) const { return entities.contains(entity); }
+	uint32_t size() const { return entities.size(); }
+	bool empty() const { return entities.empty(); }
+
+	// Live entities, in no particular order
+	const std::vector<Entity>& getEntities() const { return entities.getEntities(); }
+
+	// Fails if the parent is the entity itself or one of its descendants. NULL_ENTITY detaches it.
+	bool setParent(Entity entity, Entity parent);
+	Entity getParent(Entity entity);
+
+	// Changes whenever entities are created or destroyed or a parent changes
+	uint32_t getHierarchyVersion() const { return hierarchyVersion; }
+
+	template<typename T, typename... Args>
+	T& emplace(Entity entity, Args&&... args) { return pool<T>().emplace(entity, std::forward<Args>(args)...); }
+
+	template<typename T>
+	void remove(Entity entity) { pool<T>().remove(entity); }
+
+	template<typename T>
+	bool has(Entity entity) const { return std::get<ComponentPool<T>>(pools).contains(entity); }
+
+	template<typename T>
+	T& get(Entity entity) { return pool<T>().get(entity); }
+
+	template<typename T>
+	T* tryGet(Entity entity) { return pool<T>().tryGet(entity); }
+
+	template<typename T>
+	ComponentPool<T>& pool() { return std::get<ComponentPool<T>>(pools); }
+
+	// Calls func(entity, components&...) for every entity that has all of the given components
+	template<typename... Ts, typename Func>
+	void each(Func func)
+	{
+		if constexpr (sizeof...(Ts) == 1)
+		{
+			// A single pool is already packed, walk it directly
+			auto& components = pool<Ts...>();
+			const std::vector<Entity>& owners = components.getEntities();
+			for (uint32_t i = 0; i < static_cast<uint32_t>(owners.size()); i++)
+			{
+				func(owners[i], components.data()[i]);
+			}
+		}
+		else
+		{
+			const SparseSet* sets[] = { &pool<Ts>().getSet()... };
+			const SparseSet* smallest = sets[0];
+			for (const SparseSet* set : sets)
+			{
+				if (set->size() < smallest->size())
+					smallest = set;
+			}
+
+			const std::vector<Entity>& candidates = smallest->getEntities();
+			for (uint32_t i = 0; i < static_cast<uint32_t>(candidates.size()); i++)
+			{
+				Entity entity = candidates[i];
+				if ((pool<Ts>().contains(entity) && ...))
+					func(entity, pool<Ts>().get(entity)...);
+			}
+		}
+	}
+
+private:
+	SparseSet entities;
+	std::vector<Entity> freeEntities; // Destroyed IDs, reused before new ones are handed out
+	Entity nextEntity = 0;
+	uint32_t hierarchyVersion = 0;
+
+	std::tuple<
+		ComponentPool<TagComponent>,
+		ComponentPool<TransformComponent>,
+		ComponentPool<ParentComponent>,
+		ComponentPool<MeshComponent>,
+		ComponentPool<MaterialComponent>,
+		ComponentPool<PointLightComponent>,
+		ComponentPool<SpotLightComponent>,
+		ComponentPool<DirectionalLightComponent>> pools;
+};
@@ -0,0 +1,20 @@
+#include "RenderSnapshot.h"
+#include "../RenderSystems/PointLightSystem.h"
+#include "../RenderSystems/SpotLightSystem.h"
+
+void RenderSnapshot::capture(Registry& registry, uint64_t tick)
+{
+	this->tick = tick;
+
+	objects.clear();
+	registry.each<MeshComponent, MaterialComponent, TransformComponent>([this](Entity entity, MeshComponent& mesh, MaterialComponent& materialComp,
+		TransformComponent& transform)
+	{
+		if (mesh.model && materialComp.material)
+			objects.push_back({ mesh.model, materialComp.material, transform.getTransform(), transform.getNormalMatrix() });
+	});
+
+	lights = LightUbo{};
+	PointLightSystem::update(registry, lights);
+	SpotLightSystem::update(registry, lights);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Registry.h"
+#include "../FrameInfo.h"
+
+#include <vector>
+#include <memory>
+
+// A drawable object as the simulation left it
+struct RenderObject
+{
+	std::shared_ptr<Model> model;
+	std::shared_ptr<Material> material;
+	glm::mat4 modelMatrix{ 1.0f };
+	glm::mat4 normalMatrix{ 1.0f };
+};
+
+/*
+ * Everything the renderer reads from the scene, copied once the simulation has finished a tick, so
+ * the render thread never reads the registry while the simulation is changing it. Models and
+ * materials are shared rather than copied: the simulation never changes them, and holding them
+ * keeps objects that were deleted in the meantime alive until the snapshot is replaced.
+ */
+struct RenderSnapshot
+{
+	std::vector<RenderObject> objects;
+	LightUbo lights{};
+	uint64_t tick = 0; // Simulation tick the snapshot was taken after
+
+	// Transforms have to be up to date
+	void capture(Registry& registry, uint64_t tick);
+};
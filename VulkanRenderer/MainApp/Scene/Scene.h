@@ -1,12 +1,12 @@
 #pragma once
 
-#include "../GameObject.h"
+#include "Registry.h"
 
 #include <unordered_map>
 
 struct SceneData
 {
-	GameObject::Map objects;
+	Registry registry;
 	uint32_t objectCount = 0;
 	uint32_t materialCount = 0;
 	std::string sceneName;
@@ -0,0 +1,98 @@
+#include "SimulationThread.h"
+#include "../RenderSystems/PointLightSystem.h"
+
+#include <algorithm>
+#include <chrono>
+
+SimulationThread::SimulationThread(Registry& registry, TransformSystem& transformSystem, JobSystem& jobSystem)
+	: registry{registry}, transformSystem{transformSystem}, jobSystem{jobSystem}
+{
+}
+
+SimulationThread::~SimulationThread()
+{
+	stop();
+}
+
+void SimulationThread::start()
+{
+	if (isRunning())
+		return;
+
+	// The render thread needs a snapshot before the first tick has run
+	transformSystem.update(registry, &jobSystem);
+	snapshots[writeIndex].capture(registry, tickCount);
+	publish();
+
+	stopping = false;
+	thread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop()
+{
+	if (!isRunning())
+		return;
+
+	stopping = true;
+	thread.join();
+}
+
+const RenderSnapshot& SimulationThread::acquireSnapshot()
+{
+	std::lock_guard<std::mutex> lock(snapshotMutex);
+	if (snapshotReady)
+	{
+		std::swap(readIndex, readyIndex);
+		snapshotReady = false;
+	}
+	return snapshots[readIndex];
+}
+
+void SimulationThread::run()
+{
+	using Clock = std::chrono::steady_clock;
+	const Clock::duration timestep = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(TIMESTEP));
+
+	Clock::time_point nextTick = Clock::now();
+	while (!stopping)
+	{
+		uint32_t ticks = 0;
+		for (Clock::time_point now = Clock::now(); nextTick <= now && ticks < MAX_TICKS_PER_UPDATE; nextTick += timestep)
+		{
+			tick();
+			ticks++;
+		}
+
+		if (ticks == MAX_TICKS_PER_UPDATE)
+			nextTick = std::max(nextTick, Clock::now());
+
+		if (ticks > 0)
+		{
+			{
+				std::lock_guard<std::mutex> lock(sceneMutex);
+				transformSystem.update(registry, &jobSystem);
+				snapshots[writeIndex].capture(registry, tickCount);
+			}
+			publish();
+		}
+
+		std::this_thread::sleep_until(nextTick);
+	}
+
+	// The transform update may have given this thread an external index, the next thread needs it back
+	jobSystem.releaseThreadIndex();
+}
+
+void SimulationThread::tick()
+{
+	std::lock_guard<std::mutex> lock(sceneMutex);
+	PointLightSystem::simulate(registry, TIMESTEP);
+	tickCount++;
+}
+
+void SimulationThread::publish()
+{
+	std::lock_guard<std::mutex> lock(snapshotMutex);
+	std::swap(writeIndex, readyIndex);
+	snapshotReady = true;
+}
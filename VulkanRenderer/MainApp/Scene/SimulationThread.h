@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Registry.h"
+#include "RenderSnapshot.h"
+#include "TransformSystem.h"
+#include "../JobSystem.h"
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+/*
+ * Advances the scene at a fixed timestep on its own thread, so a slow frame no longer holds up the
+ * simulation. After each batch of ticks it publishes a RenderSnapshot for the render thread.
+ * Snapshots are triple buffered: the simulation fills one while the render thread reads another,
+ * and the third holds the newest finished one, so neither thread ever waits on the other.
+ * While it runs, anything else that changes the scene, such as the editor, has to hold lockScene().
+ */
+class SimulationThread
+{
+public:
+	SimulationThread(Registry& registry, TransformSystem& transformSystem, JobSystem& jobSystem);
+	~SimulationThread();
+
+	SimulationThread(const SimulationThread&) = delete;
+	SimulationThread& operator=(const SimulationThread&) = delete;
+
+	void start();
+	void stop();
+	bool isRunning() const { return thread.joinable(); }
+
+	// Newest published snapshot, valid until the next call. Only the render thread may call it.
+	const RenderSnapshot& acquireSnapshot();
+
+	std::unique_lock<std::mutex> lockScene() { return std::unique_lock<std::mutex>(sceneMutex); }
+
+	uint64_t getTickCount() const { return tickCount; }
+
+	static constexpr float TIMESTEP = 1.0f / 60.0f;
+	// Further ticks owed after a stall are dropped instead of making the next batch even longer
+	static constexpr uint32_t MAX_TICKS_PER_UPDATE = 5;
+
+private:
+	void run();
+	void tick();
+	void publish();
+
+	Registry& registry;
+	TransformSystem& transformSystem;
+	JobSystem& jobSystem;
+
+	std::thread thread;
+	std::atomic<bool> stopping{false};
+	std::atomic<uint64_t> tickCount{0};
+
+	// Held by the simulation while it changes the scene
+	std::mutex sceneMutex;
+
+	RenderSnapshot snapshots[3];
+	std::mutex snapshotMutex; // Guards the indices below, never held while a snapshot is filled or read
+	uint32_t writeIndex = 0;
+	uint32_t readyIndex = 1;
+	uint32_t readIndex = 2;
+	bool snapshotReady = false;
+};
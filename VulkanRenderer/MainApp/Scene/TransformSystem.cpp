@@ -0,0 +1,119 @@
+#include "TransformSystem.h"
+
+#include <algorithm>
+
+void TransformSystem::update(Registry& registry, JobSystem* jobSystem)
+{
+	if (sortedVersion != registry.getHierarchyVersion())
+		sortHierarchy(registry);
+
+	updated.assign(transforms.size(), 0);
+	updatedCount = 0;
+
+	for (size_t level = 0; level + 1 < levelOffsets.size(); level++)
+	{
+		uint32_t levelStart = levelOffsets[level];
+		uint32_t levelSize = levelOffsets[level + 1] - levelStart;
+		if (!jobSystem || levelSize <= BATCH_SIZE)
+		{
+			updatedCount += updateRange(levelStart, levelStart + levelSize);
+			continue;
+		}
+
+		// Parents all live in earlier levels, which are finished, so the batches are independent
+		std::atomic<uint32_t> levelUpdatedCount{0};
+		jobSystem->parallelFor(levelSize, BATCH_SIZE, [this, levelStart, &levelUpdatedCount](uint32_t begin, uint32_t end, uint32_t)
+		{
+			levelUpdatedCount += updateRange(levelStart + begin, levelStart + end);
+		});
+		updatedCount += levelUpdatedCount;
+	}
+}
+
+uint32_t TransformSystem::updateRange(uint32_t begin, uint32_t end)
+{
+	uint32_t count = 0;
+	for (uint32_t i = begin; i < end; i++)
+	{
+		TransformComponent& transform = *transforms[i];
+		uint32_t parentSlot = parentSlots[i];
+		bool parentUpdated = parentSlot != NO_PARENT && updated[parentSlot];
+		if (!transform.isDirty() && !parentUpdated)
+			continue;
+
+		transform.updateLocalTransform();
+		transform.updateWorldTransform(parentSlot != NO_PARENT ? transforms[parentSlot] : nullptr);
+		updated[i] = 1;
+		count++;
+	}
+	return count;
+}
+
+void TransformSystem::sortHierarchy(Registry& registry)
+{
+	const std::vector<Entity>& entities = registry.getEntities();
+	Entity entityRange = 0;
+	for (Entity entity : entities)
+	{
+		entityRange = std::max(entityRange, entity + 1);
+	}
+
+	// Children of each entity as one flat list, childOffsets[e] to childOffsets[e + 1]
+	childOffsets.assign(entityRange + 1, 0);
+	registry.each<ParentComponent>([this](Entity entity, ParentComponent& parent)
+	{
+		childOffsets[parent.parent + 1]++;
+	});
+	for (Entity entity = 0; entity < entityRange; entity++)
+	{
+		childOffsets[entity + 1] += childOffsets[entity];
+	}
+
+	children.resize(childOffsets[entityRange]);
+	entitySlots.assign(childOffsets.begin(), childOffsets.end() - 1); // Used as insertion cursors first
+	registry.each<ParentComponent>([this](Entity entity, ParentComponent& parent)
+	{
+		children[entitySlots[parent.parent]++] = entity;
+	});
+
+	order.clear();
+	levelOffsets.clear();
+	for (Entity entity : entities)
+	{
+		if (!registry.has<ParentComponent>(entity))
+			order.push_back(entity);
+	}
+
+	size_t levelStart = 0;
+	while (levelStart < order.size())
+	{
+		levelOffsets.push_back(static_cast<uint32_t>(levelStart));
+		size_t levelEnd = order.size();
+		for (size_t i = levelStart; i < levelEnd; i++)
+		{
+			Entity entity = order[i];
+			order.insert(order.end(), children.begin() + childOffsets[entity], children.begin() + childOffsets[entity + 1]);
+		}
+		levelStart = levelEnd;
+	}
+	levelOffsets.push_back(static_cast<uint32_t>(order.size()));
+
+	entitySlots.assign(entityRange, NO_PARENT);
+	transforms.resize(order.size());
+	parentSlots.resize(order.size());
+	for (uint32_t i = 0; i < static_cast<uint32_t>(order.size()); i++)
+	{
+		Entity entity = order[i];
+		entitySlots[entity] = i;
+		transforms[i] = &registry.get<TransformComponent>(entity);
+
+		// Parents come first, so their slot is already known
+		Entity parent = registry.getParent(entity);
+		parentSlots[i] = parent != NULL_ENTITY ? entitySlots[parent] : NO_PARENT;
+
+		// Everything is recomputed once in its new place
+		transforms[i]->markDirty();
+	}
+
+	sortedVersion = registry.getHierarchyVersion();
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Registry.h"
+#include "../JobSystem.h"
+
+#include <vector>
+
+/*
+ * Keeps every transform's cached world data up to date, once per frame. Transforms are laid out
+ * breadth-first: roots first, then their children, level by level, so a parent is always finished
+ * before any of its children and the transforms within a level do not depend on each other. The
+ * order is only rebuilt when the registry's hierarchy version changes. A transform is recomputed
+ * when it is dirty or its parent was recomputed this frame, so unchanged subtrees are skipped.
+ * Large levels are split into batches across the job system, one level after another.
+ */
+class TransformSystem
+{
+public:
+	void update(Registry& registry, JobSystem* jobSystem = nullptr);
+
+	// Transforms recomputed by the last update, out of getTransformCount()
+	uint32_t getUpdatedCount() const { return updatedCount; }
+	uint32_t getTransformCount() const { return static_cast<uint32_t>(transforms.size()); }
+	uint32_t getLevelCount() const { return levelOffsets.empty() ? 0 : static_cast<uint32_t>(levelOffsets.size() - 1); }
+
+private:
+	void sortHierarchy(Registry& registry);
+	// Returns how many of the slots were recomputed
+	uint32_t updateRange(uint32_t begin, uint32_t end);
+
+	static constexpr uint32_t NO_PARENT = 0xFFFFFFFF;
+	// Levels smaller than this are cheaper to update than to hand out
+	static constexpr uint32_t BATCH_SIZE = 512;
+
+	// Breadth-first order, levelOffsets[n] is where level n starts, with one extra entry for the end
+	std::vector<TransformComponent*> transforms;
+	std::vector<uint32_t> parentSlots; // Position of each transform's parent in the same order
+	std::vector<uint32_t> levelOffsets;
+	std::vector<uint8_t> updated; // Whether each slot was recomputed this frame
+
+	// Reused while sorting to avoid reallocating
+	std::vector<uint32_t> childOffsets;
+	std::vector<Entity> children;
+	std::vector<Entity> order;
+	std::vector<uint32_t> entitySlots;
+
+	uint32_t sortedVersion = 0xFFFFFFFF;
+	uint32_t updatedCount = 0;
+};
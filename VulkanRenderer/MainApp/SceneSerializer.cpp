@@ -4,6 +4,7 @@
 #include "Device.h"
 #include "Utils.h"
 #include "Utils/YamlHelpers.h"
+#include "JobSystem.h"
 
 #include <fstream>
 #include <sstream>
@@ -49,75 +50,88 @@ LightType getLightType(const std::string& typeStr)
 		return Directional;
 }
 
-static void serializeObject(YAML::Emitter& out, GameObject& obj)
+static void serializeObject(YAML::Emitter& out, Registry& registry, Entity entity)
 {
+	TransformComponent& transform = registry.get<TransformComponent>(entity);
+	MeshComponent* mesh = registry.tryGet<MeshComponent>(entity);
+	MaterialComponent* materialComp = registry.tryGet<MaterialComponent>(entity);
+	PointLightComponent* pointLight = registry.tryGet<PointLightComponent>(entity);
+	SpotLightComponent* spotLight = registry.tryGet<SpotLightComponent>(entity);
+	DirectionalLightComponent* directionalLight = registry.tryGet<DirectionalLightComponent>(entity);
+
 	out << YAML::BeginMap; // Object
-	out << YAML::Key << "Object" << YAML::Value << obj.getID(); //TODO: use object ID
+	out << YAML::Key << "Object" << YAML::Value << entity; //TODO: use object ID
+
+	Entity parent = registry.getParent(entity);
+	if(parent != NULL_ENTITY)
+	{
+		out << YAML::Key << "Parent" << YAML::Value << parent;
+	}
 
 	out << YAML::Key << "Tag";
 	out << YAML::BeginMap; // Name
-	out << YAML::Key << "Name" << YAML::Value << obj.getObjectName();
+	out << YAML::Key << "Name" << YAML::Value << registry.get<TagComponent>(entity).name;
 	out << YAML::EndMap; // Name
 
 	out << YAML::Key << "Transform";
-	glm::vec3& translation = obj.transform.translation;
-	glm::vec3& rotation = obj.transform.rotation;
-	glm::vec3& scale = obj.transform.scale;
+	glm::vec3& translation = transform.translation;
+	glm::vec3& rotation = transform.rotation;
+	glm::vec3& scale = transform.scale;
 	out << YAML::BeginMap; // Transform
 	out << YAML::Key << "Translation" << YAML::Value << translation;
 	out << YAML::Key << "Rotation" << YAML::Value << rotation;
 	out << YAML::Key << "Scale" << YAML::Value << scale;
 	out << YAML::EndMap; // Transform
 
-	if(obj.model)
+	if(mesh && mesh->model)
 	{
 		out << YAML::Key << "Model";
 		out << YAML::BeginMap;
-		out << YAML::Key << "ModelPath" << YAML::Value << obj.model->getModelPath();
+		out << YAML::Key << "ModelPath" << YAML::Value << mesh->model->getModelPath();
 		out << YAML::EndMap;
 	}
 
-	if(obj.materialComp)
+	if(materialComp)
 	{
 		out << YAML::Key << "Material";
 		out << YAML::BeginMap;
-		out << YAML::Key << "MaterialFile" << YAML::Value << obj.materialComp->materialFileName;
+		out << YAML::Key << "MaterialFile" << YAML::Value << materialComp->materialFileName;
 		out << YAML::EndMap;
 	}
 
-	if(obj.pointLight)
+	if(pointLight)
 	{
 		out << YAML::Key << "PointLightComponent";
 		out << YAML::BeginMap;
-		out << YAML::Key << "LightType" << YAML::Value << obj.pointLight->lightType;
-		out << YAML::Key << "Intensity" << YAML::Value << obj.pointLight->intensity;
-		glm::vec3 color = obj.pointLight->color;
+		out << YAML::Key << "LightType" << YAML::Value << pointLight->lightType;
+		out << YAML::Key << "Intensity" << YAML::Value << pointLight->intensity;
+		glm::vec3 color = pointLight->color;
 		out << YAML::Key << "Color" << YAML::Value << color;
 		out << YAML::EndMap;
 	}
 
-	if (obj.spotLight)
+	if (spotLight)
 	{
 		out << YAML::Key << "SpotLightComponent";
 		out << YAML::BeginMap;
-		out << YAML::Key << "LightType" << YAML::Value << obj.spotLight->lightType;
-		out << YAML::Key << "Intensity" << YAML::Value << obj.spotLight->intensity;
-		glm::vec3 color = obj.spotLight->color;
+		out << YAML::Key << "LightType" << YAML::Value << spotLight->lightType;
+		out << YAML::Key << "Intensity" << YAML::Value << spotLight->intensity;
+		glm::vec3 color = spotLight->color;
 		out << YAML::Key << "Color" << YAML::Value << color;
-		out << YAML::Key << "CutoffAngle" << YAML::Value << obj.spotLight->outerCutoffAngle;
-		out << YAML::Key << "OuterCutoffAngle" << YAML::Value << obj.spotLight->cutoffAngle;
+		out << YAML::Key << "CutoffAngle" << YAML::Value << spotLight->outerCutoffAngle;
+		out << YAML::Key << "OuterCutoffAngle" << YAML::Value << spotLight->cutoffAngle;
 		out << YAML::EndMap;
 	}
 
-	if(obj.directionalLight)
+	if(directionalLight)
 	{
 		out << YAML::Key << "DirectionalLightComponent";
 		out << YAML::BeginMap;
-		out << YAML::Key << "LightType" << YAML::Value << obj.directionalLight->lightType;
-		out << YAML::Key << "Intensity" << YAML::Value << obj.directionalLight->intensity;
-		glm::vec3 color = obj.directionalLight->color;
+		out << YAML::Key << "LightType" << YAML::Value << directionalLight->lightType;
+		out << YAML::Key << "Intensity" << YAML::Value << directionalLight->intensity;
+		glm::vec3 color = directionalLight->color;
 		out << YAML::Key << "Color" << YAML::Value << color;
-		glm::vec3& direction = obj.directionalLight->direction;
+		glm::vec3& direction = directionalLight->direction;
 		out << YAML::Key << "Direction" << YAML::Value << direction;
 		out << YAML::EndMap;
 	}
@@ -125,26 +139,18 @@ static void serializeObject(YAML::Emitter& out, GameObject& obj)
 	out << YAML::EndMap; // Object
 }
 
-void SceneSerializer::serialize(const std::string& filepath, GameObject::Map& gameObjects)
+void SceneSerializer::serialize(const std::string& filepath, Registry& registry)
 {
 	YAML::Emitter out;
 	out << YAML::BeginMap;
 	out << YAML::Key << "Scene" << YAML::Value << "Untitled";
-	out << YAML::Key << "TotalObjectCount" << YAML::Value << gameObjects.size();
-	int count = 0;
-	for (auto& pair : gameObjects)
-	{
-		if (pair.second.materialComp)
-		{
-			count++;
-		}
-	}
-	out << YAML::Key << "TotalMaterialCount" << YAML::Value << count;
+	out << YAML::Key << "TotalObjectCount" << YAML::Value << registry.size();
+	out << YAML::Key << "TotalMaterialCount" << YAML::Value << registry.pool<MaterialComponent>().size();
 	out << YAML::Key << "Objects" << YAML::Value << YAML::BeginSeq;
 
-	for(auto& pair : gameObjects)
+	for(Entity entity : registry.getEntities())
 	{
-		serializeObject(out, pair.second);
+		serializeObject(out, registry, entity);
 	}
 
 	out << YAML::EndSeq;
@@ -154,7 +160,7 @@ void SceneSerializer::serialize(const std::string& filepath, GameObject::Map& ga
 	fout << out.c_str();
 }
 
-bool SceneSerializer::deserialize(const std::string& filepath, Device& device, SceneData& outSceneData)
+bool SceneSerializer::deserialize(const std::string& filepath, Device& device, SceneData& outSceneData, JobSystem* jobSystem)
 {
 	std::ifstream inFile(filepath);
 	std::stringstream ss;
@@ -176,30 +182,42 @@ bool SceneSerializer::deserialize(const std::string& filepath, Device& device, S
 	uint32_t materialCount = data["TotalMaterialCount"].as<uint32_t>();
 	outSceneData.materialCount = materialCount;
 
+	Registry& registry = outSceneData.registry;
 	auto objects = data["Objects"];
 	if(objects)
 	{
+		// Parents may come later in the file, so links are resolved once every object exists
+		std::unordered_map<int, Entity> fileEntities;
+		std::vector<std::pair<Entity, int>> parentLinks;
+
 		for (auto object : objects)
 		{
-			GameObject deserializedObj = GameObject::createGameObject();
+			Entity entity = registry.create();
 
 			int uuid = object["Object"].as<int>(); // TODO: Use uuid
+			fileEntities[uuid] = entity;
+
+			if(object["Parent"])
+			{
+				parentLinks.push_back({ entity, object["Parent"].as<int>() });
+			}
 			
 			std::string name;
 			auto tagComponent = object["Tag"];
 			if(tagComponent)
 			{
 				name = tagComponent["Name"].as<std::string>();
-				deserializedObj.setObjectName(name);
+				registry.get<TagComponent>(entity).name = name;
 			}
 
 			auto transformComponent = object["Transform"];
 			if(transformComponent)
 			{
-				TransformComponent& tc = deserializedObj.transform;
+				TransformComponent& tc = registry.get<TransformComponent>(entity);
 				tc.translation = transformComponent["Translation"].as<glm::vec3>();
 				tc.rotation = transformComponent["Rotation"].as<glm::vec3>();
 				tc.scale = transformComponent["Scale"].as<glm::vec3>();
+				tc.markDirty();
 			}
 
 			auto modelComponent = object["Model"];
@@ -207,7 +225,7 @@ bool SceneSerializer::deserialize(const std::string& filepath, Device& device, S
 			{
 				std::string modelFile = modelComponent["ModelPath"].as<std::string>();
 				std::shared_ptr<Model> model = Model::createModelFromFile(device, modelFile);
-				deserializedObj.model = model;
+				registry.emplace<MeshComponent>(entity, model);
 			}
 
 			auto materialComponent = object["Material"];
@@ -218,7 +236,7 @@ bool SceneSerializer::deserialize(const std::string& filepath, Device& device, S
 				// check if we have already loaded this material
 				if(outSceneData.materials.find(materialFile) != outSceneData.materials.end())
 				{
-					deserializedObj.setMaterial(outSceneData.materials[materialFile]); // Material already loaded, so just assign to object
+					registry.emplace<MaterialComponent>(entity, outSceneData.materials[materialFile], materialFile); // Material already loaded, so just assign to object
 				}
 				// load new material if not already loaded
 				else
@@ -228,16 +246,16 @@ bool SceneSerializer::deserialize(const std::string& filepath, Device& device, S
 					{
 						// default material if no file exists
 						mat.setShaderParameters(ShaderParameters{});
-						deserializedObj.setMaterial(mat);
+						registry.emplace<MaterialComponent>(entity, std::make_shared<Material>(mat), mat.getMaterialFileName());
 					}
 					else
 					{
-						mat = MaterialSerializer::deserialize(MaterialBuilder::getMaterialFilePath() + materialFile, device);
+						mat = MaterialSerializer::deserialize(MaterialBuilder::getMaterialFilePath() + materialFile, device, jobSystem);
 						mat.setMaterialFileName(materialFile);
 						std::shared_ptr<Material> matPtr = std::make_shared<Material>(mat);
 						outSceneData.materials.emplace(materialFile, matPtr);
 
-						deserializedObj.setMaterial(matPtr);
+						registry.emplace<MaterialComponent>(entity, matPtr, materialFile);
 					}
 				}
 			}
@@ -251,10 +269,10 @@ bool SceneSerializer::deserialize(const std::string& filepath, Device& device, S
 				float intensity = pointLightComponent["Intensity"].as<float>();
 				glm::vec3 color = pointLightComponent["Color"].as<glm::vec3>();
 
-				deserializedObj.pointLight = std::make_unique<PointLightComponent>();
-				deserializedObj.pointLight->intensity = intensity;
-				deserializedObj.pointLight->lightType = type;
-				deserializedObj.pointLight->color = color;
+				PointLightComponent& pointLight = registry.emplace<PointLightComponent>(entity);
+				pointLight.intensity = intensity;
+				pointLight.lightType = type;
+				pointLight.color = color;
 			}
 
 			auto spotLightComponent = object["SpotLightComponent"];
@@ -269,12 +287,12 @@ bool SceneSerializer::deserialize(const std::string& filepath, Device& device, S
 				float cutoffAngle = spotLightComponent["CutoffAngle"].as<float>();
 				float outerCuttoffAngle = spotLightComponent["OuterCutoffAngle"].as<float>();
 
-				deserializedObj.spotLight = std::make_unique<SpotLightComponent>();
-				deserializedObj.spotLight->intensity = intensity;
-				deserializedObj.spotLight->lightType = type;
-				deserializedObj.spotLight->color = color;
-				deserializedObj.spotLight->cutoffAngle = outerCuttoffAngle;
-				deserializedObj.spotLight->outerCutoffAngle = cutoffAngle;
+				SpotLightComponent& spotLight = registry.emplace<SpotLightComponent>(entity);
+				spotLight.intensity = intensity;
+				spotLight.lightType = type;
+				spotLight.color = color;
+				spotLight.cutoffAngle = outerCuttoffAngle;
+				spotLight.outerCutoffAngle = cutoffAngle;
 			}
 
 			auto directionalLightComponent = object["DirectionalLightComponent"];
@@ -287,14 +305,21 @@ bool SceneSerializer::deserialize(const std::string& filepath, Device& device, S
 				glm::vec3 color = directionalLightComponent["Color"].as<glm::vec3>();
 				glm::vec3 direction = directionalLightComponent["Direction"].as<glm::vec3>();
 
-				deserializedObj.directionalLight = std::make_unique<DirectionalLightComponent>();
-				deserializedObj.directionalLight->direction = direction;
-				deserializedObj.directionalLight->color = color;
-				deserializedObj.directionalLight->intensity = intensity;
-				deserializedObj.directionalLight->lightType = type;
+				DirectionalLightComponent& directionalLight = registry.emplace<DirectionalLightComponent>(entity);
+				directionalLight.direction = direction;
+				directionalLight.color = color;
+				directionalLight.intensity = intensity;
+				directionalLight.lightType = type;
 			}
+		}
 
-			outSceneData.objects.emplace(deserializedObj.getID(), std::move(deserializedObj));
+		for (const std::pair<Entity, int>& link : parentLinks)
+		{
+			auto parent = fileEntities.find(link.second);
+			if(parent == fileEntities.end() || !registry.setParent(link.first, parent->second))
+			{
+				CORE_WARN("Scene Deserialization: object {0} has an invalid parent {1}, it will be a root object", registry.get<TagComponent>(link.first).name, link.second)
+			}
 		}
 	}
 
@@ -347,7 +372,7 @@ void MaterialSerializer::serialize(const std::string& filepath, std::shared_ptr<
 	fout << out.c_str();
 }
 
-Material MaterialSerializer::deserialize(const std::string& filepath, class Device& device)
+Material MaterialSerializer::deserialize(const std::string& filepath, class Device& device, JobSystem* jobSystem)
 {
 	std::ifstream inFile(filepath);
 	std::stringstream ss;
@@ -418,26 +443,51 @@ Material MaterialSerializer::deserialize(const std::string& filepath, class Devi
 
 					MaterialBuilder builder;
 
+					std::vector<std::filesystem::path> paths;
 					for (const auto& entry : std::filesystem::directory_iterator(textureDir))
 					{
-						std::filesystem::path path = entry.path();
+						paths.push_back(entry.path());
+					}
+
+					// Decoding dominates load time and needs no device access, so only the uploads stay on this thread
+					std::vector<Utils::DecodedImage> images(paths.size());
+					std::vector<uint8_t> decoded(paths.size(), 0);
+					auto decode = [&paths, &images, &decoded](uint32_t begin, uint32_t end, uint32_t)
+					{
+						for (uint32_t i = begin; i < end; i++)
+						{
+							decoded[i] = Utils::decodeImage(paths[i].string().c_str(), images[i]);
+						}
+					};
+					if (jobSystem)
+						jobSystem->parallelFor(static_cast<uint32_t>(paths.size()), 1, decode);
+					else
+						decode(0, static_cast<uint32_t>(paths.size()), 0);
+
+					for (size_t i = 0; i < paths.size(); i++)
+					{
+						const std::filesystem::path& path = paths[i];
 						std::string fileName = path.string();
 
 						//TODO: Handle case where multiple materials reference the same textures
 
 						Texture texture;
 
-						//Check if the texture we are loading is a normal map
-						if (path.stem().string().find(builder.normalExtension) != std::string::npos)
-						{
-							//Set texture format for normal maps
-							texture.setTextureFormat(VK_FORMAT_R8G8B8A8_UNORM);
-							Utils::loadImageFromFile(device, fileName.c_str(), texture, VK_FORMAT_R8G8B8A8_UNORM);
-						}
-						// load texture with default format
-						else
+						if (decoded[i])
 						{
-							Utils::loadImageFromFile(device, fileName.c_str(), texture);
+							//Check if the texture we are loading is a normal map
+							if (path.stem().string().find(builder.normalExtension) != std::string::npos)
+							{
+								//Set texture format for normal maps
+								texture.setTextureFormat(VK_FORMAT_R8G8B8A8_UNORM);
+								Utils::uploadImage(device, images[i], texture, VK_FORMAT_R8G8B8A8_UNORM);
+							}
+							// load texture with default format
+							else
+							{
+								Utils::uploadImage(device, images[i], texture);
+							}
+							Utils::freeImage(images[i]);
 						}
 						texture.createTextureImageView(device);
 						texture.createTextureSampler(device);
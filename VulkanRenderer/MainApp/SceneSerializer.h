@@ -7,13 +7,14 @@
 class SceneSerializer
 {
 public:
-	void serialize(const std::string& filepath, GameObject::Map& gameObjects);
-	bool deserialize(const std::string& filepath, class Device& device, SceneData& outSceneData);
+	void serialize(const std::string& filepath, Registry& registry);
+	// Texture files are decoded on the job system when there is one
+	bool deserialize(const std::string& filepath, class Device& device, SceneData& outSceneData, class JobSystem* jobSystem = nullptr);
 };
 
 class MaterialSerializer
 {
 public:
 	static void serialize(const std::string& filepath, std::shared_ptr<Material> material);
-	static Material deserialize(const std::string& filepath, class Device& device);
+	static Material deserialize(const std::string& filepath, class Device& device, class JobSystem* jobSystem = nullptr);
 };
\ No newline at end of file
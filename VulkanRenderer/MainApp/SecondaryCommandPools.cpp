@@ -0,0 +1,97 @@
+#include "SecondaryCommandPools.h"
+#include "SwapChain.h"
+
+#include <stdexcept>
+
+SecondaryCommandPools::SecondaryCommandPools(Device& device)
+	: device{device}
+{
+}
+
+SecondaryCommandPools::~SecondaryCommandPools()
+{
+	cleanup();
+}
+
+void SecondaryCommandPools::init(uint32_t threadCount)
+{
+	this->threadCount = threadCount;
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = device.findPhysicalQueueFamilies().graphicsFamily;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	pools.resize(SwapChain::MAX_FRAMES_IN_FLIGHT * threadCount);
+	for (ThreadPools& threadPools : pools)
+	{
+		if (vkCreateCommandPool(device.getDevice(), &poolInfo, nullptr, &threadPools.commandPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create secondary command pool!");
+		}
+	}
+}
+
+void SecondaryCommandPools::cleanup()
+{
+	// Destroying a pool frees its command buffers
+	for (ThreadPools& threadPools : pools)
+	{
+		vkDestroyCommandPool(device.getDevice(), threadPools.commandPool, nullptr);
+	}
+	pools.clear();
+}
+
+void SecondaryCommandPools::reset(int frameIndex)
+{
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		ThreadPools& threadPools = getPools(frameIndex, i);
+		if (threadPools.usedCount == 0)
+			continue;
+
+		vkResetCommandPool(device.getDevice(), threadPools.commandPool, 0);
+		threadPools.usedCount = 0;
+	}
+}
+
+VkCommandBuffer SecondaryCommandPools::begin(int frameIndex, uint32_t threadIndex, const VkCommandBufferInheritanceInfo& inheritanceInfo)
+{
+	ThreadPools& threadPools = getPools(frameIndex, threadIndex);
+	if (threadPools.usedCount == threadPools.commandBuffers.size())
+	{
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocInfo.commandPool = threadPools.commandPool;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(device.getDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate secondary command buffer!");
+		}
+		threadPools.commandBuffers.push_back(commandBuffer);
+	}
+
+	VkCommandBuffer commandBuffer = threadPools.commandBuffers[threadPools.usedCount++];
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to begin secondary command buffer!");
+	}
+	return commandBuffer;
+}
+
+void SecondaryCommandPools::end(VkCommandBuffer commandBuffer)
+{
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record secondary command buffer!");
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Device.h"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+/*
+ * Secondary command buffers for recording a render pass from several threads. A command pool may
+ * only be used by one thread at a time, so every thread gets its own pool per frame in flight. A
+ * frame's pools are reset together once its fence has been waited on, and the buffers allocated
+ * from them are reused the next time that frame records.
+ */
+class SecondaryCommandPools
+{
+public:
+	SecondaryCommandPools(Device& device);
+	~SecondaryCommandPools();
+
+	SecondaryCommandPools(const SecondaryCommandPools&) = delete;
+	SecondaryCommandPools& operator=(const SecondaryCommandPools&) = delete;
+
+	void init(uint32_t threadCount);
+	void cleanup();
+
+	// Called once the frame's previous submission has completed
+	void reset(int frameIndex);
+
+	// Only the thread with this index may call it until the frame is reset
+	VkCommandBuffer begin(int frameIndex, uint32_t threadIndex, const VkCommandBufferInheritanceInfo& inheritanceInfo);
+	void end(VkCommandBuffer commandBuffer);
+
+	uint32_t getThreadCount() const { return threadCount; }
+
+private:
+	struct ThreadPools
+	{
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> commandBuffers;
+		uint32_t usedCount = 0;
+	};
+
+	ThreadPools& getPools(int frameIndex, uint32_t threadIndex) { return pools[frameIndex * threadCount + threadIndex]; }
+
+	Device& device;
+	uint32_t threadCount = 0;
+	std::vector<ThreadPools> pools; // Frame-major, threadCount entries per frame in flight
+};
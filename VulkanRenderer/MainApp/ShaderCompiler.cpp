@@ -0,0 +1,216 @@
+#include "ShaderCompiler.h"
+#include "JobSystem.h"
+#include "Log.h"
+#include "Utils.h"
+
+#include <shaderc/shaderc.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+// Bump when compile options change, so SPIR-V built with the old ones is no longer found
+static constexpr const char* SPIRV_CACHE_VERSION = "1";
+
+static bool readFile(const std::string& filePath, std::string& contents)
+{
+	std::ifstream file(filePath, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	std::ostringstream stream;
+	stream << file.rdbuf();
+	contents = stream.str();
+	return true;
+}
+
+static bool writeFile(const std::string& filePath, const std::vector<char>& contents)
+{
+	std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	file.write(contents.data(), contents.size());
+	return file.good();
+}
+
+ShaderCompiler::ShaderCompiler(const std::string& shaderDirectory, const std::string& cacheDirectory)
+	: shaderDirectory{shaderDirectory}, cacheDirectory{cacheDirectory}
+{
+}
+
+std::vector<std::string> ShaderCompiler::compileAll(JobSystem& jobSystem)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector<std::string> sources = findSources();
+	std::vector<std::string> changed = compile(sources, jobSystem);
+
+	float time = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	CORE_INFO("Checked {0} shaders in {1:.2f} ms, {2} changed", sources.size(), time, changed.size())
+	return changed;
+}
+
+std::vector<std::string> ShaderCompiler::compile(const std::vector<std::string>& sourcePaths, JobSystem& jobSystem)
+{
+	std::vector<Result> results(sourcePaths.size());
+	jobSystem.parallelFor(static_cast<uint32_t>(sourcePaths.size()), 1, [&](uint32_t begin, uint32_t end, uint32_t threadIndex)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			results[i] = compileShader(sourcePaths[i]);
+		}
+	});
+
+	std::vector<std::string> changed;
+	for (size_t i = 0; i < sourcePaths.size(); i++)
+	{
+		if (results[i] == Result::Changed)
+			changed.push_back(getOutputPath(sourcePaths[i]));
+	}
+	return changed;
+}
+
+std::vector<std::string> ShaderCompiler::findSources() const
+{
+	std::vector<std::string> sources;
+
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(shaderDirectory, error))
+	{
+		if (entry.is_regular_file() && isShaderSource(entry.path()))
+			sources.push_back((std::filesystem::path(shaderDirectory) / entry.path().filename()).generic_string());
+	}
+
+	if (error)
+		CORE_ERROR("Failed to list shaders in {0}: {1}", shaderDirectory, error.message())
+	return sources;
+}
+
+bool ShaderCompiler::isShaderSource(const std::filesystem::path& path)
+{
+	std::string extension = path.extension().string();
+	return extension == ".vert" || extension == ".frag" || extension == ".comp";
+}
+
+std::string ShaderCompiler::getOutputPath(const std::string& sourcePath)
+{
+	// Same names CompileShaders.bat used to write
+	std::filesystem::path path(sourcePath);
+	std::string extension = path.extension().string();
+	std::string stage = extension == ".vert" ? "Vert" : extension == ".frag" ? "Frag" : "Comp";
+
+	return (path.parent_path() / (path.stem().string() + stage + ".spv")).generic_string();
+}
+
+ShaderCompiler::Result ShaderCompiler::compileShader(const std::string& sourcePath)
+{
+	std::string source;
+	if (!readFile(sourcePath, source))
+	{
+		CORE_ERROR("Failed to read shader {0}", sourcePath)
+		return Result::Failed;
+	}
+
+	std::vector<char> spirv;
+	if (!getSpirv(sourcePath, source, spirv))
+		return Result::Failed;
+
+	// Only a different .spv counts as a change, so saving a file without editing it rebuilds nothing
+	std::string outputPath = getOutputPath(sourcePath);
+	std::string output;
+	if (readFile(outputPath, output) && output.size() == spirv.size() && std::equal(spirv.begin(), spirv.end(), output.begin()))
+		return Result::Unchanged;
+
+	if (!writeFile(outputPath, spirv))
+	{
+		CORE_ERROR("Failed to write {0}", outputPath)
+		return Result::Failed;
+	}
+
+	CORE_INFO("Compiled {0}", sourcePath)
+	return Result::Changed;
+}
+
+bool ShaderCompiler::getSpirv(const std::string& sourcePath, const std::string& source, std::vector<char>& spirv)
+{
+	std::filesystem::path path(sourcePath);
+	std::string extension = path.extension().string();
+
+	std::string key = std::string(SPIRV_CACHE_VERSION) + extension + "\n" + source;
+	char hash[17];
+	std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(Utils::hashBytes(key.data(), key.size())));
+	std::string cachePath = cacheDirectory + "/" + hash + ".spv";
+
+	std::string cached;
+	if (readFile(cachePath, cached) && !cached.empty())
+	{
+		spirv.assign(cached.begin(), cached.end());
+		return true;
+	}
+
+	shaderc_shader_kind kind = extension == ".vert" ? shaderc_glsl_vertex_shader :
+		extension == ".frag" ? shaderc_glsl_fragment_shader : shaderc_glsl_compute_shader;
+
+	// Compiler objects are cheap next to a compile, one per call keeps this safe to run from any thread
+	shaderc::Compiler compiler;
+	shaderc::CompileOptions options;
+	options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+
+	shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source.data(), source.size(), kind, sourcePath.c_str(), options);
+	if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+	{
+		CORE_ERROR("Failed to compile {0}:\n{1}", sourcePath, result.GetErrorMessage())
+		return false;
+	}
+
+	const char* begin = reinterpret_cast<const char*>(result.cbegin());
+	const char* end = reinterpret_cast<const char*>(result.cend());
+	spirv.assign(begin, end);
+
+	// Written under a name of its own first, two shaders with the same source can be compiled at once
+	std::error_code error;
+	std::filesystem::create_directories(cacheDirectory, error);
+	std::string tempPath = cachePath + "." + path.filename().string() + ".tmp";
+	if (writeFile(tempPath, spirv))
+	{
+		std::filesystem::rename(tempPath, cachePath, error);
+	}
+	if (error)
+		CORE_WARN("Failed to cache the SPIR-V of {0}: {1}", sourcePath, error.message())
+
+	return true;
+}
+
+ShaderWatcher::ShaderWatcher(const ShaderCompiler& compiler)
+	: compiler{compiler}
+{
+}
+
+std::vector<std::string> ShaderWatcher::poll()
+{
+	auto now = std::chrono::high_resolution_clock::now();
+	if (started && std::chrono::duration<float>(now - lastPoll).count() < POLL_INTERVAL)
+		return {};
+	lastPoll = now;
+
+	std::vector<std::string> written;
+	for (const std::string& source : compiler.findSources())
+	{
+		std::error_code error;
+		std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(source, error);
+		if (error)
+			continue;
+
+		auto it = writeTimes.find(source);
+		if (it == writeTimes.end() || it->second != writeTime)
+		{
+			if (started)
+				written.push_back(source);
+			writeTimes[source] = writeTime;
+		}
+	}
+
+	started = true;
+	return written;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <unordered_map>
+#include <filesystem>
+
+class JobSystem;
+
+/*
+ * Compiles the GLSL shaders in the shader directory to SPIR-V in process, with shaderc. Every source is
+ * written next to itself under the name the pipelines load, PBR.frag becomes PBRFrag.spv. The SPIR-V is
+ * also kept in a cache keyed by a hash of the source, so a shader that compiled once, in this run or an
+ * earlier one, is never compiled again. The shaders don't #include each other, so the source alone
+ * decides the output.
+ */
+class ShaderCompiler
+{
+public:
+	ShaderCompiler(const std::string& shaderDirectory = SHADER_DIRECTORY, const std::string& cacheDirectory = CACHE_DIRECTORY);
+
+	// Brings every .spv in the shader directory up to date, returns the ones whose contents changed
+	std::vector<std::string> compileAll(JobSystem& jobSystem);
+	// Same for the given sources only
+	std::vector<std::string> compile(const std::vector<std::string>& sourcePaths, JobSystem& jobSystem);
+
+	// Sources in the shader directory, in no particular order
+	std::vector<std::string> findSources() const;
+	const std::string& getShaderDirectory() const { return shaderDirectory; }
+
+	static bool isShaderSource(const std::filesystem::path& path);
+	// The .spv the pipelines load for a source
+	static std::string getOutputPath(const std::string& sourcePath);
+
+	static constexpr const char* SHADER_DIRECTORY = "MainApp/resources/vulkan/shaders";
+	static constexpr const char* CACHE_DIRECTORY = "MainApp/cache/shaders";
+
+private:
+	enum class Result
+	{
+		Unchanged,
+		Changed,
+		Failed
+	};
+
+	// Compile errors are logged and leave the old .spv in place
+	Result compileShader(const std::string& sourcePath);
+	// Returns false if the source failed to compile
+	bool getSpirv(const std::string& sourcePath, const std::string& source, std::vector<char>& spirv);
+
+	std::string shaderDirectory;
+	std::string cacheDirectory;
+};
+
+/*
+ * Notices shader sources being added or saved, by polling their write times. Polling a directory of a
+ * few dozen files is cheap enough to do from the main loop and works the same on every platform.
+ */
+class ShaderWatcher
+{
+public:
+	ShaderWatcher(const ShaderCompiler& compiler);
+
+	// Returns the sources written since the last call, at most once per interval.
+	// The first call only records the current write times.
+	std::vector<std::string> poll();
+
+	static constexpr float POLL_INTERVAL = 0.5f; // Seconds
+
+private:
+	const ShaderCompiler& compiler;
+	std::unordered_map<std::string, std::filesystem::file_time_type> writeTimes;
+	std::chrono::high_resolution_clock::time_point lastPoll;
+	bool started = false;
+};
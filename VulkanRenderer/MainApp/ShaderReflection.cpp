@@ -0,0 +1,440 @@
+#include "ShaderReflection.h"
+#include "Pipeline.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+	// The few parts of the SPIR-V spec the reflection needs
+	constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+	constexpr uint32_t OP_ENTRY_POINT = 15;
+	constexpr uint32_t OP_TYPE_INT = 21;
+	constexpr uint32_t OP_TYPE_FLOAT = 22;
+	constexpr uint32_t OP_TYPE_VECTOR = 23;
+	constexpr uint32_t OP_TYPE_MATRIX = 24;
+	constexpr uint32_t OP_TYPE_IMAGE = 25;
+	constexpr uint32_t OP_TYPE_SAMPLER = 26;
+	constexpr uint32_t OP_TYPE_SAMPLED_IMAGE = 27;
+	constexpr uint32_t OP_TYPE_ARRAY = 28;
+	constexpr uint32_t OP_TYPE_RUNTIME_ARRAY = 29;
+	constexpr uint32_t OP_TYPE_STRUCT = 30;
+	constexpr uint32_t OP_TYPE_POINTER = 32;
+	constexpr uint32_t OP_CONSTANT = 43;
+	constexpr uint32_t OP_SPEC_CONSTANT = 50;
+	constexpr uint32_t OP_VARIABLE = 59;
+	constexpr uint32_t OP_DECORATE = 71;
+	constexpr uint32_t OP_MEMBER_DECORATE = 72;
+
+	constexpr uint32_t DECORATION_BUFFER_BLOCK = 3;
+	constexpr uint32_t DECORATION_ARRAY_STRIDE = 6;
+	constexpr uint32_t DECORATION_MATRIX_STRIDE = 7;
+	constexpr uint32_t DECORATION_BUILT_IN = 11;
+	constexpr uint32_t DECORATION_LOCATION = 30;
+	constexpr uint32_t DECORATION_BINDING = 33;
+	constexpr uint32_t DECORATION_DESCRIPTOR_SET = 34;
+	constexpr uint32_t DECORATION_OFFSET = 35;
+
+	constexpr uint32_t STORAGE_UNIFORM_CONSTANT = 0;
+	constexpr uint32_t STORAGE_INPUT = 1;
+	constexpr uint32_t STORAGE_UNIFORM = 2;
+	constexpr uint32_t STORAGE_PUSH_CONSTANT = 9;
+	constexpr uint32_t STORAGE_STORAGE_BUFFER = 12;
+
+	constexpr uint32_t DIM_BUFFER = 5;
+	constexpr uint32_t DIM_SUBPASS_DATA = 6;
+
+	struct SpirvType
+	{
+		uint32_t opcode;
+		std::vector<uint32_t> operands; // Everything after the result id
+	};
+
+	struct SpirvVariable
+	{
+		uint32_t id;
+		uint32_t typeId;
+		uint32_t storageClass;
+	};
+
+	struct SpirvModule
+	{
+		VkShaderStageFlags stages = 0;
+		std::map<uint32_t, SpirvType> types;
+		std::map<uint32_t, uint32_t> constants;
+		std::vector<SpirvVariable> variables;
+		std::map<uint32_t, std::map<uint32_t, uint32_t>> decorations; // Id, then decoration to its first literal
+		std::map<uint64_t, std::map<uint32_t, uint32_t>> memberDecorations; // Struct id << 32 | member index
+
+		const SpirvType* findType(uint32_t id) const
+		{
+			auto it = types.find(id);
+			return it != types.end() ? &it->second : nullptr;
+		}
+
+		bool hasDecoration(uint32_t id, uint32_t decoration) const
+		{
+			auto it = decorations.find(id);
+			return it != decorations.end() && it->second.count(decoration) != 0;
+		}
+
+		uint32_t getDecoration(uint32_t id, uint32_t decoration, uint32_t fallback = 0) const
+		{
+			auto it = decorations.find(id);
+			if (it == decorations.end() || it->second.count(decoration) == 0)
+				return fallback;
+			return it->second.at(decoration);
+		}
+
+		uint32_t getMemberDecoration(uint32_t structId, uint32_t member, uint32_t decoration, uint32_t fallback = 0) const
+		{
+			auto it = memberDecorations.find((static_cast<uint64_t>(structId) << 32) | member);
+			if (it == memberDecorations.end() || it->second.count(decoration) == 0)
+				return fallback;
+			return it->second.at(decoration);
+		}
+	};
+
+	VkShaderStageFlags getStage(uint32_t executionModel)
+	{
+		switch (executionModel)
+		{
+		case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+		case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+		case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+		case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+		case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+		default: return 0;
+		}
+	}
+
+	// Size of a type as laid out in a block, from the offsets and strides the compiler decorated it with
+	uint32_t getTypeSize(const SpirvModule& module, uint32_t typeId, uint32_t matrixStride = 0)
+	{
+		const SpirvType* type = module.findType(typeId);
+		if (!type)
+			return 0;
+
+		switch (type->opcode)
+		{
+		case OP_TYPE_INT:
+		case OP_TYPE_FLOAT:
+			return type->operands[0] / 8;
+		case OP_TYPE_VECTOR:
+			return type->operands[1] * getTypeSize(module, type->operands[0]);
+		case OP_TYPE_MATRIX:
+			return type->operands[1] * (matrixStride != 0 ? matrixStride : getTypeSize(module, type->operands[0]));
+		case OP_TYPE_ARRAY:
+		{
+			uint32_t length = module.constants.count(type->operands[1]) ? module.constants.at(type->operands[1]) : 0;
+			uint32_t stride = module.getDecoration(typeId, DECORATION_ARRAY_STRIDE, getTypeSize(module, type->operands[0], matrixStride));
+			return length * stride;
+		}
+		case OP_TYPE_STRUCT:
+		{
+			uint32_t size = 0;
+			for (uint32_t member = 0; member < type->operands.size(); member++)
+			{
+				uint32_t offset = module.getMemberDecoration(typeId, member, DECORATION_OFFSET, size);
+				uint32_t memberStride = module.getMemberDecoration(typeId, member, DECORATION_MATRIX_STRIDE);
+				size = std::max(size, offset + getTypeSize(module, type->operands[member], memberStride));
+			}
+			return size;
+		}
+		default:
+			return 0; // Runtime arrays have no size of their own
+		}
+	}
+
+	VkFormat getVertexFormat(const SpirvModule& module, uint32_t typeId)
+	{
+		const SpirvType* type = module.findType(typeId);
+		if (!type)
+			return VK_FORMAT_UNDEFINED;
+
+		uint32_t componentCount = 1;
+		if (type->opcode == OP_TYPE_VECTOR)
+		{
+			componentCount = type->operands[1];
+			type = module.findType(type->operands[0]);
+		}
+		if (!type || type->operands[0] != 32 || componentCount > 4)
+			return VK_FORMAT_UNDEFINED;
+
+		static const VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+		static const VkFormat intFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+		static const VkFormat uintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+		if (type->opcode == OP_TYPE_FLOAT)
+			return floatFormats[componentCount - 1];
+		if (type->opcode == OP_TYPE_INT)
+			return type->operands[1] ? intFormats[componentCount - 1] : uintFormats[componentCount - 1];
+		return VK_FORMAT_UNDEFINED;
+	}
+
+	// Returns false for resources that aren't descriptors
+	bool getDescriptorType(const SpirvModule& module, const SpirvType& type, uint32_t typeId, uint32_t storageClass, VkDescriptorType& descriptorType)
+	{
+		switch (type.opcode)
+		{
+		case OP_TYPE_SAMPLED_IMAGE:
+			descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			return true;
+		case OP_TYPE_SAMPLER:
+			descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+			return true;
+		case OP_TYPE_IMAGE:
+		{
+			uint32_t dim = type.operands[1];
+			bool storage = type.operands[5] == 2;
+			if (dim == DIM_SUBPASS_DATA)
+				descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			else if (dim == DIM_BUFFER)
+				descriptorType = storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+			else
+				descriptorType = storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			return true;
+		}
+		case OP_TYPE_STRUCT:
+			// Older SPIR-V marks storage buffers as BufferBlock in the Uniform class
+			if (storageClass == STORAGE_STORAGE_BUFFER || module.hasDecoration(typeId, DECORATION_BUFFER_BLOCK))
+				descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			else
+				descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			return true;
+		default:
+			return false;
+		}
+	}
+}
+
+ShaderReflection::ShaderReflection(const std::vector<std::string>& filePaths)
+{
+	for (const std::string& filePath : filePaths)
+	{
+		std::ifstream file(filePath, std::ios::ate | std::ios::binary);
+		if (!file.is_open())
+			throw std::runtime_error("Failed to open " + filePath + " for reflection!");
+
+		size_t fileSize = (size_t)file.tellg();
+		if (fileSize % sizeof(uint32_t) != 0)
+			throw std::runtime_error(filePath + " is not valid SPIR-V!");
+
+		std::vector<uint32_t> code(fileSize / sizeof(uint32_t));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(code.data()), fileSize);
+
+		ShaderReflection module;
+		module.parse(code, filePath);
+		merge(module);
+	}
+}
+
+void ShaderReflection::merge(const ShaderReflection& other)
+{
+	for (const auto& set : other.sets)
+	{
+		for (const auto& binding : set.second)
+		{
+			auto it = sets[set.first].find(binding.first);
+			if (it == sets[set.first].end())
+			{
+				sets[set.first][binding.first] = binding.second;
+				continue;
+			}
+
+			Binding& existing = it->second;
+			if (existing.layoutBinding.descriptorType != binding.second.layoutBinding.descriptorType)
+			{
+				throw std::runtime_error("Set " + std::to_string(set.first) + " binding " + std::to_string(binding.first) +
+					" is declared with different descriptor types!");
+			}
+			existing.layoutBinding.stageFlags |= binding.second.layoutBinding.stageFlags;
+			existing.layoutBinding.descriptorCount = std::max(existing.layoutBinding.descriptorCount, binding.second.layoutBinding.descriptorCount);
+			existing.unsized = existing.unsized || binding.second.unsized;
+		}
+	}
+
+	pushConstantSize = std::max(pushConstantSize, other.pushConstantSize);
+	pushConstantStages |= other.pushConstantStages;
+	vertexInputs.insert(other.vertexInputs.begin(), other.vertexInputs.end());
+}
+
+std::vector<VkDescriptorSetLayoutBinding> ShaderReflection::getSetBindings(uint32_t set, uint32_t unsizedCount) const
+{
+	std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+	auto it = sets.find(set);
+	if (it == sets.end())
+		return bindings;
+
+	for (const auto& binding : it->second)
+	{
+		VkDescriptorSetLayoutBinding layoutBinding = binding.second.layoutBinding;
+		if (binding.second.unsized)
+		{
+			if (unsizedCount == 0)
+				throw std::runtime_error("Set " + std::to_string(set) + " binding " + std::to_string(binding.first) + " is an unsized array, its size has to be given!");
+			layoutBinding.descriptorCount = unsizedCount;
+		}
+		bindings.push_back(layoutBinding);
+	}
+	return bindings;
+}
+
+bool ShaderReflection::hasUnsizedArray(uint32_t set) const
+{
+	auto it = sets.find(set);
+	if (it == sets.end())
+		return false;
+
+	return std::any_of(it->second.begin(), it->second.end(), [](const auto& binding) { return binding.second.unsized; });
+}
+
+uint32_t ShaderReflection::getSetCount() const
+{
+	return sets.empty() ? 0 : sets.rbegin()->first + 1;
+}
+
+std::vector<VkPushConstantRange> ShaderReflection::getPushConstantRanges() const
+{
+	if (pushConstantSize == 0)
+		return {};
+
+	VkPushConstantRange range{};
+	range.stageFlags = pushConstantStages;
+	range.offset = 0;
+	range.size = pushConstantSize;
+	return { range };
+}
+
+void ShaderReflection::applyVertexInput(PipelineConfigInfo& configInfo) const
+{
+	std::vector<VkVertexInputAttributeDescription> attributes;
+	for (const auto& input : vertexInputs)
+	{
+		auto it = std::find_if(configInfo.attributeDescriptions.begin(), configInfo.attributeDescriptions.end(),
+			[&input](const VkVertexInputAttributeDescription& attribute) { return attribute.location == input.first; });
+
+		if (it == configInfo.attributeDescriptions.end())
+			throw std::runtime_error("The vertex shader reads location " + std::to_string(input.first) + ", which the vertex layout doesn't have!");
+		if (it->format != input.second)
+			throw std::runtime_error("The vertex shader reads location " + std::to_string(input.first) + " with a different format than the vertex layout!");
+
+		attributes.push_back(*it);
+	}
+
+	configInfo.attributeDescriptions = attributes;
+	if (attributes.empty())
+		configInfo.bindingDescriptions.clear();
+}
+
+void ShaderReflection::parse(const std::vector<uint32_t>& code, const std::string& filePath)
+{
+	if (code.size() < 5 || code[0] != SPIRV_MAGIC)
+		throw std::runtime_error(filePath + " is not valid SPIR-V!");
+
+	// Instructions after the 5 word header start with their word count and opcode
+	SpirvModule module;
+	for (size_t i = 5; i < code.size();)
+	{
+		uint32_t wordCount = code[i] >> 16;
+		uint32_t opcode = code[i] & 0xFFFF;
+		if (wordCount == 0 || i + wordCount > code.size())
+			throw std::runtime_error(filePath + " is not valid SPIR-V!");
+
+		const uint32_t* operands = &code[i + 1];
+		uint32_t operandCount = wordCount - 1;
+
+		switch (opcode)
+		{
+		case OP_ENTRY_POINT:
+			module.stages |= getStage(operands[0]);
+			break;
+		case OP_DECORATE:
+			module.decorations[operands[0]][operands[1]] = operandCount > 2 ? operands[2] : 0;
+			break;
+		case OP_MEMBER_DECORATE:
+			module.memberDecorations[(static_cast<uint64_t>(operands[0]) << 32) | operands[1]][operands[2]] = operandCount > 3 ? operands[3] : 0;
+			break;
+		case OP_CONSTANT:
+		case OP_SPEC_CONSTANT:
+			// Array lengths, only the low word matters
+			module.constants[operands[1]] = operands[2];
+			break;
+		case OP_VARIABLE:
+			module.variables.push_back({ operands[1], operands[0], operands[2] });
+			break;
+		default:
+			if (opcode >= OP_TYPE_INT && opcode <= OP_TYPE_POINTER)
+				module.types[operands[0]] = { opcode, std::vector<uint32_t>(operands + 1, operands + operandCount) };
+			break;
+		}
+
+		i += wordCount;
+	}
+
+	for (const SpirvVariable& variable : module.variables)
+	{
+		const SpirvType* pointer = module.findType(variable.typeId);
+		if (!pointer || pointer->opcode != OP_TYPE_POINTER)
+			continue;
+		uint32_t typeId = pointer->operands[1];
+
+		if (variable.storageClass == STORAGE_PUSH_CONSTANT)
+		{
+			pushConstantSize = std::max(pushConstantSize, getTypeSize(module, typeId));
+			pushConstantStages |= module.stages;
+			continue;
+		}
+
+		if (variable.storageClass == STORAGE_INPUT)
+		{
+			if (!(module.stages & VK_SHADER_STAGE_VERTEX_BIT) || module.hasDecoration(variable.id, DECORATION_BUILT_IN) ||
+				!module.hasDecoration(variable.id, DECORATION_LOCATION))
+				continue;
+
+			VkFormat format = getVertexFormat(module, typeId);
+			if (format == VK_FORMAT_UNDEFINED)
+				throw std::runtime_error(filePath + " has a vertex input of a type that can't be reflected!");
+			vertexInputs[module.getDecoration(variable.id, DECORATION_LOCATION)] = format;
+			continue;
+		}
+
+		if (variable.storageClass != STORAGE_UNIFORM_CONSTANT && variable.storageClass != STORAGE_UNIFORM && variable.storageClass != STORAGE_STORAGE_BUFFER)
+			continue;
+		if (!module.hasDecoration(variable.id, DECORATION_DESCRIPTOR_SET) || !module.hasDecoration(variable.id, DECORATION_BINDING))
+			continue;
+
+		// Arrays of resources are one binding with several descriptors
+		uint32_t count = 1;
+		bool unsized = false;
+		const SpirvType* type = module.findType(typeId);
+		while (type && (type->opcode == OP_TYPE_ARRAY || type->opcode == OP_TYPE_RUNTIME_ARRAY))
+		{
+			if (type->opcode == OP_TYPE_ARRAY)
+				count *= module.constants.count(type->operands[1]) ? module.constants.at(type->operands[1]) : 1;
+			else
+				unsized = true;
+
+			typeId = type->operands[0];
+			type = module.findType(typeId);
+		}
+
+		VkDescriptorType descriptorType;
+		if (!type || !getDescriptorType(module, *type, typeId, variable.storageClass, descriptorType))
+			continue;
+
+		uint32_t set = module.getDecoration(variable.id, DECORATION_DESCRIPTOR_SET);
+		Binding binding{};
+		binding.layoutBinding.binding = module.getDecoration(variable.id, DECORATION_BINDING);
+		binding.layoutBinding.descriptorType = descriptorType;
+		binding.layoutBinding.descriptorCount = count;
+		binding.layoutBinding.stageFlags = module.stages;
+		binding.unsized = unsized;
+		sets[set][binding.layoutBinding.binding] = binding;
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+#include <map>
+
+struct PipelineConfigInfo;
+
+/*
+ * The interface of one or more SPIR-V shader modules, read straight from the binary: the descriptor
+ * bindings of every set, the push constant block and the vertex shader's inputs. Only the handful of
+ * instructions that describe these are looked at, everything else is skipped by its word count.
+ * Shaders of one pipeline, or every pipeline sharing a set, are merged so each binding's stages
+ * cover all of them.
+ */
+class ShaderReflection
+{
+public:
+	ShaderReflection() = default;
+	// Reflects and merges the given .spv files, throws if one can't be read or isn't valid SPIR-V
+	explicit ShaderReflection(const std::vector<std::string>& filePaths);
+
+	// Throws if the same binding is declared with different types
+	void merge(const ShaderReflection& other);
+
+	// Bindings of a set, sorted. Arrays without a size in the shader get unsizedCount descriptors.
+	std::vector<VkDescriptorSetLayoutBinding> getSetBindings(uint32_t set, uint32_t unsizedCount = 0) const;
+	bool hasUnsizedArray(uint32_t set) const;
+	// One more than the highest set used, the number of set layouts a pipeline layout needs
+	uint32_t getSetCount() const;
+
+	// A single range from offset 0 covering every stage's push constants, or none
+	std::vector<VkPushConstantRange> getPushConstantRanges() const;
+	uint32_t getPushConstantSize() const { return pushConstantSize; }
+
+	// Drops the vertex attributes the vertex shader doesn't read, and the bindings too if it reads none.
+	// Throws if the shader reads a location the config doesn't provide or with another format.
+	void applyVertexInput(PipelineConfigInfo& configInfo) const;
+
+private:
+	struct Binding
+	{
+		VkDescriptorSetLayoutBinding layoutBinding;
+		bool unsized;
+	};
+
+	void parse(const std::vector<uint32_t>& code, const std::string& filePath);
+
+	std::map<uint32_t, std::map<uint32_t, Binding>> sets; // Set, then binding
+	uint32_t pushConstantSize = 0;
+	VkShaderStageFlags pushConstantStages = 0;
+	std::map<uint32_t, VkFormat> vertexInputs; // Location to format
+};
@@ -0,0 +1,158 @@
+#include "StagingRing.h"
+#include "Log.h"
+
+#include <stdexcept>
+
+StagingRing::StagingRing(Device& device, VkDeviceSize size)
+	: device{device}, capacity{size}
+{
+	device.createBuffer(capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, memory);
+
+	if (!memory.mapped)
+	{
+		throw std::runtime_error("failed to map staging ring!");
+	}
+
+	CORE_INFO("Created staging ring: {0:.2f} MB", capacity / (1024.0 * 1024.0))
+}
+
+StagingRing::~StagingRing()
+{
+	vkDestroyBuffer(device.getDevice(), buffer, nullptr);
+	device.freeMemory(memory);
+}
+
+uint32_t StagingRing::createOwner()
+{
+	std::lock_guard<std::mutex> lock(ringMutex);
+	return nextOwner++;
+}
+
+bool StagingRing::allocate(uint32_t owner, VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& outAllocation, bool wait)
+{
+	std::lock_guard<std::mutex> lock(ringMutex);
+
+	if (size == 0 || size > capacity)
+	{
+		return false;
+	}
+
+	reclaimSignaled();
+
+	while (!tryAllocate(owner, size, alignment, outAllocation))
+	{
+		// A range that isn't retired has no submission to wait on yet
+		if (!wait || ranges.empty() || !ranges.front().retired)
+		{
+			return false;
+		}
+
+		waitFor(ranges.front());
+		reclaimFront();
+	}
+
+	return true;
+}
+
+bool StagingRing::tryAllocate(uint32_t owner, VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& outAllocation)
+{
+	if (usedBytes == 0)
+	{
+		head = 0;
+		tail = 0;
+	}
+
+	bool wrapped = head < tail || (head == tail && usedBytes > 0);
+	VkDeviceSize offset = (head + alignment - 1) / alignment * alignment;
+	VkDeviceSize padding = 0;
+
+	if (wrapped)
+	{
+		if (offset + size > tail)
+		{
+			return false;
+		}
+	}
+	else if (offset + size > capacity)
+	{
+		if (size > tail)
+		{
+			return false;
+		}
+
+		// Skip the rest of the buffer, the padding is released along with this range
+		padding = capacity - head;
+		head = 0;
+		offset = 0;
+	}
+
+	VkDeviceSize consumed = padding + offset + size - head;
+	usedBytes += consumed;
+	head = offset + size;
+
+	if (!ranges.empty() && ranges.back().owner == owner && !ranges.back().retired)
+	{
+		ranges.back().end = head;
+		ranges.back().size += consumed;
+	}
+	else
+	{
+		RingRange range{};
+		range.end = head;
+		range.size = consumed;
+		range.owner = owner;
+		ranges.push_back(range);
+	}
+
+	outAllocation.buffer = buffer;
+	outAllocation.offset = offset;
+	outAllocation.size = size;
+	outAllocation.mapped = static_cast<char*>(memory.mapped) + offset;
+	return true;
+}
+
+void StagingRing::retire(uint32_t owner, VkFence fence)
+{
+	std::lock_guard<std::mutex> lock(ringMutex);
+
+	for (RingRange& range : ranges)
+	{
+		if (range.owner == owner && !range.retired)
+		{
+			range.retired = true;
+			range.fence = fence;
+		}
+	}
+}
+
+void StagingRing::reclaimFront()
+{
+	RingRange& range = ranges.front();
+	tail = range.end;
+	usedBytes -= range.size;
+	ranges.pop_front();
+
+	if (usedBytes == 0)
+	{
+		head = 0;
+		tail = 0;
+	}
+}
+
+void StagingRing::reclaimSignaled()
+{
+	while (!ranges.empty() && ranges.front().retired && isSignaled(ranges.front()))
+	{
+		reclaimFront();
+	}
+}
+
+bool StagingRing::isSignaled(const RingRange& range)
+{
+	return vkGetFenceStatus(device.getDevice(), range.fence) == VK_SUCCESS;
+}
+
+void StagingRing::waitFor(const RingRange& range)
+{
+	vkWaitForFences(device.getDevice(), 1, &range.fence, VK_TRUE, UINT64_MAX);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Device.h"
+
+#include <vulkan/vulkan.h>
+
+#include <deque>
+#include <mutex>
+
+struct StagingAllocation
+{
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	void* mapped = nullptr; // Points at the start of this range
+
+	bool isValid() const { return buffer != VK_NULL_HANDLE; }
+};
+
+/*
+ * A single persistently mapped, host coherent buffer that hands out copy source ranges in ring order
+ * for uploads. Every producer gets an owner token from createOwner() and allocates with it. Ranges are
+ * never freed individually: retire() tags everything the owner was handed since its previous retire
+ * with the fence of the submission that reads it, and that part of the ring is reused once the fence
+ * has signaled. Space is reused in ring order, so a range that hasn't been retired yet holds back
+ * everything allocated after it. Callers should retire right after the submission that consumes
+ * their ranges.
+ */
+class StagingRing
+{
+public:
+	StagingRing(Device& device, VkDeviceSize size);
+	~StagingRing();
+
+	StagingRing(const StagingRing&) = delete;
+	StagingRing& operator=(const StagingRing&) = delete;
+
+	uint32_t createOwner();
+
+	// Returns false if the range can't be handed out until more of the ring has been retired,
+	// or if wait is false and the space is still in use by the GPU
+	bool allocate(uint32_t owner, VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& outAllocation, bool wait = true);
+
+	// Only retires the ranges handed out to this owner
+	void retire(uint32_t owner, VkFence fence);
+
+	VkBuffer getBuffer() const { return buffer; }
+	VkDeviceSize getCapacity() const { return capacity; }
+	VkDeviceSize getUsedBytes() const { return usedBytes; }
+
+	static constexpr VkDeviceSize DEFAULT_SIZE = 32ull * 1024 * 1024;
+
+private:
+	struct RingRange
+	{
+		VkDeviceSize end; // Ring offset just past the last byte of the range
+		VkDeviceSize size; // Includes alignment and wrap-around padding
+		uint32_t owner;
+		bool retired = false;
+		VkFence fence = VK_NULL_HANDLE;
+	};
+
+	bool tryAllocate(uint32_t owner, VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& outAllocation);
+	void reclaimFront();
+	void reclaimSignaled();
+	bool isSignaled(const RingRange& range);
+	void waitFor(const RingRange& range);
+
+	Device& device;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	MemoryAllocation memory;
+	VkDeviceSize capacity;
+
+	// Live data runs from tail to head, wrapping around the end of the buffer
+	VkDeviceSize head = 0;
+	VkDeviceSize tail = 0;
+	VkDeviceSize usedBytes = 0;
+
+	// Every live range in ring order, retired or not. Consecutive allocations of one owner share a range.
+	std::deque<RingRange> ranges;
+	uint32_t nextOwner = 1;
+
+	std::mutex ringMutex;
+};
@@ -9,14 +9,16 @@
 #include <set>
 #include <stdexcept>
 
-SwapChain::SwapChain(Device& deviceRef, VkExtent2D windowExtent)
-    : device{deviceRef}, windowExtent{ windowExtent }
+SwapChain::SwapChain(Device& deviceRef, VkExtent2D windowExtent, uint32_t framesInFlight, VkPresentModeKHR requestedPresentMode)
+    : device{deviceRef}, windowExtent{ windowExtent }, requestedPresentMode{ requestedPresentMode }, framesInFlight{ framesInFlight }
 {
     init();
 }
 
-SwapChain::SwapChain(Device& deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previousSwapChain)
-    : device{ deviceRef }, windowExtent{ windowExtent }, oldSwapChain {previousSwapChain}
+SwapChain::SwapChain(Device& deviceRef, VkExtent2D windowExtent, uint32_t framesInFlight, VkPresentModeKHR requestedPresentMode,
+    std::shared_ptr<SwapChain> previousSwapChain)
+    : device{ deviceRef }, windowExtent{ windowExtent }, oldSwapChain {previousSwapChain}, requestedPresentMode{ requestedPresentMode },
+    framesInFlight{ framesInFlight }
 {
     init();
     oldSwapChain = nullptr;
@@ -39,23 +41,33 @@ SwapChain::~SwapChain()
         swapChain = nullptr;
     }
 
+    // Every frame from this swap chain has to finish before its sync objects go away
+    waitForFrames(0);
+
     // cleanup synchronization objects
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < framesInFlight; i++)
     {
         vkDestroySemaphore(device.getDevice(), renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(device.getDevice(), imageAvailableSemaphores[i], nullptr);
-        vkDestroyFence(device.getDevice(), inFlightFences[i], nullptr);
+    }
+    for (VkFence fence : inFlightFences)
+    {
+        vkDestroyFence(device.getDevice(), fence, nullptr);
+    }
+    if (frameTimeline != VK_NULL_HANDLE)
+    {
+        vkDestroySemaphore(device.getDevice(), frameTimeline, nullptr);
     }
 }
 
 VkResult SwapChain::acquireNextImage(uint32_t* imageIndex)
 {
-    vkWaitForFences(
-        device.getDevice(),
-        1,
-        &inFlightFences[currentFrame],
-        VK_TRUE,
-        std::numeric_limits<uint64_t>::max());
+    // The frame that last used this slot, framesInFlight submissions ago
+    if (submittedFrames >= framesInFlight)
+    {
+        waitForFrame(submittedFrames + 1 - framesInFlight);
+    }
+    updateInputLatency();
 
     VkResult result = vkAcquireNextImageKHR(
         device.getDevice(),
@@ -71,11 +83,12 @@ VkResult SwapChain::acquireNextImage(uint32_t* imageIndex)
 VkResult SwapChain::submitCommandBuffers(
     const VkCommandBuffer* buffers, uint32_t* imageIndex)
 {
-    if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE)
-    {
-        vkWaitForFences(device.getDevice(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
-    }
-    imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
+    // Images can come back in any order, so the image may still be used by a frame from another slot
+    waitForFrame(imageFrames[*imageIndex]);
+
+    uint64_t frameNumber = submittedFrames + 1;
+    imageFrames[*imageIndex] = frameNumber;
+    frameInputTimes[currentFrame] = inputTime;
 
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -89,17 +102,34 @@ VkResult SwapChain::submitCommandBuffers(
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = buffers;
 
-    VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
+    // The binary semaphore is for the present, the timeline one marks the frame as finished
+    VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame], frameTimeline };
+    uint64_t signalValues[] = { 0, frameNumber };
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    vkResetFences(device.getDevice(), 1, &inFlightFences[currentFrame]);
-    if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
-        VK_SUCCESS)
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    VkFence fence = VK_NULL_HANDLE;
+    if (usesTimelineSemaphore())
+    {
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.signalSemaphoreValueCount = 2;
+        timelineInfo.pSignalSemaphoreValues = signalValues;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.signalSemaphoreCount = 2;
+    }
+    else
+    {
+        fence = inFlightFences[currentFrame];
+        vkResetFences(device.getDevice(), 1, &fence);
+    }
+
+    if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, fence) != VK_SUCCESS)
     {
         CORE_CRITICAL("Failed to submit draw command buffer!")
         throw std::runtime_error("failed to submit draw command buffer!");
     }
+    submittedFrames = frameNumber;
 
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -115,17 +145,65 @@ VkResult SwapChain::submitCommandBuffers(
 
     auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
 
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    currentFrame = (currentFrame + 1) % framesInFlight;
 
     return result;
 }
 
+void SwapChain::waitForFrames(uint32_t framesAhead)
+{
+    if (submittedFrames > framesAhead)
+    {
+        waitForFrame(submittedFrames - framesAhead);
+    }
+    updateInputLatency();
+}
+
+void SwapChain::waitForFrame(uint64_t frameNumber)
+{
+    if (frameNumber == 0)
+        return;
+
+    if (usesTimelineSemaphore())
+    {
+        device.waitSemaphore(frameTimeline, frameNumber);
+        return;
+    }
+
+    // The slot's fence belongs to this frame or a later one, and the queue finishes them in order
+    VkFence fence = inFlightFences[(frameNumber - 1) % framesInFlight];
+    vkWaitForFences(device.getDevice(), 1, &fence, VK_TRUE, UINT64_MAX);
+}
+
+bool SwapChain::isFrameComplete(uint64_t frameNumber)
+{
+    if (frameNumber == 0)
+        return true;
+
+    if (usesTimelineSemaphore())
+        return device.getSemaphoreValue(frameTimeline) >= frameNumber;
+
+    return vkGetFenceStatus(device.getDevice(), inFlightFences[(frameNumber - 1) % framesInFlight]) == VK_SUCCESS;
+}
+
+void SwapChain::updateInputLatency()
+{
+    // Completion is only noticed here, so the value also includes however late this is called
+    auto now = std::chrono::high_resolution_clock::now();
+    while (measuredFrames < submittedFrames && isFrameComplete(measuredFrames + 1))
+    {
+        float latency = std::chrono::duration<float, std::milli>(now - frameInputTimes[measuredFrames % framesInFlight]).count();
+        inputLatency = inputLatency == 0.0f ? latency : inputLatency * 0.9f + latency * 0.1f;
+        measuredFrames++;
+    }
+}
+
 void SwapChain::createSwapChain()
 {
     SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+    presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
     uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -204,23 +282,52 @@ void SwapChain::createRenderPass()
 
 void SwapChain::createSyncObjects()
 {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+    if (framesInFlight < 1 || framesInFlight > MAX_FRAMES_IN_FLIGHT)
+    {
+        throw std::runtime_error("frames in flight out of range!");
+    }
+
+    imageAvailableSemaphores.resize(framesInFlight);
+    renderFinishedSemaphores.resize(framesInFlight);
+    frameInputTimes.resize(framesInFlight);
+    imageFrames.resize(imageCount(), 0);
 
     VkSemaphoreCreateInfo semaphoreInfo = {};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
+    for (size_t i = 0; i < framesInFlight; i++)
+    {
+        if (vkCreateSemaphore(device.getDevice(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
+            vkCreateSemaphore(device.getDevice(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create synchronization objects for a frame!");
+        }
+    }
+
+    if (device.supportsTimelineSemaphores())
+    {
+        VkSemaphoreTypeCreateInfo typeInfo = {};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo timelineInfo = semaphoreInfo;
+        timelineInfo.pNext = &typeInfo;
+        if (vkCreateSemaphore(device.getDevice(), &timelineInfo, nullptr, &frameTimeline) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create frame timeline semaphore!");
+        }
+        return;
+    }
+
     VkFenceCreateInfo fenceInfo = {};
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    inFlightFences.resize(framesInFlight);
+    for (size_t i = 0; i < framesInFlight; i++)
     {
-        if (vkCreateSemaphore(device.getDevice(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(device.getDevice(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(device.getDevice(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+        if (vkCreateFence(device.getDevice(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create synchronization objects for a frame!");
         }
@@ -245,19 +352,41 @@ VkSurfaceFormatKHR SwapChain::chooseSwapSurfaceFormat(
 VkPresentModeKHR SwapChain::chooseSwapPresentMode(
     const std::vector<VkPresentModeKHR>& availablePresentModes)
 {
-    /*for (const auto& availablePresentMode : availablePresentModes)
+    for (const auto& availablePresentMode : availablePresentModes)
     {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+        if (availablePresentMode == requestedPresentMode)
         {
-            std::cout << "Present mode: Mailbox" << std::endl;
+            CORE_INFO("Present Mode: {0}", getPresentModeName(availablePresentMode))
             return availablePresentMode;
         }
-    }*/
+    }
 
-    CORE_INFO("Present Mode: V-Sync")
+    if (requestedPresentMode != VK_PRESENT_MODE_FIFO_KHR)
+    {
+        CORE_WARN("Present mode {0} is not supported by the surface", getPresentModeName(requestedPresentMode))
+    }
+
+    CORE_INFO("Present Mode: {0}", getPresentModeName(VK_PRESENT_MODE_FIFO_KHR))
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+const char* SwapChain::getPresentModeName(VkPresentModeKHR mode)
+{
+    switch (mode)
+    {
+    case VK_PRESENT_MODE_FIFO_KHR:
+        return "FIFO (V-Sync)";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        return "FIFO Relaxed";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        return "Mailbox";
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return "Immediate";
+    default:
+        return "Unknown";
+    }
+}
+
 VkExtent2D SwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
 {
     if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max())
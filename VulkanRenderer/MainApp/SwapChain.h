@@ -5,17 +5,27 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <chrono>
 
 #include "Device.h"
 #include "RenderPass.h"
 
+/*
+ * Swap chain images plus the synchronization that paces frames. Each submission signals a timeline
+ * semaphore with its frame number, and a frame slot is reused once the frame that last used it has
+ * reached that value. Devices without timeline semaphores fall back to one fence per frame slot.
+ */
 class SwapChain
 {
 public:
-	static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
-
-    SwapChain(Device& deviceRef, VkExtent2D windowExtent);
-    SwapChain(Device& deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previousSwapChain);
+	// Upper bound for the runtime frames in flight, per-frame resources shared across the renderer are allocated for this many
+	static constexpr int MAX_FRAMES_IN_FLIGHT = 4;
+	static constexpr uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+    // The requested present mode is used when the surface supports it, otherwise FIFO, which always is
+    SwapChain(Device& deviceRef, VkExtent2D windowExtent, uint32_t framesInFlight, VkPresentModeKHR requestedPresentMode);
+    SwapChain(Device& deviceRef, VkExtent2D windowExtent, uint32_t framesInFlight, VkPresentModeKHR requestedPresentMode,
+        std::shared_ptr<SwapChain> previousSwapChain);
     ~SwapChain();
 
     SwapChain(const SwapChain&) = delete;
@@ -37,6 +47,21 @@ public:
     VkResult acquireNextImage(uint32_t* imageIndex);
     VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
 
+    // Blocks until no more than framesAhead submitted frames are still running on the GPU
+    void waitForFrames(uint32_t framesAhead);
+    // Frame numbers start at 1, 0 means no frame
+    uint64_t getSubmittedFrames() const { return submittedFrames; }
+    bool isFrameComplete(uint64_t frameNumber);
+    // Input for the next submitted frame was read now, its latency is measured from here
+    void markInputSampled() { inputTime = std::chrono::high_resolution_clock::now(); }
+
+    uint32_t getFramesInFlight() const { return framesInFlight; }
+    VkPresentModeKHR getPresentMode() const { return presentMode; }
+    static const char* getPresentModeName(VkPresentModeKHR mode);
+    bool usesTimelineSemaphore() const { return frameTimeline != VK_NULL_HANDLE; }
+    // Smoothed time from reading input to the GPU finishing the frame, in milliseconds
+    float getInputLatency() const { return inputLatency; }
+
     bool compareSwapFormats(const SwapChain& swapChain) const
     {
         return swapChain.swapChainDepthFormat == swapChainDepthFormat && swapChain.swapChainImageFormat == swapChainImageFormat;
@@ -49,6 +74,9 @@ private:
     void createRenderPass();
     void createSyncObjects();
 
+    void waitForFrame(uint64_t frameNumber);
+    void updateInputLatency();
+
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
     VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
@@ -65,10 +93,20 @@ private:
 
     VkSwapchainKHR swapChain;
     std::shared_ptr<SwapChain> oldSwapChain;
+    VkPresentModeKHR requestedPresentMode;
+    VkPresentModeKHR presentMode;
 
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
-    std::vector<VkFence> imagesInFlight;
+    std::vector<VkFence> inFlightFences; // Only used without timeline semaphores
+    std::vector<uint64_t> imageFrames; // Frame that last rendered to each image
+    VkSemaphore frameTimeline = VK_NULL_HANDLE;
+    uint32_t framesInFlight;
+    uint64_t submittedFrames = 0;
     size_t currentFrame = 0;
+
+    std::chrono::high_resolution_clock::time_point inputTime;
+    std::vector<std::chrono::high_resolution_clock::time_point> frameInputTimes; // Per frame slot
+    uint64_t measuredFrames = 0; // Frames whose latency has been taken
+    float inputLatency = 0.0f;
 };
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "Texture.h"
+#include "UploadContext.h"
 
 #include "imgui_impl_vulkan.h"
 #include "imgui_internal.h"
@@ -81,8 +82,10 @@ void Texture::createTextureSampler(Device& device)
 
 void Texture::cleanup(Device& device)
 {
+	device.getUploadContext().wait(uploadBatchId);
+
 	vkDestroySampler(device.getDevice(), textureSampler, nullptr);
 	vkDestroyImageView(device.getDevice(), textureImageView, nullptr);
 	vkDestroyImage(device.getDevice(), textureImage, nullptr);
-	vkFreeMemory(device.getDevice(), textureImageMemory, nullptr);
+	device.freeMemory(textureImageMemory);
 }
@@ -10,7 +10,7 @@ public:
 	~Texture();
 
 	VkImage& getTextureImage() { return textureImage; }
-	VkDeviceMemory& getTextureImageMemory() { return textureImageMemory; }
+	MemoryAllocation& getTextureImageMemory() { return textureImageMemory; }
 	VkImageView& getTextureImageView() { return textureImageView; }
 	VkSampler& getTextureSampler() { return textureSampler; }
 
@@ -26,9 +26,12 @@ public:
 	std::string& getNameInternal() { return nameInternal; }
 	void setNameInternal(std::string name) { nameInternal = name; }
 
+	void setUploadBatchId(uint64_t batchId) { uploadBatchId = batchId; }
+	uint64_t getUploadBatchId() { return uploadBatchId; }
+
 private:
 	VkImage textureImage;
-	VkDeviceMemory textureImageMemory;
+	MemoryAllocation textureImageMemory{};
 	VkImageView textureImageView;
 	VkSampler textureSampler;
 	VkFormat textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
@@ -39,4 +42,6 @@ private:
 	uint32_t mipLevel = 0;
 
 	std::string nameInternal = "";
+
+	uint64_t uploadBatchId = 0;
 };
\ No newline at end of file
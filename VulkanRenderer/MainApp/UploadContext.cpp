@@ -0,0 +1,488 @@
+#include "UploadContext.h"
+#include "Log.h"
+#include "StagingRing.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+UploadContext::UploadContext(Device& device)
+	: device{device}
+{
+	QueueFamilyIndices queueFamilyIndices = device.findPhysicalQueueFamilies();
+	graphicsFamily = queueFamilyIndices.graphicsFamily;
+	transferFamily = device.transferQueueFamily();
+	usesTransferQueue = device.hasDedicatedTransferQueue();
+
+	// Buffer to image copies need an offset that is a multiple of 4 and of the texel size
+	stagingAlignment = std::max<VkDeviceSize>(16, device.properties.limits.optimalBufferCopyOffsetAlignment);
+	stagingOwner = device.getStagingRing().createOwner();
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = transferFamily;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	if (vkCreateCommandPool(device.getDevice(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create upload command pool!");
+	}
+
+	if (usesTransferQueue)
+	{
+		poolInfo.queueFamilyIndex = graphicsFamily;
+		if (vkCreateCommandPool(device.getDevice(), &poolInfo, nullptr, &acquireCommandPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create upload acquire command pool!");
+		}
+	}
+}
+
+UploadContext::~UploadContext()
+{
+	waitIdle();
+
+	for (std::unique_ptr<UploadBatch>& batch : freeBatches)
+	{
+		vkDestroyFence(device.getDevice(), batch->fence, nullptr);
+		if (batch->transferCompleteSemaphore)
+		{
+			vkDestroySemaphore(device.getDevice(), batch->transferCompleteSemaphore, nullptr);
+		}
+	}
+
+	// Command buffers are freed along with the pools
+	vkDestroyCommandPool(device.getDevice(), commandPool, nullptr);
+	if (acquireCommandPool)
+	{
+		vkDestroyCommandPool(device.getDevice(), acquireCommandPool, nullptr);
+	}
+}
+
+uint64_t UploadContext::uploadBuffer(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset)
+{
+	std::lock_guard<std::recursive_mutex> lock(uploadMutex);
+
+	StagingAllocation staging = stageData(data, size);
+	UploadBatch& batch = getRecordingBatch();
+
+	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = staging.offset;
+	copyRegion.dstOffset = dstOffset;
+	copyRegion.size = size;
+	vkCmdCopyBuffer(batch.commandBuffer, staging.buffer, dstBuffer, 1, &copyRegion);
+
+	if (usesTransferQueue)
+	{
+		VkBufferMemoryBarrier ownershipBarrier{};
+		ownershipBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		ownershipBarrier.srcQueueFamilyIndex = transferFamily;
+		ownershipBarrier.dstQueueFamilyIndex = graphicsFamily;
+		ownershipBarrier.buffer = dstBuffer;
+		ownershipBarrier.offset = dstOffset;
+		ownershipBarrier.size = size;
+		batch.bufferOwnershipBarriers.push_back(ownershipBarrier);
+	}
+
+	return batch.id;
+}
+
+uint64_t UploadContext::uploadImage(const void* data, VkDeviceSize size, VkImage dstImage, uint32_t width, uint32_t height, uint32_t layerCount)
+{
+	std::lock_guard<std::recursive_mutex> lock(uploadMutex);
+
+	StagingAllocation staging = stageData(data, size);
+	UploadBatch& batch = getRecordingBatch();
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = dstImage;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = layerCount;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region{};
+	region.bufferOffset = staging.offset;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = layerCount;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { width, height, 1 };
+
+	vkCmdCopyBufferToImage(batch.commandBuffer, staging.buffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	if (usesTransferQueue)
+	{
+		// The layout transition happens as part of the queue family ownership transfer
+		barrier.srcQueueFamilyIndex = transferFamily;
+		barrier.dstQueueFamilyIndex = graphicsFamily;
+		batch.imageOwnershipBarriers.push_back(barrier);
+	}
+	else
+	{
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	return batch.id;
+}
+
+uint64_t UploadContext::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+{
+	std::lock_guard<std::recursive_mutex> lock(uploadMutex);
+
+	UploadBatch& batch = getRecordingBatch();
+
+	// Earlier uploads may have written the source, and later ones may write the same part of the destination
+	VkMemoryBarrier memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+	VkBufferCopy copyRegion{};
+	copyRegion.size = size;
+	vkCmdCopyBuffer(batch.commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+
+	vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+	if (usesTransferQueue)
+	{
+		VkBufferMemoryBarrier ownershipBarrier{};
+		ownershipBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		ownershipBarrier.srcQueueFamilyIndex = transferFamily;
+		ownershipBarrier.dstQueueFamilyIndex = graphicsFamily;
+		ownershipBarrier.buffer = dstBuffer;
+		ownershipBarrier.offset = 0;
+		ownershipBarrier.size = size;
+		batch.bufferOwnershipBarriers.push_back(ownershipBarrier);
+	}
+
+	batch.copyCount++;
+	batch.byteCount += size;
+	return batch.id;
+}
+
+/*
+ * Submits everything recorded since the last submit. Returns the id of the submitted batch, or the
+ * last submitted id if there was nothing to do.
+ */
+uint64_t UploadContext::submit()
+{
+	std::lock_guard<std::recursive_mutex> lock(uploadMutex);
+
+	if (!recordingBatch)
+	{
+		return nextBatchId - 1;
+	}
+
+	if (usesTransferQueue)
+	{
+		recordOwnershipTransfers(*recordingBatch);
+
+		VkSubmitInfo transferSubmitInfo{};
+		transferSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		transferSubmitInfo.commandBufferCount = 1;
+		transferSubmitInfo.pCommandBuffers = &recordingBatch->commandBuffer;
+		transferSubmitInfo.signalSemaphoreCount = 1;
+		transferSubmitInfo.pSignalSemaphores = &recordingBatch->transferCompleteSemaphore;
+
+		if (vkQueueSubmit(device.transferQueue(), 1, &transferSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to submit upload batch to the transfer queue!");
+		}
+
+		// The acquire half runs on the graphics queue, so later frames are ordered after it
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+		VkSubmitInfo acquireSubmitInfo{};
+		acquireSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		acquireSubmitInfo.waitSemaphoreCount = 1;
+		acquireSubmitInfo.pWaitSemaphores = &recordingBatch->transferCompleteSemaphore;
+		acquireSubmitInfo.pWaitDstStageMask = &waitStage;
+		acquireSubmitInfo.commandBufferCount = 1;
+		acquireSubmitInfo.pCommandBuffers = &recordingBatch->acquireCommandBuffer;
+
+		vkResetFences(device.getDevice(), 1, &recordingBatch->fence);
+		if (vkQueueSubmit(device.graphicsQueue(), 1, &acquireSubmitInfo, recordingBatch->fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to submit upload acquire batch!");
+		}
+	}
+	else
+	{
+		// Make the copies visible to any vertex, index or shader reads submitted after this batch
+		VkMemoryBarrier memoryBarrier{};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(recordingBatch->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+		vkEndCommandBuffer(recordingBatch->commandBuffer);
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &recordingBatch->commandBuffer;
+
+		vkResetFences(device.getDevice(), 1, &recordingBatch->fence);
+		if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, recordingBatch->fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to submit upload batch!");
+		}
+	}
+
+	device.getStagingRing().retire(stagingOwner, recordingBatch->fence);
+
+	CORE_INFO("Submitted upload batch {0}: {1} copies, {2:.2f} MB", recordingBatch->id, recordingBatch->copyCount, recordingBatch->byteCount / (1024.0 * 1024.0))
+
+	uint64_t batchId = recordingBatch->id;
+	inFlightBatches.push_back(std::move(recordingBatch));
+
+	return batchId;
+}
+
+/*
+ * Called once per frame, submits any pending uploads and releases staging memory of finished batches
+ */
+void UploadContext::update()
+{
+	std::lock_guard<std::recursive_mutex> lock(uploadMutex);
+
+	submit();
+	collectCompletedBatches(false);
+}
+
+bool UploadContext::isComplete(uint64_t batchId)
+{
+	std::lock_guard<std::recursive_mutex> lock(uploadMutex);
+
+	collectCompletedBatches(false);
+	return batchId <= completedBatchId;
+}
+
+void UploadContext::wait(uint64_t batchId)
+{
+	std::lock_guard<std::recursive_mutex> lock(uploadMutex);
+
+	if (recordingBatch && batchId >= recordingBatch->id)
+	{
+		submit();
+	}
+
+	while (batchId > completedBatchId && !inFlightBatches.empty())
+	{
+		UploadBatch& batch = *inFlightBatches.front();
+		vkWaitForFences(device.getDevice(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+		collectCompletedBatches(false);
+	}
+}
+
+void UploadContext::waitIdle()
+{
+	std::lock_guard<std::recursive_mutex> lock(uploadMutex);
+
+	submit();
+	collectCompletedBatches(true);
+}
+
+UploadContext::UploadBatch& UploadContext::getRecordingBatch()
+{
+	if (recordingBatch)
+	{
+		return *recordingBatch;
+	}
+
+	if (!freeBatches.empty())
+	{
+		recordingBatch = std::move(freeBatches.back());
+		freeBatches.pop_back();
+		vkResetCommandBuffer(recordingBatch->commandBuffer, 0);
+		if (recordingBatch->acquireCommandBuffer)
+		{
+			vkResetCommandBuffer(recordingBatch->acquireCommandBuffer, 0);
+		}
+	}
+	else
+	{
+		recordingBatch = std::make_unique<UploadBatch>();
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = commandPool;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(device.getDevice(), &allocInfo, &recordingBatch->commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate upload command buffer!");
+		}
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		if (vkCreateFence(device.getDevice(), &fenceInfo, nullptr, &recordingBatch->fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create upload fence!");
+		}
+
+		if (usesTransferQueue)
+		{
+			allocInfo.commandPool = acquireCommandPool;
+			if (vkAllocateCommandBuffers(device.getDevice(), &allocInfo, &recordingBatch->acquireCommandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate upload acquire command buffer!");
+			}
+
+			VkSemaphoreCreateInfo semaphoreInfo{};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+			if (vkCreateSemaphore(device.getDevice(), &semaphoreInfo, nullptr, &recordingBatch->transferCompleteSemaphore) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create upload semaphore!");
+			}
+		}
+	}
+
+	recordingBatch->id = nextBatchId++;
+	recordingBatch->copyCount = 0;
+	recordingBatch->byteCount = 0;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(recordingBatch->commandBuffer, &beginInfo);
+	return *recordingBatch;
+}
+
+/*
+ * Copies data into the device's staging ring. Uploads that don't fit in the ring at all get a
+ * temporary staging buffer owned by the batch instead.
+ */
+StagingAllocation UploadContext::stageData(const void* data, VkDeviceSize size)
+{
+	StagingRing& stagingRing = device.getStagingRing();
+	StagingAllocation staging;
+
+	if (size <= stagingRing.getCapacity() && !stagingRing.allocate(stagingOwner, size, stagingAlignment, staging, false))
+	{
+		// The rest of the ring is taken by the batch being recorded, submit it so its range can be retired
+		submit();
+		stagingRing.allocate(stagingOwner, size, stagingAlignment, staging);
+	}
+
+	UploadBatch& batch = getRecordingBatch();
+
+	if (!staging.isValid())
+	{
+		// Staging memory stays alive until the batch's fence has signaled
+		batch.stagingBuffers.push_back(std::make_unique<Buffer>(device, size, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 1, ALLOCATION_STRATEGY_LINEAR));
+
+		Buffer& stagingBuffer = *batch.stagingBuffers.back();
+		stagingBuffer.map();
+		staging.buffer = stagingBuffer.getBuffer();
+		staging.size = size;
+		staging.mapped = stagingBuffer.getMappedMemory();
+	}
+
+	memcpy(staging.mapped, data, size);
+
+	batch.copyCount++;
+	batch.byteCount += size;
+	return staging;
+}
+
+/*
+ * Records the release half of every queue family ownership transfer at the end of the transfer
+ * command buffer, and the matching acquire half into the batch's graphics command buffer
+ */
+void UploadContext::recordOwnershipTransfers(UploadBatch& batch)
+{
+	for (VkBufferMemoryBarrier& barrier : batch.bufferOwnershipBarriers)
+	{
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+	}
+	for (VkImageMemoryBarrier& barrier : batch.imageOwnershipBarriers)
+	{
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+	}
+
+	vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+		0, nullptr,
+		(uint32_t)batch.bufferOwnershipBarriers.size(), batch.bufferOwnershipBarriers.data(),
+		(uint32_t)batch.imageOwnershipBarriers.size(), batch.imageOwnershipBarriers.data());
+
+	vkEndCommandBuffer(batch.commandBuffer);
+
+	for (VkBufferMemoryBarrier& barrier : batch.bufferOwnershipBarriers)
+	{
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	}
+	for (VkImageMemoryBarrier& barrier : batch.imageOwnershipBarriers)
+	{
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	}
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(batch.acquireCommandBuffer, &beginInfo);
+	vkCmdPipelineBarrier(batch.acquireCommandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+		0, nullptr,
+		(uint32_t)batch.bufferOwnershipBarriers.size(), batch.bufferOwnershipBarriers.data(),
+		(uint32_t)batch.imageOwnershipBarriers.size(), batch.imageOwnershipBarriers.data());
+	vkEndCommandBuffer(batch.acquireCommandBuffer);
+
+	batch.bufferOwnershipBarriers.clear();
+	batch.imageOwnershipBarriers.clear();
+}
+
+void UploadContext::collectCompletedBatches(bool wait)
+{
+	while (!inFlightBatches.empty())
+	{
+		std::unique_ptr<UploadBatch>& batch = inFlightBatches.front();
+
+		VkResult result = wait ? vkWaitForFences(device.getDevice(), 1, &batch->fence, VK_TRUE, UINT64_MAX) : vkGetFenceStatus(device.getDevice(), batch->fence);
+		if (result != VK_SUCCESS)
+		{
+			break;
+		}
+
+		completedBatchId = batch->id;
+		batch->stagingBuffers.clear();
+
+		freeBatches.push_back(std::move(batch));
+		inFlightBatches.pop_front();
+	}
+}
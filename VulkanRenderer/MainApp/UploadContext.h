@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Buffer.h"
+#include "StagingRing.h"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+/*
+ * Batches staging copies into a single command buffer that is submitted with a fence, so asset
+ * creation only records work instead of waiting on the queue. A trailing barrier makes the
+ * uploaded data visible to anything submitted to the queue afterwards, so frames never have to
+ * wait on the CPU for an upload to land. Source data is staged in the device's staging ring, and
+ * the ring range is retired with the batch's fence.
+ *
+ * When the device has a dedicated transfer queue the copies run there. Every uploaded resource is
+ * released to the graphics family at the end of the batch, and a small acquire command buffer on
+ * the graphics queue waits on the transfer submission's semaphore before taking ownership.
+ */
+class UploadContext
+{
+public:
+	UploadContext(Device& device);
+	~UploadContext();
+
+	UploadContext(const UploadContext&) = delete;
+	UploadContext& operator=(const UploadContext&) = delete;
+
+	// Both return the id of the batch the copy was recorded into
+	uint64_t uploadBuffer(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+	uint64_t uploadImage(const void* data, VkDeviceSize size, VkImage dstImage, uint32_t width, uint32_t height, uint32_t layerCount = 1);
+	// Copies between device buffers, ordered after every copy recorded or submitted before it
+	uint64_t copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+
+	uint64_t submit();
+	void update();
+
+	bool isComplete(uint64_t batchId);
+	void wait(uint64_t batchId);
+	void waitIdle();
+
+	uint64_t getCompletedBatchId() const { return completedBatchId; }
+	uint32_t getPendingBatchCount() const { return (uint32_t)inFlightBatches.size(); }
+
+private:
+	struct UploadBatch
+	{
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE; // Only used with a dedicated transfer queue
+		VkSemaphore transferCompleteSemaphore = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+		uint64_t id = 0;
+		uint32_t copyCount = 0;
+		VkDeviceSize byteCount = 0;
+		std::vector<std::unique_ptr<Buffer>> stagingBuffers; // Only for uploads larger than the staging ring
+
+		std::vector<VkBufferMemoryBarrier> bufferOwnershipBarriers;
+		std::vector<VkImageMemoryBarrier> imageOwnershipBarriers;
+	};
+
+	UploadBatch& getRecordingBatch();
+	StagingAllocation stageData(const void* data, VkDeviceSize size);
+	void recordOwnershipTransfers(UploadBatch& batch);
+	void collectCompletedBatches(bool wait);
+
+	Device& device;
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	VkCommandPool acquireCommandPool = VK_NULL_HANDLE;
+
+	bool usesTransferQueue = false;
+	uint32_t transferFamily;
+	uint32_t graphicsFamily;
+	VkDeviceSize stagingAlignment = 16;
+	uint32_t stagingOwner = 0; // Token for this context's ranges in the staging ring
+
+	std::unique_ptr<UploadBatch> recordingBatch;
+	std::deque<std::unique_ptr<UploadBatch>> inFlightBatches;
+	std::vector<std::unique_ptr<UploadBatch>> freeBatches;
+
+	uint64_t nextBatchId = 1;
+	uint64_t completedBatchId = 0;
+
+	std::recursive_mutex uploadMutex;
+};
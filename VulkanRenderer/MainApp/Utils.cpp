@@ -1,6 +1,7 @@
 #include "Utils.h"
 
 #include "Buffer.h"
+#include "UploadContext.h"
 #include "Application.h"
 
 #include <stb_image.h>
@@ -12,31 +13,47 @@
 //#define GLFW_EXPOSE_NATIVE_WIN32
 //#include <glfw3native.h>
 
-bool Utils::loadImageFromFile(Device& device, const char* filepath, Texture& outTexture, VkFormat format)
+uint64_t Utils::hashBytes(const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+bool Utils::decodeImage(const char* filepath, DecodedImage& outImage)
 {
-	int width, height, channels;
-	stbi_uc* pixels = stbi_load(filepath, &width, &height, &channels, STBI_rgb_alpha);
+	int channels;
+	outImage.pixels = stbi_load(filepath, &outImage.width, &outImage.height, &channels, STBI_rgb_alpha);
 
-	if (!pixels)
+	if (!outImage.pixels)
 	{
 		printf("Failed to load texture from file: %s", filepath);
 		return false;
 	}
 
-	void* pixelPtr = pixels;
-	VkDeviceSize imageSize = width * height * 4;
-	VkFormat imageFormat = format;
+	return true;
+}
 
-	Buffer stagingBuffer(device, imageSize, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	stagingBuffer.map();
-	stagingBuffer.writeToBuffer(pixelPtr, imageSize);
-	stagingBuffer.unmap();
+void Utils::freeImage(DecodedImage& image)
+{
+	stbi_image_free(image.pixels);
+	image.pixels = nullptr;
+}
 
-	stbi_image_free(pixels);
+void Utils::uploadImage(Device& device, const DecodedImage& image, Texture& outTexture, VkFormat format)
+{
+	void* pixelPtr = image.pixels;
+	VkDeviceSize imageSize = image.width * image.height * 4;
+	VkFormat imageFormat = format;
 
 	VkExtent3D imageExtent;
-	imageExtent.width = static_cast<uint32_t>(width);
-	imageExtent.height = static_cast<uint32_t>(height);
+	imageExtent.width = static_cast<uint32_t>(image.width);
+	imageExtent.height = static_cast<uint32_t>(image.height);
 	imageExtent.depth = 1;
 
 	VkImageCreateInfo imgInfo{};
@@ -54,9 +71,20 @@ bool Utils::loadImageFromFile(Device& device, const char* filepath, Texture& out
 	imgInfo.flags = 0;
 
 	device.createImageWithInfo(imgInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, outTexture.getTextureImage(), outTexture.getTextureImageMemory());
-	device.transitionImageLayout(outTexture.getTextureImage(), imageFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	device.copyBufferToImage(stagingBuffer.getBuffer(), outTexture.getTextureImage(), static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1);
-	device.transitionImageLayout(outTexture.getTextureImage(), imageFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	// The upload context copies the pixels into staging memory, so they can be freed right after
+	uint64_t batchId = device.getUploadContext().uploadImage(pixelPtr, imageSize, outTexture.getTextureImage(), imageExtent.width, imageExtent.height);
+	outTexture.setUploadBatchId(batchId);
+}
+
+bool Utils::loadImageFromFile(Device& device, const char* filepath, Texture& outTexture, VkFormat format)
+{
+	DecodedImage image;
+	if (!decodeImage(filepath, image))
+		return false;
+
+	uploadImage(device, image, outTexture, format);
+	freeImage(image);
 
 	return true;
 }
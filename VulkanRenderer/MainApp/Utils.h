@@ -15,6 +15,23 @@ namespace Utils
 		(hashCombine(seed, rest), ...);
 	};
 
+	// 64-bit FNV-1a, stable across runs and platforms so it can be stored on disk
+	uint64_t hashBytes(const void* data, size_t size);
+
+	// RGBA8 pixels decoded from an image file, owned until freeImage()
+	struct DecodedImage
+	{
+		unsigned char* pixels = nullptr;
+		int width = 0;
+		int height = 0;
+	};
+
+	// Decoding touches no Vulkan state, so it can run on any thread
+	bool decodeImage(const char* filepath, DecodedImage& outImage);
+	void freeImage(DecodedImage& image);
+	// Creates the texture's image and queues the pixels for upload, from the thread that owns the device
+	void uploadImage(Device& device, const DecodedImage& image, Texture& outTexture, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB);
+
 	bool loadImageFromFile(Device& device, const char* filepath, Texture& outTexture, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB);
 
 	std::string getCPUName();
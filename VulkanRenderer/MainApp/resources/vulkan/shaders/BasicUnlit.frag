@@ -4,31 +4,52 @@
 
 layout (location = 0) in vec3 fragColor;
 layout (location = 3) in vec2 texCoord;
+layout (location = 6) flat in uint fragObjectIndex;
 
 layout (location = 0) out vec4 outColor;
 
-layout (push_constant) uniform Push
-{ 
+struct ObjectData
+{
 	mat4 modelMatrix;
 	mat4 normalMatrix;
-	uint textureIndex;
-	uint toggleTexture;
-}push;
+	uint materialIndex;
+	uint commandIndex;
+	vec4 boundingSphere;
+};
+
+layout (std430, set = 0, binding = 2) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
+layout(set = 1, binding = 0) uniform sampler2D textures[];
 
-layout(set = 1, binding = 0) uniform sampler2D texSampler[];
+const uint TEXTURE_ALBEDO = 0;
+const uint INVALID_TEXTURE = 0xFFFFFFFF;
 
-layout (set = 1, binding = 6) uniform MaterialUbo
+struct MaterialData
 {
 	vec4 albedo;
 	float roughness;
 	float ambientOcclusion;
 	float metallic;
-} matUbo;
+	uint toggleTexture;
+	uint textureIndices[6];
+};
+
+layout (std430, set = 1, binding = 1) readonly buffer MaterialBuffer
+{
+	MaterialData materials[];
+};
 
 void main()
 {
-	if(push.toggleTexture == 1)
-		outColor = vec4(fragColor * texture(texSampler[push.textureIndex], texCoord).rgb, 1.0);
+	ObjectData object = objects[fragObjectIndex];
+	MaterialData material = materials[object.materialIndex];
+
+	uint albedoIndex = material.textureIndices[TEXTURE_ALBEDO];
+	if(material.toggleTexture == 1 && albedoIndex != INVALID_TEXTURE)
+		outColor = vec4(fragColor * texture(textures[nonuniformEXT(albedoIndex)], texCoord).rgb, 1.0);
 	else
-		outColor = matUbo.albedo;
+		outColor = material.albedo;
 }
\ No newline at end of file
@@ -10,6 +10,7 @@ layout (location = 5) in vec3 aBitangent;
 
 layout (location = 0) out vec3 fragColor;
 layout (location = 3) out vec2 texCoord;
+layout (location = 6) flat out uint fragObjectIndex;
 
 layout (set = 0, binding = 0) uniform GlobalUbo
 {
@@ -18,16 +19,31 @@ layout (set = 0, binding = 0) uniform GlobalUbo
 	mat4 invView;
 } ubo;
 
-layout (push_constant) uniform Push
-{ 
+struct ObjectData
+{
 	mat4 modelMatrix;
 	mat4 normalMatrix;
-}push;
+	uint materialIndex;
+	uint commandIndex;
+	vec4 boundingSphere;
+};
+
+layout (std430, set = 0, binding = 2) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
+layout (std430, set = 0, binding = 3) readonly buffer VisibleBuffer
+{
+	uint visibleIndices[];
+};
 
 void main()
 {
-	vec4 postitionWorld = push.modelMatrix * vec4(aPosition, 1.0f);
+	uint objectIndex = visibleIndices[gl_InstanceIndex];
+	vec4 postitionWorld = objects[objectIndex].modelMatrix * vec4(aPosition, 1.0f);
 	gl_Position = ubo.projection * ubo.view * postitionWorld;
 	fragColor = aColor;
 	texCoord = aTexCoord;
+	fragObjectIndex = objectIndex;
 }
\ No newline at end of file
@@ -10,9 +10,19 @@ layout (location = 2) in vec3 fragNormalWorld;
 layout (location = 3) in vec2 texCoord;
 layout (location = 4) in vec3 fragTangent;
 layout (location = 5) in vec3 fragBitangent;
+layout (location = 6) flat in uint fragObjectIndex;
 
 layout (location = 0) out vec4 outColor;
 
+// Set per pipeline permutation from the material's features and the scene's light count, the
+// defaults are the full shader that can draw any material
+layout (constant_id = 0) const bool TEXTURED = true; // Albedo, roughness and AO maps
+layout (constant_id = 1) const bool NORMAL_MAP = true;
+layout (constant_id = 2) const bool PARALLAX = true;
+layout (constant_id = 3) const bool METALLIC_MAP = true;
+layout (constant_id = 4) const int MAX_POINT_LIGHTS = 10;
+layout (constant_id = 5) const int MAX_SPOT_LIGHTS = 10;
+
 struct PointLight
 {
 	vec4 position;
@@ -52,29 +62,48 @@ layout (set = 0, binding = 1) uniform LightUbo
 	int numSpotLights;
 } lightUbo;
 
-//TODO: Add metalic map
-layout(set = 1, binding = 0) uniform sampler2D diffuseMap[];
-layout(set = 1, binding = 1) uniform sampler2D normalMap[];
-layout(set = 1, binding = 2) uniform sampler2D roughnessMap[];
-layout(set = 1, binding = 3) uniform sampler2D aoMap[];
-layout(set = 1, binding = 4) uniform sampler2D heightMap[];
-layout(set = 1, binding = 5) uniform sampler2D metallicMap[];
+struct ObjectData
+{
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+	uint materialIndex;
+	uint commandIndex;
+	vec4 boundingSphere;
+};
+
+layout (std430, set = 0, binding = 2) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
+// Every material's maps, indexed through MaterialData.textureIndices
+layout(set = 1, binding = 0) uniform sampler2D textures[];
 
-layout (set = 1, binding = 6) uniform MaterialUbo
+const uint TEXTURE_ALBEDO = 0;
+const uint TEXTURE_NORMAL = 1;
+const uint TEXTURE_ROUGHNESS = 2;
+const uint TEXTURE_AO = 3;
+const uint TEXTURE_HEIGHT = 4;
+const uint TEXTURE_METALLIC = 5;
+const uint INVALID_TEXTURE = 0xFFFFFFFF;
+
+struct MaterialData
 {
 	vec4 albedo;
 	float roughness;
 	float ambientOcclusion;
 	float metallic;
-} matUbo;
-
-layout (push_constant) uniform Push
-{ 
-	mat4 modelMatrix;
-	mat4 normalMatrix;
-	uint textureIndex;
 	uint toggleTexture;
-}push;
+	uint textureIndices[6];
+};
+
+layout (std430, set = 1, binding = 1) readonly buffer MaterialBuffer
+{
+	MaterialData materials[];
+};
+
+ObjectData object;
+MaterialData material;
 
 const float SPECULAR_POWER = 512.0;
 const float PARALAX_HEIGHT_SCALE = 0.05;
@@ -161,13 +190,16 @@ vec3 calculateNormal(vec2 uv)
 {
 	vec3 result;
 
+	if(material.textureIndices[TEXTURE_NORMAL] == INVALID_TEXTURE)
+		return fragNormalWorld;
+
 	// get TBN basis vectors
 	vec3 normal = fragNormalWorld;
 	vec3 tangent = fragTangent;
 	vec3 bitangent = fragBitangent;
 
 	// sample normal map and bring range to [-1.0, 1.0]
-	vec3 normalMapNormal = 2.0 * texture(normalMap[push.textureIndex], uv).xyz - 1.0;
+	vec3 normalMapNormal = 2.0 * texture(textures[nonuniformEXT(material.textureIndices[TEXTURE_NORMAL])], uv).xyz - 1.0;
 
 	// construct TBN matrix
 	mat3 TBN = mat3(tangent, bitangent, normal);
@@ -180,6 +212,9 @@ vec3 calculateNormal(vec2 uv)
 
 vec2 calculateParalaxTexCoords(vec2 uv, vec3 viewDir)
 {
+	if(material.textureIndices[TEXTURE_HEIGHT] == INVALID_TEXTURE)
+		return uv;
+
 	float heightScale = PARALAX_HEIGHT_SCALE;
 	const float minLayers = 8.0;
 	const float maxLayers = 64.0;
@@ -193,7 +228,7 @@ vec2 calculateParalaxTexCoords(vec2 uv, vec3 viewDir)
 	vec2 S = viewDir.xy * heightScale;
 	vec2 deltaUV = S / numLayers;
 
-	float currentDepthMapValue = 1.0 - texture(heightMap[push.textureIndex], uv).r;
+	float currentDepthMapValue = 1.0 - texture(textures[nonuniformEXT(material.textureIndices[TEXTURE_HEIGHT])], uv).r;
 
 	vec2 UVs = uv;
 
@@ -201,14 +236,14 @@ vec2 calculateParalaxTexCoords(vec2 uv, vec3 viewDir)
 	while(currentLayerDepth < currentDepthMapValue)
 	{
 		UVs -= deltaUV;
-		currentDepthMapValue = 1.0 - texture(heightMap[push.textureIndex], UVs).r;
+		currentDepthMapValue = 1.0 - texture(textures[nonuniformEXT(material.textureIndices[TEXTURE_HEIGHT])], UVs).r;
 		currentLayerDepth += layerDepth;
 	}
 
 	// Apply occlusion (interpolate w/ prev uvs)
 	vec2 prevUVs = UVs + deltaUV;
 	float afterDepth = currentDepthMapValue - currentLayerDepth;
-	float beforeDepth = 1.0 - texture(heightMap[push.textureIndex], prevUVs).r - currentLayerDepth + layerDepth;
+	float beforeDepth = 1.0 - texture(textures[nonuniformEXT(material.textureIndices[TEXTURE_HEIGHT])], prevUVs).r - currentLayerDepth + layerDepth;
 	float weight = afterDepth / (afterDepth - beforeDepth);
 	UVs = prevUVs * weight + UVs * (1.0 - weight);
 
@@ -221,6 +256,9 @@ vec2 calculateParalaxTexCoords(vec2 uv, vec3 viewDir)
 
 void main()
 {
+	object = objects[fragObjectIndex];
+	material = materials[object.materialIndex];
+
 	vec2 uv = texCoord;
 
 	vec3 cameraPosWorld = inverse(ubo.view)[3].xyz;
@@ -230,23 +268,36 @@ void main()
 	vec3 L = vec3(0.0); // light vector
 	vec3 H = vec3(0.0); // halfway vector
 
-	if(push.toggleTexture == 1)
-	{
-		albedo = pow(texture(diffuseMap[push.textureIndex], uv).rgb, vec3(2.2));
-		roughness = texture(roughnessMap[push.textureIndex], uv).r;
-		ao = texture(aoMap[push.textureIndex], uv).r;
-		metallic = texture(metallicMap[push.textureIndex], uv).r;
+	albedo = material.albedo.xyz;
+	roughness = material.roughness;
+	ao = material.ambientOcclusion;
+	metallic = material.metallic;
+	N = fragNormalWorld;
 
-		N = calculateNormal(uv);
-	}
-	else
+	// Missing maps fall back to the material's constants. Features the permutation doesn't have are
+	// compiled out, the index checks remain for the full shader.
+	if(material.toggleTexture == 1)
 	{
-		albedo = matUbo.albedo.xyz;
-		roughness = matUbo.roughness;
-		ao = matUbo.ambientOcclusion;
-		metallic = matUbo.metallic;
+		if(PARALLAX)
+		{
+			mat3 TBN = mat3(fragTangent, fragBitangent, fragNormalWorld);
+			uv = calculateParalaxTexCoords(uv, normalize(transpose(TBN) * V));
+		}
+
+		if(TEXTURED)
+		{
+			if(material.textureIndices[TEXTURE_ALBEDO] != INVALID_TEXTURE)
+				albedo = pow(texture(textures[nonuniformEXT(material.textureIndices[TEXTURE_ALBEDO])], uv).rgb, vec3(2.2));
+			if(material.textureIndices[TEXTURE_ROUGHNESS] != INVALID_TEXTURE)
+				roughness = texture(textures[nonuniformEXT(material.textureIndices[TEXTURE_ROUGHNESS])], uv).r;
+			if(material.textureIndices[TEXTURE_AO] != INVALID_TEXTURE)
+				ao = texture(textures[nonuniformEXT(material.textureIndices[TEXTURE_AO])], uv).r;
+		}
+		if(METALLIC_MAP && material.textureIndices[TEXTURE_METALLIC] != INVALID_TEXTURE)
+			metallic = texture(textures[nonuniformEXT(material.textureIndices[TEXTURE_METALLIC])], uv).r;
 
-		N = fragNormalWorld;
+		if(NORMAL_MAP)
+			N = calculateNormal(uv);
 	}
 
 	vec3 Lo = vec3(0.0);
@@ -259,7 +310,7 @@ void main()
 	Lo += calculateLighting(V, N, L, H, albedo, lightUbo.directionalLight.color);
 
 	// point lights
-	for(int i = 0; i < lightUbo.numLights; i++)
+	for(int i = 0; i < min(lightUbo.numLights, MAX_POINT_LIGHTS); i++)
 	{
 		PointLight pointLight = lightUbo.pointLights[i];
 		L = pointLight.position.xyz - fragPosWorld;
@@ -270,7 +321,7 @@ void main()
 	}
 
 	// spot lights
-	for(int j = 0; j < lightUbo.numSpotLights; j++)
+	for(int j = 0; j < min(lightUbo.numSpotLights, MAX_SPOT_LIGHTS); j++)
 	{
 		SpotLight spotLight = lightUbo.spotLights[j];
 		L = spotLight.position.xyz - fragPosWorld;
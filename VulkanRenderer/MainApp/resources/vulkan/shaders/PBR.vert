@@ -14,6 +14,7 @@ layout (location = 2) out vec3 fragNormalWorld;
 layout (location = 3) out vec2 texCoord;
 layout (location = 4) out vec3 fragTangent;
 layout (location = 5) out vec3 fragBitangent;
+layout (location = 6) flat out uint fragObjectIndex;
 
 layout (set = 0, binding = 0) uniform GlobalUbo
 {
@@ -22,31 +23,41 @@ layout (set = 0, binding = 0) uniform GlobalUbo
 	mat4 invView;
 } ubo;
 
-layout (set = 1, binding = 5) uniform MaterialUbo
+struct ObjectData
 {
-	vec4 albedo;
-	float roughness;
-	float ambientOcclusion;
-} matUbo;
-
-layout (push_constant) uniform Push
-{ 
 	mat4 modelMatrix;
 	mat4 normalMatrix;
-	uint textureIndex;
-	uint toggleTexture;
-}push;
+	uint materialIndex;
+	uint commandIndex;
+	vec4 boundingSphere;
+};
+
+layout (std430, set = 0, binding = 2) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
+layout (std430, set = 0, binding = 3) readonly buffer VisibleBuffer
+{
+	uint visibleIndices[];
+};
 
 void main()
 {
-	vec4 postitionWorld = push.modelMatrix * vec4(aPosition, 1.0f);
+	// firstInstance of each indirect command points at its slots in the visible index buffer
+	uint objectIndex = visibleIndices[gl_InstanceIndex];
+	mat4 modelMatrix = objects[objectIndex].modelMatrix;
+	mat4 normalMatrix = objects[objectIndex].normalMatrix;
+
+	vec4 postitionWorld = modelMatrix * vec4(aPosition, 1.0f);
 	gl_Position = ubo.projection * ubo.view * postitionWorld;
 
-	fragNormalWorld = normalize((push.normalMatrix * vec4(aNormal, 0.0)).xyz);
+	fragNormalWorld = normalize((normalMatrix * vec4(aNormal, 0.0)).xyz);
 	fragPosWorld = postitionWorld.xyz;
 	fragColor = aColor;
 	texCoord = aTexCoord;
+	fragObjectIndex = objectIndex;
 
-	fragTangent = normalize((push.normalMatrix * vec4(aTangent, 0.0)).xyz);
-	fragBitangent = normalize((push.normalMatrix * vec4(aBitangent, 0.0)).xyz);
+	fragTangent = normalize((normalMatrix * vec4(aTangent, 0.0)).xyz);
+	fragBitangent = normalize((normalMatrix * vec4(aBitangent, 0.0)).xyz);
 }
\ No newline at end of file
@@ -24,13 +24,26 @@ layout (set = 0, binding = 0) uniform GlobalUbo
 	int numLights;
 } ubo;
 
-layout (push_constant) uniform Push
-{ 
+struct ObjectData
+{
 	mat4 modelMatrix;
 	mat4 normalMatrix;
-}push;
+	uint materialIndex;
+	uint commandIndex;
+	vec4 boundingSphere;
+};
+
+layout (std430, set = 0, binding = 2) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
+layout (std430, set = 0, binding = 3) readonly buffer VisibleBuffer
+{
+	uint visibleIndices[];
+};
 
 void main() {
-   vec4 postitionWorld = push.modelMatrix * vec4(aPosition, 1.0f);
+   vec4 postitionWorld = objects[visibleIndices[gl_InstanceIndex]].modelMatrix * vec4(aPosition, 1.0f);
    gl_Position = ubo.projection * ubo.view * postitionWorld;
 }
\ No newline at end of file
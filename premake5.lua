@@ -31,6 +31,7 @@ project "VulkanRenderer"
 		"%{prj.name}/Libraries/yaml/src/**.cpp",
 		"%{prj.name}/MainApp/resources/**.vert",
 		"%{prj.name}/MainApp/resources/**.frag",
+		"%{prj.name}/MainApp/resources/**.comp",
 	}
 
 	includedirs
@@ -56,6 +57,7 @@ project "VulkanRenderer"
 	{
 		"glfw3_mt.lib",
 		"vulkan-1.lib",
+		"shaderc_shared.lib",
 		"kernel32.lib",
 		"user32.lib",
 		"gdi32.lib",